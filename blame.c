@@ -1252,13 +1252,11 @@ static int fill_blob_sha1_and_mode(struct repository *r,
 struct blame_bloom_data {
 	/*
 	 * Changed-path Bloom filter keys. These can help prevent
-	 * computing diffs against first parents, but we need to
-	 * expand the list as code is moved or files are renamed.
+	 * computing diffs against first parents. They are looked up
+	 * by the path of each origin, which changes as files are
+	 * renamed.
 	 */
-	struct bloom_filter_settings *settings;
-	struct bloom_key **keys;
-	int nr;
-	int alloc;
+	struct bloom_keyvec_cache keys;
 };
 
 static int bloom_count_queries = 0;
@@ -1267,7 +1265,6 @@ static int maybe_changed_path(struct repository *r,
 			      struct blame_origin *origin,
 			      struct blame_bloom_data *bd)
 {
-	int i;
 	struct bloom_filter *filter;
 
 	if (!bd)
@@ -1282,33 +1279,15 @@ static int maybe_changed_path(struct repository *r,
 		return 1;
 
 	bloom_count_queries++;
-	for (i = 0; i < bd->nr; i++) {
-		if (bloom_filter_contains(filter,
-					  bd->keys[i],
-					  bd->settings))
-			return 1;
-	}
+	if (bloom_filter_contains_vec(filter,
+				      bloom_keyvec_cache_get(&bd->keys, origin->path),
+				      bd->keys.settings))
+		return 1;
 
 	bloom_count_no++;
 	return 0;
 }
 
-static void add_bloom_key(struct blame_bloom_data *bd,
-			  const char *path)
-{
-	if (!bd)
-		return;
-
-	if (bd->nr >= bd->alloc) {
-		bd->alloc *= 2;
-		REALLOC_ARRAY(bd->keys, bd->alloc);
-	}
-
-	bd->keys[bd->nr] = xmalloc(sizeof(struct bloom_key));
-	fill_bloom_key(path, strlen(path), bd->keys[bd->nr], bd->settings);
-	bd->nr++;
-}
-
 /*
  * We have an origin -- check if the same path exists in the
  * parent and return an origin structure to represent it.
@@ -1438,7 +1417,6 @@ static struct blame_origin *find_rename(struct repository *r,
 		struct diff_filepair *p = diff_queued_diff.queue[i];
 		if ((p->status == 'R' || p->status == 'C') &&
 		    !strcmp(p->two->path, origin->path)) {
-			add_bloom_key(bd, p->one->path);
 			porigin = get_origin(parent, p->one->path);
 			oidcpy(&porigin->blob_oid, &p->one->oid);
 			porigin->mode = p->one->mode;
@@ -2885,7 +2863,6 @@ struct blame_entry *blame_entry_prepend(struct blame_entry *head,
 
 void setup_blame_bloom_data(struct blame_scoreboard *sb)
 {
-	struct blame_bloom_data *bd;
 	struct bloom_filter_settings *bs;
 
 	if (!sb->repo->objects->commit_graph)
@@ -2895,28 +2872,14 @@ void setup_blame_bloom_data(struct blame_scoreboard *sb)
 	if (!bs)
 		return;
 
-	bd = xmalloc(sizeof(struct blame_bloom_data));
-
-	bd->settings = bs;
-
-	bd->alloc = 4;
-	bd->nr = 0;
-	ALLOC_ARRAY(bd->keys, bd->alloc);
-
-	add_bloom_key(bd, sb->path);
-
-	sb->bloom_data = bd;
+	CALLOC_ARRAY(sb->bloom_data, 1);
+	bloom_keyvec_cache_init(&sb->bloom_data->keys, bs);
 }
 
 void cleanup_scoreboard(struct blame_scoreboard *sb)
 {
 	if (sb->bloom_data) {
-		int i;
-		for (i = 0; i < sb->bloom_data->nr; i++) {
-			free(sb->bloom_data->keys[i]->hashes);
-			free(sb->bloom_data->keys[i]);
-		}
-		free(sb->bloom_data->keys);
+		bloom_keyvec_cache_clear(&sb->bloom_data->keys);
 		FREE_AND_NULL(sb->bloom_data);
 
 		trace2_data_intmax("blame", sb->repo,
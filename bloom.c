@@ -144,6 +144,80 @@ void clear_bloom_key(struct bloom_key *key)
 	FREE_AND_NULL(key->hashes);
 }
 
+struct bloom_keyvec *bloom_keyvec_new(const char *path, size_t len,
+				      const struct bloom_filter_settings *settings)
+{
+	struct bloom_keyvec *vec;
+	const char *p;
+	size_t count = 1;
+
+	/*
+	 * At this point, the path is normalized to use Unix-style
+	 * path separators. This is required due to how the
+	 * changed-path Bloom filters store the paths.
+	 */
+	for (p = path; p < path + len; p++)
+		if (*p == '/')
+			count++;
+
+	vec = xcalloc(1, st_add(sizeof(*vec),
+				st_mult(count, sizeof(struct bloom_key))));
+	vec->count = count;
+
+	fill_bloom_key(path, len, &vec->key[0], settings);
+	count = 1;
+	for (p = path + len - 1; p > path; p--)
+		if (*p == '/')
+			fill_bloom_key(path, p - path, &vec->key[count++], settings);
+
+	return vec;
+}
+
+void bloom_keyvec_free(struct bloom_keyvec *vec)
+{
+	size_t i;
+
+	if (!vec)
+		return;
+	for (i = 0; i < vec->count; i++)
+		clear_bloom_key(&vec->key[i]);
+	free(vec);
+}
+
+void bloom_keyvec_cache_init(struct bloom_keyvec_cache *cache,
+			     const struct bloom_filter_settings *settings)
+{
+	cache->settings = settings;
+	strmap_init(&cache->keyvecs);
+}
+
+const struct bloom_keyvec *bloom_keyvec_cache_get(struct bloom_keyvec_cache *cache,
+						  const char *path)
+{
+	struct bloom_keyvec *vec = strmap_get(&cache->keyvecs, path);
+	size_t len;
+
+	if (vec)
+		return vec;
+
+	len = strlen(path);
+	if (len && path[len - 1] == '/')
+		len--;
+	vec = bloom_keyvec_new(path, len, cache->settings);
+	strmap_put(&cache->keyvecs, path, vec);
+	return vec;
+}
+
+void bloom_keyvec_cache_clear(struct bloom_keyvec_cache *cache)
+{
+	struct hashmap_iter iter;
+	struct strmap_entry *e;
+
+	strmap_for_each_entry(&cache->keyvecs, &iter, e)
+		bloom_keyvec_free(e->value);
+	strmap_clear(&cache->keyvecs, 0);
+}
+
 void add_key_to_filter(const struct bloom_key *key,
 		       struct bloom_filter *filter,
 		       const struct bloom_filter_settings *settings)
@@ -325,3 +399,16 @@ int bloom_filter_contains(const struct bloom_filter *filter,
 
 	return 1;
 }
+
+int bloom_filter_contains_vec(const struct bloom_filter *filter,
+			      const struct bloom_keyvec *vec,
+			      const struct bloom_filter_settings *settings)
+{
+	int ret = 1;
+	size_t i;
+
+	for (i = 0; ret && i < vec->count; i++)
+		ret = bloom_filter_contains(filter, &vec->key[i], settings);
+
+	return ret;
+}
@@ -1,6 +1,8 @@
 #ifndef BLOOM_H
 #define BLOOM_H
 
+#include "strmap.h"
+
 struct commit;
 struct repository;
 
@@ -68,6 +70,17 @@ struct bloom_key {
 	uint32_t *hashes;
 };
 
+/*
+ * A bloom_keyvec holds the keys for a path and for each of its leading
+ * directories. A tree diff that touches the path also touches all of
+ * these, so a filter must contain every key of the vector to possibly
+ * contain the path.
+ */
+struct bloom_keyvec {
+	size_t count;
+	struct bloom_key key[FLEX_ARRAY];
+};
+
 /*
  * Calculate the murmur3 32-bit hash value for the given data
  * using the given seed.
@@ -83,6 +96,31 @@ void fill_bloom_key(const char *data,
 		    const struct bloom_filter_settings *settings);
 void clear_bloom_key(struct bloom_key *key);
 
+/*
+ * Create a bloom_keyvec for the "len" bytes at "path", which must not
+ * end in a slash, and for each of its leading directories.
+ */
+struct bloom_keyvec *bloom_keyvec_new(const char *path, size_t len,
+				      const struct bloom_filter_settings *settings);
+void bloom_keyvec_free(struct bloom_keyvec *vec);
+
+/*
+ * A bloom_keyvec_cache remembers the bloom_keyvec of every path it was
+ * asked about. It is meant for history walks that check the same few
+ * paths against the filters of many commits, and move on to another
+ * path whenever they follow a rename.
+ */
+struct bloom_keyvec_cache {
+	const struct bloom_filter_settings *settings;
+	struct strmap keyvecs;
+};
+
+void bloom_keyvec_cache_init(struct bloom_keyvec_cache *cache,
+			     const struct bloom_filter_settings *settings);
+const struct bloom_keyvec *bloom_keyvec_cache_get(struct bloom_keyvec_cache *cache,
+						  const char *path);
+void bloom_keyvec_cache_clear(struct bloom_keyvec_cache *cache);
+
 void add_key_to_filter(const struct bloom_key *key,
 		       struct bloom_filter *filter,
 		       const struct bloom_filter_settings *settings);
@@ -109,4 +147,12 @@ int bloom_filter_contains(const struct bloom_filter *filter,
 			  const struct bloom_key *key,
 			  const struct bloom_filter_settings *settings);
 
+/*
+ * Like bloom_filter_contains(), but for all keys of "vec": returns 0 if
+ * any of them is definitely not in the filter.
+ */
+int bloom_filter_contains_vec(const struct bloom_filter *filter,
+			      const struct bloom_keyvec *vec,
+			      const struct bloom_filter_settings *settings);
+
 #endif
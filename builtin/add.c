@@ -21,6 +21,9 @@
 #include "strvec.h"
 #include "submodule.h"
 #include "add-interactive.h"
+#include "convert.h"
+#include "object-store.h"
+#include "thread-utils.h"
 
 static const char * const builtin_add_usage[] = {
 	N_("git add [<options>] [--] <pathspec>..."),
@@ -354,6 +357,7 @@ N_("The following paths are ignored by one of your .gitignore files:\n");
 static int verbose, show_only, ignored_too, refresh_only;
 static int ignore_add_errors, intent_to_add, ignore_missing;
 static int warn_on_embedded_repo = 1;
+static int add_threads;
 
 #define ADDREMOVE_DEFAULT 1
 static int addremove = ADDREMOVE_DEFAULT;
@@ -405,6 +409,18 @@ static int add_config(const char *var, const char *value, void *cb)
 		return 0;
 	}
 
+	if (!strcmp(var, "add.threads")) {
+		add_threads = git_config_int(var, value);
+		if (add_threads < 0)
+			die(_("invalid number of threads specified (%d) for %s"),
+			    add_threads, var);
+		else if (!HAVE_THREADS && add_threads > 1) {
+			warning(_("no threads support, ignoring %s"), var);
+			add_threads = 1;
+		}
+		return 0;
+	}
+
 	return git_default_config(var, value, cb);
 }
 
@@ -448,10 +464,215 @@ static void check_embedded_repo(const char *path)
 	strbuf_release(&name);
 }
 
+/*
+ * Number of new files to give each thread before it is worth starting
+ * another one, when add.threads is not set.
+ */
+#define ADD_THREAD_COST (100)
+
+struct blob_writer_item {
+	const char *path;
+	struct conv_attrs ca;
+
+	/*
+	 * Set once "oid" names the blob written for the file as "sd"
+	 * describes it, so that add_files() does not have to hash it
+	 * again.
+	 */
+	unsigned hashed : 1;
+	struct stat_data sd;
+	struct object_id oid;
+};
+
+struct blob_writer_pool {
+	pthread_mutex_t mutex;
+	struct blob_writer_item *items;
+	size_t nr, next;
+};
+
+static struct blob_writer_item *next_blob_writer_item(struct blob_writer_pool *pool)
+{
+	struct blob_writer_item *item = NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+	while (!item && pool->next < pool->nr) {
+		item = &pool->items[pool->next++];
+		if (!item->path)
+			item = NULL;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return item;
+}
+
+/*
+ * Read, convert, hash and deflate one new file, and append it to the
+ * bulk-checkin packfile. Failures are ignored here: the file is added
+ * again by the regular code path afterwards, which reports them.
+ */
+static void write_one_blob(struct blob_writer_item *item)
+{
+	struct strbuf buf = STRBUF_INIT, converted = STRBUF_INIT;
+	struct stat st;
+	const char *data;
+	size_t len;
+
+	if (lstat(item->path, &st) || !S_ISREG(st.st_mode) ||
+	    st.st_size > big_file_threshold)
+		return;
+	if (strbuf_read_file(&buf, item->path, st.st_size) != st.st_size)
+		goto out;
+
+	data = buf.buf;
+	len = buf.len;
+	if (convert_to_git_ca(&the_index, &item->ca, item->path, data, len,
+			      &converted, 0)) {
+		data = converted.buf;
+		len = converted.len;
+	}
+	if (index_blob_bulk_checkin_mem(&item->oid, data, len))
+		goto out;
+
+	/*
+	 * Line ending and encoding conversions may have to warn about
+	 * the file, which only the serial code path can do.
+	 */
+	if (item->ca.crlf_action == CRLF_BINARY &&
+	    !item->ca.working_tree_encoding) {
+		fill_stat_data(&item->sd, &st);
+		item->hashed = 1;
+	}
+
+out:
+	strbuf_release(&buf);
+	strbuf_release(&converted);
+}
+
+static void *blob_writer_thread(void *data)
+{
+	struct blob_writer_pool *pool = data;
+	struct blob_writer_item *item;
+
+	trace2_thread_start("add");
+	while ((item = next_blob_writer_item(pool)))
+		write_one_blob(item);
+	trace2_thread_exit();
+	return NULL;
+}
+
+/*
+ * Write the blobs of the new files in "dir" into a single bulk-checkin
+ * packfile from a pool of threads, before add_files() adds them to the
+ * index one at a time. Returns an item for each entry of "dir", whose
+ * object name add_files() can use for files that are still unchanged,
+ * or NULL if no threads were started.
+ *
+ * Paths that need a clean filter are left to the serial code path, as
+ * filter drivers cannot run from several threads.
+ */
+static struct blob_writer_item *write_new_blobs_in_parallel(struct dir_struct *dir,
+							    int flags)
+{
+	struct blob_writer_pool pool = { 0 };
+	pthread_t *threads;
+	int i, nr_threads, queued = 0, outside_sparse = 0;
+
+	if (!HAVE_THREADS || add_threads == 1 ||
+	    (flags & (ADD_CACHE_PRETEND | ADD_CACHE_INTENT)))
+		return NULL;
+
+	nr_threads = add_threads;
+	if (!nr_threads) {
+		nr_threads = online_cpus();
+		if (nr_threads > dir->nr / ADD_THREAD_COST)
+			nr_threads = dir->nr / ADD_THREAD_COST;
+	}
+	if (nr_threads < 2)
+		return NULL;
+
+	CALLOC_ARRAY(pool.items, dir->nr);
+	pool.nr = dir->nr;
+	for (i = 0; i < dir->nr; i++) {
+		struct blob_writer_item *item = &pool.items[i];
+		const char *path = dir->entries[i]->name;
+		enum conv_attrs_classification c;
+
+		if (!path_in_sparse_checkout(path, &the_index)) {
+			if (!include_sparse)
+				continue;
+			outside_sparse = 1;
+		}
+
+		convert_attrs(&the_index, &item->ca, path);
+		c = classify_conv_attrs(&item->ca);
+		if (c == CA_CLASS_INCORE_FILTER || c == CA_CLASS_INCORE_PROCESS)
+			continue;
+
+		item->path = path;
+		queued++;
+	}
+
+	/*
+	 * Converting line endings may look the path up in the index,
+	 * which expands a sparse index when the path is outside of the
+	 * sparse-checkout cone. Do that now, rather than from several
+	 * threads at once.
+	 */
+	if (outside_sparse)
+		ensure_full_index(&the_index);
+
+	trace2_region_enter("add", "write_blobs", the_repository);
+	trace2_data_intmax("add", the_repository, "write_blobs/nr", queued);
+
+	pthread_mutex_init(&pool.mutex, NULL);
+	enable_obj_read_lock();
+
+	CALLOC_ARRAY(threads, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		int err = pthread_create(&threads[i], NULL,
+					 blob_writer_thread, &pool);
+		if (err)
+			die(_("unable to create thread: %s"), strerror(err));
+	}
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_join(threads[i], NULL))
+			die(_("unable to join thread"));
+
+	disable_obj_read_lock();
+	pthread_mutex_destroy(&pool.mutex);
+
+	/* Make the new objects visible to the serial code path */
+	flush_odb_transaction();
+
+	trace2_region_leave("add", "write_blobs", the_repository);
+
+	free(threads);
+	return pool.items;
+}
+
+/*
+ * Add the new file at "path", using the blob that a thread wrote for
+ * it in "item", if any, unless the file has changed since.
+ */
+static int add_new_file(const char *path, struct blob_writer_item *item,
+			int flags, int *reused)
+{
+	struct stat st;
+
+	if (lstat(path, &st))
+		die_errno(_("unable to stat '%s'"), path);
+	if (item && item->hashed && !match_stat_data(&item->sd, &st)) {
+		(*reused)++;
+		return add_to_index_hashed(&the_index, path, &st, &item->oid,
+					   flags);
+	}
+	return add_to_index(&the_index, path, &st, flags);
+}
+
 static int add_files(struct dir_struct *dir, int flags)
 {
-	int i, exit_status = 0;
+	int i, exit_status = 0, reused = 0;
 	struct string_list matched_sparse_paths = STRING_LIST_INIT_NODUP;
+	struct blob_writer_item *items;
 
 	if (dir->ignored_nr) {
 		fprintf(stderr, _(ignore_error));
@@ -464,6 +685,8 @@ static int add_files(struct dir_struct *dir, int flags)
 		exit_status = 1;
 	}
 
+	items = write_new_blobs_in_parallel(dir, flags);
+
 	for (i = 0; i < dir->nr; i++) {
 		if (!include_sparse &&
 		    !path_in_sparse_checkout(dir->entries[i]->name, &the_index)) {
@@ -471,7 +694,8 @@ static int add_files(struct dir_struct *dir, int flags)
 					   dir->entries[i]->name);
 			continue;
 		}
-		if (add_file_to_index(&the_index, dir->entries[i]->name, flags)) {
+		if (add_new_file(dir->entries[i]->name, items ? &items[i] : NULL,
+				 flags, &reused)) {
 			if (!ignore_add_errors)
 				die(_("adding files failed"));
 			exit_status = 1;
@@ -486,6 +710,11 @@ static int add_files(struct dir_struct *dir, int flags)
 	}
 
 	string_list_clear(&matched_sparse_paths, 0);
+	if (items) {
+		trace2_data_intmax("add", the_repository, "write_blobs/reused",
+				   reused);
+		free(items);
+	}
 
 	return exit_status;
 }
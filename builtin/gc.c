@@ -21,6 +21,9 @@
 #include "strvec.h"
 #include "commit.h"
 #include "commit-graph.h"
+#include "diffstat-index.h"
+#include "grep-index.h"
+#include "side-index.h"
 #include "packfile.h"
 #include "object-store.h"
 #include "pack.h"
@@ -882,6 +885,30 @@ static int maintenance_task_commit_graph(struct maintenance_run_opts *opts)
 	return 0;
 }
 
+static int run_write_side_index(struct maintenance_run_opts *opts,
+				int (*write_fn)(struct repository *, unsigned),
+				const char *name)
+{
+	if (write_fn(the_repository, opts->quiet ? 0 :
+		     SIDE_INDEX_WRITE_PROGRESS)) {
+		error(_("failed to write %s"), name);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int maintenance_task_diffstat_index(struct maintenance_run_opts *opts)
+{
+	return run_write_side_index(opts, write_diffstat_index,
+				    "diffstat-index");
+}
+
+static int maintenance_task_grep_index(struct maintenance_run_opts *opts)
+{
+	return run_write_side_index(opts, write_grep_index, "grep-index");
+}
+
 static int fetch_remote(struct remote *remote, void *cbdata)
 {
 	struct maintenance_run_opts *opts = cbdata;
@@ -1220,6 +1247,8 @@ enum maintenance_task_label {
 	TASK_GC,
 	TASK_COMMIT_GRAPH,
 	TASK_PACK_REFS,
+	TASK_DIFFSTAT_INDEX,
+	TASK_GREP_INDEX,
 
 	/* Leave as final value */
 	TASK__COUNT
@@ -1256,6 +1285,16 @@ static struct maintenance_task tasks[] = {
 		maintenance_task_pack_refs,
 		NULL,
 	},
+	[TASK_DIFFSTAT_INDEX] = {
+		"diffstat-index",
+		maintenance_task_diffstat_index,
+		NULL,
+	},
+	[TASK_GREP_INDEX] = {
+		"grep-index",
+		maintenance_task_grep_index,
+		NULL,
+	},
 };
 
 static int compare_tasks_by_selection(const void *a_, const void *b_)
@@ -18,6 +18,7 @@
 #include "run-command.h"
 #include "userdiff.h"
 #include "grep.h"
+#include "grep-index.h"
 #include "quote.h"
 #include "dir.h"
 #include "pathspec.h"
@@ -25,6 +26,8 @@
 #include "submodule-config.h"
 #include "object-store.h"
 #include "packfile.h"
+#include "oidset.h"
+#include "strmap.h"
 
 static const char *grep_prefix;
 
@@ -35,6 +38,36 @@ static char const * const grep_usage[] = {
 
 static int recurse_submodules;
 
+/* which blobs can match, if the repository has a grep index */
+static struct grep_index_filter *index_filter;
+static intmax_t index_filter_skipped;
+
+/*
+ * When searching many revisions, most of their blobs are the same. Before
+ * anything is shown, scan_distinct_blobs() searches each distinct blob in
+ * their trees once, using all the threads, to find out whether it would
+ * produce any output at all. That only depends on its contents as long as
+ * textconv and attributes are not involved, so grep_oid() can then skip
+ * the blobs that would not, and grep_tree() the trees that only have such
+ * blobs.
+ */
+static struct {
+	int active;
+	struct oidset matching;
+	/* "<tree oid><path>" of the trees without matching blobs */
+	struct strset empty_trees;
+	/* how many blobs grep_oid() did not skip */
+	unsigned int searched;
+} blob_scan;
+
+static void tree_key(struct strbuf *key, const struct object_id *oid,
+		     const char *path)
+{
+	strbuf_reset(key);
+	strbuf_addstr(key, oid_to_hex(oid));
+	strbuf_addstr(key, path);
+}
+
 static int num_threads;
 
 static pthread_t *threads;
@@ -350,6 +383,16 @@ static int grep_oid(struct grep_opt *opt, const struct object_id *oid,
 	struct strbuf pathbuf = STRBUF_INIT;
 	struct grep_source gs;
 
+	if (blob_scan.active) {
+		if (!oidset_contains(&blob_scan.matching, oid))
+			return 0;
+		blob_scan.searched++;
+	} else if (index_filter &&
+		   !grep_index_filter_may_match(index_filter, oid)) {
+		index_filter_skipped++;
+		return 0;
+	}
+
 	grep_source_name(opt, filename, tree_name_len, &pathbuf);
 	grep_source_init_oid(&gs, pathbuf.buf, path, oid, opt->repo);
 	strbuf_release(&pathbuf);
@@ -422,6 +465,27 @@ static void run_pager(struct grep_opt *opt, const char *prefix)
 		exit(status);
 }
 
+/*
+ * Ask the grep index which blobs can match the patterns, so that
+ * grep_oid() does not read the others.
+ */
+static void setup_index_filter(struct grep_opt *opt)
+{
+	struct grep_opt *compiled = opt;
+
+	if (num_threads > 1) {
+		/* only the copies in the threads have compiled patterns */
+		compiled = grep_opt_dup(opt);
+		compile_grep_patterns(compiled);
+	}
+	index_filter = grep_index_filter(opt->repo, compiled);
+	trace2_data_intmax("grep", opt->repo, "grep-index/used", !!index_filter);
+	if (compiled != opt) {
+		free_grep_patterns(compiled);
+		free(compiled);
+	}
+}
+
 static int grep_cache(struct grep_opt *opt,
 		      const struct pathspec *pathspec, int cached);
 static int grep_tree(struct grep_opt *opt, const struct pathspec *pathspec,
@@ -520,8 +584,14 @@ static int grep_cache(struct grep_opt *opt,
 	if (repo_read_index(repo) < 0)
 		die(_("index file corrupt"));
 
-	/* TODO: audit for interaction with sparse-index. */
-	ensure_full_index(repo->index);
+	/*
+	 * Sparse directory entries are searched through their trees below,
+	 * but the paths found in a submodule's trees would need its prefix
+	 * handled twice, so keep expanding the index in that case.
+	 */
+	if (repo->submodule_prefix)
+		ensure_full_index(repo->index);
+
 	for (nr = 0; nr < repo->index->cache_nr; nr++) {
 		const struct cache_entry *ce = repo->index->cache[nr];
 
@@ -531,7 +601,27 @@ static int grep_cache(struct grep_opt *opt,
 		strbuf_setlen(&name, name_base_len);
 		strbuf_addstr(&name, ce->name);
 
-		if (S_ISREG(ce->ce_mode) &&
+		if (S_ISSPARSEDIR(ce->ce_mode)) {
+			enum object_type type;
+			struct tree_desc tree;
+			void *data;
+			unsigned long size;
+
+			/*
+			 * A sparse directory can only be seen here with
+			 * --cached, as it is marked skip-worktree. Its
+			 * entries are the ones of its tree, which is
+			 * searched without expanding the index.
+			 */
+			data = read_object_file(&ce->oid, &type, &size);
+			if (!data || type != OBJ_TREE)
+				die(_("unable to read tree (%s)"),
+				    oid_to_hex(&ce->oid));
+
+			init_tree_desc(&tree, data, size);
+			hit |= grep_tree(opt, pathspec, &tree, &name, 0, 0);
+			free(data);
+		} else if (S_ISREG(ce->ce_mode) &&
 		    match_pathspec(repo->index, pathspec, name.buf, name.len, 0, NULL,
 				   S_ISDIR(ce->ce_mode) ||
 				   S_ISGITLINK(ce->ce_mode))) {
@@ -581,6 +671,7 @@ static int grep_tree(struct grep_opt *opt, const struct pathspec *pathspec,
 	struct name_entry entry;
 	int old_baselen = base->len;
 	struct strbuf name = STRBUF_INIT;
+	struct strbuf key = STRBUF_INIT;
 	int name_base_len = 0;
 	if (repo->submodule_prefix) {
 		strbuf_addstr(&name, repo->submodule_prefix);
@@ -613,17 +704,30 @@ static int grep_tree(struct grep_opt *opt, const struct pathspec *pathspec,
 			struct tree_desc sub;
 			void *data;
 			unsigned long size;
+			unsigned int searched = blob_scan.searched;
+
+			strbuf_addch(base, '/');
+			if (blob_scan.active) {
+				tree_key(&key, &entry.oid, base->buf + tn_len);
+				if (strset_contains(&blob_scan.empty_trees,
+						    key.buf)) {
+					strbuf_setlen(base, old_baselen);
+					continue;
+				}
+			}
 
 			data = read_object_file(&entry.oid, &type, &size);
 			if (!data)
 				die(_("unable to read tree (%s)"),
 				    oid_to_hex(&entry.oid));
 
-			strbuf_addch(base, '/');
 			init_tree_desc(&sub, data, size);
 			hit |= grep_tree(opt, pathspec, &sub, base, tn_len,
 					 check_attr);
 			free(data);
+
+			if (blob_scan.active && blob_scan.searched == searched)
+				strset_add(&blob_scan.empty_trees, key.buf);
 		} else if (recurse_submodules && S_ISGITLINK(entry.mode)) {
 			hit |= grep_submodule(opt, pathspec, &entry.oid,
 					      base->buf, base->buf + tn_len,
@@ -637,6 +741,7 @@ static int grep_tree(struct grep_opt *opt, const struct pathspec *pathspec,
 	}
 
 	strbuf_release(&name);
+	strbuf_release(&key);
 	return hit;
 }
 
@@ -674,6 +779,199 @@ static int grep_object(struct grep_opt *opt, const struct pathspec *pathspec,
 	die(_("unable to grep from object of type %s"), type_name(obj->type));
 }
 
+static void collect_blobs(struct grep_opt *opt, const struct pathspec *pathspec,
+			  struct tree_desc *tree, struct strbuf *base,
+			  struct strset *seen, struct oidset *blobs)
+{
+	enum interesting match = entry_not_interesting;
+	struct name_entry entry;
+	struct strbuf key = STRBUF_INIT;
+	int old_baselen = base->len;
+
+	while (tree_entry(tree, &entry)) {
+		if (match != all_entries_interesting) {
+			match = tree_entry_interesting(opt->repo->index,
+						       &entry, base,
+						       0, pathspec);
+			if (match == all_entries_not_interesting)
+				break;
+			if (match == entry_not_interesting)
+				continue;
+		}
+
+		if (S_ISREG(entry.mode)) {
+			oidset_insert(blobs, &entry.oid);
+		} else if (S_ISDIR(entry.mode)) {
+			enum object_type type;
+			struct tree_desc sub;
+			void *data;
+			unsigned long size;
+
+			strbuf_add(base, entry.path, tree_entry_len(&entry));
+			strbuf_addch(base, '/');
+			tree_key(&key, &entry.oid, base->buf);
+			if (strset_add(seen, key.buf)) {
+				data = read_object_file(&entry.oid, &type, &size);
+				if (!data)
+					die(_("unable to read tree (%s)"),
+					    oid_to_hex(&entry.oid));
+				init_tree_desc(&sub, data, size);
+				collect_blobs(opt, pathspec, &sub, base,
+					      seen, blobs);
+				free(data);
+			}
+			strbuf_setlen(base, old_baselen);
+		}
+	}
+	strbuf_release(&key);
+}
+
+static struct {
+	struct object_id *oid;
+	char *matches;
+	size_t nr, next;
+} scan_todo;
+
+static int blob_would_match(struct grep_opt *opt, const struct object_id *oid)
+{
+	enum object_type type;
+	unsigned long size;
+	char *data;
+	int hit;
+
+	data = repo_read_object_file(opt->repo, oid, &type, &size);
+	if (!data)
+		return 1; /* let grep_oid() report it */
+	hit = grep_buffer(opt, data, size);
+	free(data);
+	return hit;
+}
+
+static void *run_scan(void *arg)
+{
+	struct grep_opt *opt = arg;
+
+	while (1) {
+		size_t i;
+
+		grep_lock();
+		i = scan_todo.next++;
+		grep_unlock();
+		if (i >= scan_todo.nr)
+			break;
+		scan_todo.matches[i] = blob_would_match(opt, &scan_todo.oid[i]);
+	}
+	return NULL;
+}
+
+/*
+ * Find the blobs in the trees of "list" that would produce any output,
+ * searching each of them only once. See "blob_scan" above.
+ */
+static void scan_distinct_blobs(struct grep_opt *opt,
+				const struct pathspec *pathspec,
+				const struct object_array *list)
+{
+	struct strset seen_trees = STRSET_INIT;
+	struct oidset blobs = OIDSET_INIT;
+	struct oidset_iter iter;
+	const struct object_id *oid;
+	struct strbuf base = STRBUF_INIT;
+	struct grep_opt **scan_opt;
+	pthread_t *scan_threads;
+	int i, nr_threads = num_threads > 1 ? num_threads : 1;
+	size_t j;
+
+	for (i = 0; i < list->nr; i++) {
+		struct object *obj;
+		struct object_id tree_oid;
+		struct tree_desc tree;
+		unsigned long size;
+		void *data;
+
+		obj_read_lock();
+		obj = deref_tag(opt->repo, list->objects[i].item, NULL, 0);
+		obj_read_unlock();
+		if (!obj)
+			continue; /* grep_objects() dies */
+		if (obj->type == OBJ_BLOB) {
+			oidset_insert(&blobs, &obj->oid);
+			continue;
+		}
+
+		data = read_object_with_reference(opt->repo, &obj->oid,
+						  OBJ_TREE, &size, &tree_oid);
+		if (!data)
+			continue; /* ditto */
+		strbuf_reset(&base);
+		tree_key(&base, &tree_oid, "");
+		if (strset_add(&seen_trees, base.buf)) {
+			strbuf_reset(&base);
+			init_tree_desc(&tree, data, size);
+			collect_blobs(opt, pathspec, &tree, &base,
+				      &seen_trees, &blobs);
+		}
+		free(data);
+	}
+	strset_clear(&seen_trees);
+	strbuf_release(&base);
+
+	ALLOC_ARRAY(scan_todo.oid, oidset_size(&blobs));
+	oidset_iter_init(&blobs, &iter);
+	while ((oid = oidset_iter_next(&iter))) {
+		if (index_filter &&
+		    !grep_index_filter_may_match(index_filter, oid)) {
+			index_filter_skipped++;
+			continue;
+		}
+		oidcpy(&scan_todo.oid[scan_todo.nr++], oid);
+	}
+	oidset_clear(&blobs);
+	CALLOC_ARRAY(scan_todo.matches, scan_todo.nr);
+
+	ALLOC_ARRAY(scan_opt, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		scan_opt[i] = grep_opt_dup(opt);
+		scan_opt[i]->status_only = 1;
+		compile_grep_patterns(scan_opt[i]);
+	}
+	if (nr_threads > 1) {
+		/* start_threads() has set up the locks */
+		CALLOC_ARRAY(scan_threads, nr_threads);
+		for (i = 0; i < nr_threads; i++) {
+			int err = pthread_create(&scan_threads[i], NULL,
+						 run_scan, scan_opt[i]);
+			if (err)
+				die(_("grep: failed to create thread: %s"),
+				    strerror(err));
+		}
+		for (i = 0; i < nr_threads; i++)
+			pthread_join(scan_threads[i], NULL);
+		free(scan_threads);
+	} else {
+		for (j = 0; j < scan_todo.nr; j++)
+			scan_todo.matches[j] =
+				blob_would_match(scan_opt[0], &scan_todo.oid[j]);
+	}
+	for (i = 0; i < nr_threads; i++) {
+		free_grep_patterns(scan_opt[i]);
+		free(scan_opt[i]);
+	}
+	free(scan_opt);
+
+	oidset_init(&blob_scan.matching, 0);
+	for (j = 0; j < scan_todo.nr; j++)
+		if (scan_todo.matches[j])
+			oidset_insert(&blob_scan.matching, &scan_todo.oid[j]);
+	trace2_data_intmax("grep", opt->repo, "distinct-blobs", scan_todo.nr);
+	trace2_data_intmax("grep", opt->repo, "matching-blobs",
+			   oidset_size(&blob_scan.matching));
+	FREE_AND_NULL(scan_todo.oid);
+	FREE_AND_NULL(scan_todo.matches);
+	strset_init(&blob_scan.empty_trees);
+	blob_scan.active = 1;
+}
+
 static int grep_objects(struct grep_opt *opt, const struct pathspec *pathspec,
 			const struct object_array *list)
 {
@@ -681,6 +979,14 @@ static int grep_objects(struct grep_opt *opt, const struct pathspec *pathspec,
 	int hit = 0;
 	const unsigned int nr = list->nr;
 
+	/*
+	 * With textconv, or with -I which looks at the "binary"
+	 * attribute, what a blob produces depends on its path.
+	 */
+	if (nr > 1 && !opt->status_only && !opt->allow_textconv &&
+	    opt->binary != GREP_BINARY_NOMATCH && !recurse_submodules)
+		scan_distinct_blobs(opt, pathspec, list);
+
 	for (i = 0; i < nr; i++) {
 		struct object *real_obj;
 
@@ -1044,6 +1350,11 @@ int cmd_grep(int argc, const char **argv, const char *prefix)
 		}
 	}
 
+	if (the_repository->gitdir) {
+		prepare_repo_settings(the_repository);
+		the_repository->settings.command_requires_full_index = 0;
+	}
+
 	/*
 	 * Resolve any rev arguments. If we have a dashdash, then everything up
 	 * to it must resolve as a rev. If not, then we stop at the first
@@ -1189,12 +1500,15 @@ int cmd_grep(int argc, const char **argv, const char *prefix)
 	} else if (!list.nr) {
 		if (!cached)
 			setup_work_tree();
+		else
+			setup_index_filter(&opt);
 
 		hit = grep_cache(&opt, &pathspec, cached);
 	} else {
 		if (cached)
 			die(_("both --cached and trees are given"));
 
+		setup_index_filter(&opt);
 		hit = grep_objects(&opt, &pathspec, &list);
 	}
 
@@ -1204,6 +1518,14 @@ int cmd_grep(int argc, const char **argv, const char *prefix)
 		run_pager(&opt, prefix);
 	clear_pathspec(&pathspec);
 	string_list_clear(&path_list, 0);
+	if (index_filter)
+		trace2_data_intmax("grep", the_repository, "grep-index/skipped",
+				   index_filter_skipped);
+	grep_index_filter_free(index_filter);
+	if (blob_scan.active) {
+		oidset_clear(&blob_scan.matching);
+		strset_clear(&blob_scan.empty_trees);
+	}
 	free_grep_patterns(&opt);
 	object_array_clear(&list);
 	free_repos();
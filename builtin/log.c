@@ -36,6 +36,8 @@
 #include "commit-reach.h"
 #include "range-diff.h"
 #include "tmp-objdir.h"
+#include "diff-prefetch.h"
+#include "thread-utils.h"
 
 #define MAIL_DEFAULT_WRAP 72
 #define COVER_FROM_AUTO_MAX_SUBJECT_LEN 100
@@ -52,6 +54,7 @@ static int default_encode_email_headers = 1;
 static int decoration_style;
 static int decoration_given;
 static int use_mailmap_config = 1;
+static int log_threads;
 static const char *fmt_patch_subject_prefix = "PATCH";
 static int fmt_patch_name_max = FORMAT_PATCH_NAME_MAX_DEFAULT;
 static const char *fmt_pretty;
@@ -424,11 +427,106 @@ static void finish_early_output(struct rev_info *rev)
 	show_early_header(rev, "done", n);
 }
 
+/*
+ * Commits returned by get_revision() ahead of the one being shown, so
+ * that the workers of rev->diff_prefetch can compute their diffs while
+ * earlier commits are written out.
+ */
+struct log_window {
+	struct commit_list *list, **tail;
+	int nr, size;
+
+	/*
+	 * The prefetch is started only once "delay" commits have been
+	 * shown without it, with these parameters.
+	 */
+	int delay;
+	int nr_threads, want_blobs;
+};
+
+/*
+ * When log.threads is not set, use at most this many threads, and only
+ * once this many commits have been shown, so that short output does not
+ * pay for starting them.
+ */
+#define LOG_THREADS_DEFAULT_MAX 8
+#define LOG_PREFETCH_DEFAULT_DELAY 32
+
+static void start_diff_prefetch(struct rev_info *rev, struct log_window *window)
+{
+	/* the calling thread keeps doing diffcore and the output */
+	rev->diff_prefetch = diff_prefetch_start(&rev->diffopt,
+						 window->nr_threads - 1,
+						 window->want_blobs);
+	window->size = 4 * window->nr_threads;
+}
+
+static struct commit *get_revision_windowed(struct rev_info *rev,
+					    struct log_window *window)
+{
+	struct commit *commit;
+
+	if (!rev->diff_prefetch) {
+		if (!window->nr_threads || window->delay-- > 0)
+			return get_revision(rev);
+		start_diff_prefetch(rev, window);
+	}
+
+	/*
+	 * Keep asking even after get_revision() ran dry once: with
+	 * --max-count, a commit that log_tree_commit() ends up not
+	 * showing lets the walk return one more.
+	 */
+	while (window->nr < window->size) {
+		commit = get_revision(rev);
+		if (!commit)
+			break;
+		log_tree_prefetch(rev, commit);
+		window->tail = &commit_list_insert(commit, window->tail)->next;
+		window->nr++;
+	}
+
+	if (!window->list)
+		return NULL;
+	commit = pop_commit(&window->list);
+	if (!window->list)
+		window->tail = &window->list;
+	window->nr--;
+	return commit;
+}
+
+static void prepare_diff_prefetch(struct rev_info *rev, struct log_window *window)
+{
+	int nr_threads = HAVE_THREADS ? log_threads : 1;
+
+	if (!nr_threads) {
+		nr_threads = online_cpus();
+		if (nr_threads > LOG_THREADS_DEFAULT_MAX)
+			nr_threads = LOG_THREADS_DEFAULT_MAX;
+		window->delay = LOG_PREFETCH_DEFAULT_DELAY;
+	}
+	if (nr_threads < 2 || !log_tree_prefetch_supported(rev))
+		return;
+
+	/*
+	 * Read blobs only for output that will look at their contents,
+	 * and not when diff_populate_filespec() may use the working tree
+	 * instead.
+	 */
+	window->want_blobs = (rev->diffopt.output_format &
+			      (DIFF_FORMAT_PATCH | DIFF_FORMAT_DIFFSTAT |
+			       DIFF_FORMAT_NUMSTAT | DIFF_FORMAT_SHORTSTAT |
+			       DIFF_FORMAT_DIRSTAT)) &&
+			     !the_repository->index->cache;
+	window->nr_threads = nr_threads;
+}
+
 static int cmd_log_walk_no_free(struct rev_info *rev)
 {
 	struct commit *commit;
 	int saved_nrl = 0;
 	int saved_dcctc = 0;
+	struct log_window window = { 0 };
 
 	if (rev->remerge_diff) {
 		rev->remerge_objdir = tmp_objdir_create("remerge-diff");
@@ -446,12 +544,15 @@ static int cmd_log_walk_no_free(struct rev_info *rev)
 	if (rev->early_output)
 		finish_early_output(rev);
 
+	window.tail = &window.list;
+	prepare_diff_prefetch(rev, &window);
+
 	/*
 	 * For --check and --exit-code, the exit code is based on CHECK_FAILED
 	 * and HAS_CHANGES being accumulated in rev->diffopt, so be careful to
 	 * retain that state information if replacing rev->diffopt in this loop
 	 */
-	while ((commit = get_revision(rev)) != NULL) {
+	while ((commit = get_revision_windowed(rev, &window)) != NULL) {
 		if (!log_tree_commit(rev, commit) && rev->max_count >= 0)
 			/*
 			 * We decremented max_count in get_revision,
@@ -476,6 +577,9 @@ static int cmd_log_walk_no_free(struct rev_info *rev)
 	rev->diffopt.degraded_cc_to_c = saved_dcctc;
 	rev->diffopt.needed_rename_limit = saved_nrl;
 
+	diff_prefetch_finish(rev->diff_prefetch);
+	rev->diff_prefetch = NULL;
+
 	if (rev->remerge_diff) {
 		tmp_objdir_destroy(rev->remerge_objdir);
 		rev->remerge_objdir = NULL;
@@ -547,6 +651,13 @@ static int git_log_config(const char *var, const char *value, void *cb)
 		default_show_signature = git_config_bool(var, value);
 		return 0;
 	}
+	if (!strcmp(var, "log.threads")) {
+		log_threads = git_config_int(var, value);
+		if (log_threads < 0)
+			die(_("invalid number of threads specified (%d) for %s"),
+			    log_threads, var);
+		return 0;
+	}
 
 	if (git_gpg_config(var, value, cb) < 0)
 		return -1;
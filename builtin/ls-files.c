@@ -317,7 +317,17 @@ static void show_files(struct repository *repo, struct dir_struct *dir)
 	if (!(show_cached || show_stage || show_deleted || show_modified))
 		return;
 
-	if (!show_sparse_dirs)
+	/*
+	 * Without --sparse, the files inside of sparse directories must be
+	 * listed, but there is no need to expand the index if the pathspec
+	 * only matches paths in the sparse-checkout cone. The pathspec is
+	 * matched against the full names of submodule entries, so always
+	 * expand in that case.
+	 */
+	if (!show_sparse_dirs &&
+	    (repo->submodule_prefix ||
+	     pathspec_needs_expanded_index(repo->index, &pathspec) ||
+	     pathspec_matches_sparse_dir(repo->index, &pathspec)))
 		ensure_full_index(repo->index);
 
 	for (i = 0; i < repo->index->cache_nr; i++) {
@@ -86,6 +86,12 @@ static int git_multi_pack_index_write_config(const char *var, const char *value,
 		else
 			opts.flags &= ~MIDX_WRITE_BITMAP_HASH_CACHE;
 	}
+	if (!strcmp(var, "pack.writebitmapcommitattributes")) {
+		if (git_config_bool(var, value))
+			opts.flags |= MIDX_WRITE_BITMAP_COMMIT_ATTRIBUTES;
+		else
+			opts.flags &= ~MIDX_WRITE_BITMAP_COMMIT_ATTRIBUTES;
+	}
 
 	/*
 	 * We should never make a fall-back call to 'git_default_config', since
@@ -154,6 +154,38 @@ static int check_dir_in_index(const char *name)
 	return 1;
 }
 
+/*
+ * Moving paths inside the sparse-checkout cone does not need to look into
+ * sparse directories. Otherwise, or if a directory being moved contains
+ * sparse directories, work on the full index.
+ */
+static int mv_needs_full_index(const char **source, const char **destination,
+			       int nr)
+{
+	int i, j;
+
+	if (!the_index.sparse_index)
+		return 0;
+
+	for (i = 0; i < nr; i++) {
+		size_t len = strlen(source[i]);
+
+		if (!path_in_sparse_checkout(source[i], &the_index) ||
+		    !path_in_sparse_checkout(destination[i], &the_index))
+			return 1;
+
+		for (j = 0; j < active_nr; j++) {
+			const struct cache_entry *ce = active_cache[j];
+
+			if (S_ISSPARSEDIR(ce->ce_mode) &&
+			    !strncmp(ce->name, source[i], len) &&
+			    ce->name[len] == '/')
+				return 1;
+		}
+	}
+	return 0;
+}
+
 int cmd_mv(int argc, const char **argv, const char *prefix)
 {
 	int i, flags, gitmodules_modified = 0;
@@ -182,6 +214,8 @@ int cmd_mv(int argc, const char **argv, const char *prefix)
 	if (--argc < 1)
 		usage_with_options(builtin_mv_usage, builtin_mv_options);
 
+	prepare_repo_settings(the_repository);
+	the_repository->settings.command_requires_full_index = 0;
 	hold_locked_index(&lock_file, LOCK_DIE_ON_ERROR);
 	if (read_cache() < 0)
 		die(_("index file corrupt"));
@@ -212,6 +246,9 @@ int cmd_mv(int argc, const char **argv, const char *prefix)
 		destination = dest_path;
 	}
 
+	if (mv_needs_full_index(source, destination, argc))
+		ensure_full_index(&the_index);
+
 	/* Checking */
 	for (i = 0; i < argc; i++) {
 		const char *src = source[i], *dst = destination[i];
@@ -3148,6 +3148,12 @@ static int git_pack_config(const char *k, const char *v, void *cb)
 		else
 			write_bitmap_options &= ~BITMAP_OPT_HASH_CACHE;
 	}
+	if (!strcmp(k, "pack.writebitmapcommitattributes")) {
+		if (git_config_bool(k, v))
+			write_bitmap_options |= BITMAP_OPT_COMMIT_ATTRIBUTES;
+		else
+			write_bitmap_options &= ~BITMAP_OPT_COMMIT_ATTRIBUTES;
+	}
 	if (!strcmp(k, "pack.usebitmaps")) {
 		use_bitmap_index_default = git_config_bool(k, v);
 		return 0;
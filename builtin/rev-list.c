@@ -396,6 +396,19 @@ static inline int parse_missing_action_value(const char *value)
 	return 0;
 }
 
+/*
+ * Counting only commits can also handle options like --first-parent and
+ * --no-merges that limit which commits are counted.
+ */
+static struct bitmap_index *prepare_count_walk(struct rev_info *revs,
+					       int filter_provided_objects)
+{
+	if (!revs->tag_objects && !revs->tree_objects && !revs->blob_objects &&
+	    !revs->filter.choice)
+		return prepare_bitmap_commit_walk(revs);
+	return prepare_bitmap_walk(revs, filter_provided_objects);
+}
+
 static int try_bitmap_count(struct rev_info *revs,
 			    int filter_provided_objects)
 {
@@ -432,7 +445,7 @@ static int try_bitmap_count(struct rev_info *revs,
 	 */
 	max_count = revs->max_count;
 
-	bitmap_git = prepare_bitmap_walk(revs, filter_provided_objects);
+	bitmap_git = prepare_count_walk(revs, filter_provided_objects);
 	if (!bitmap_git)
 		return -1;
 
@@ -477,7 +490,7 @@ static int try_bitmap_disk_usage(struct rev_info *revs,
 	if (!show_disk_usage)
 		return -1;
 
-	bitmap_git = prepare_bitmap_walk(revs, filter_provided_objects);
+	bitmap_git = prepare_count_walk(revs, filter_provided_objects);
 	if (!bitmap_git)
 		return -1;
 
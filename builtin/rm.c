@@ -287,6 +287,8 @@ int cmd_rm(int argc, const char **argv, const char *prefix)
 	if (!index_only)
 		setup_work_tree();
 
+	prepare_repo_settings(the_repository);
+	the_repository->settings.command_requires_full_index = 0;
 	hold_locked_index(&lock_file, LOCK_DIE_ON_ERROR);
 
 	if (read_cache() < 0)
@@ -296,8 +298,15 @@ int cmd_rm(int argc, const char **argv, const char *prefix)
 
 	seen = xcalloc(pathspec.nr, 1);
 
-	/* TODO: audit for interaction with sparse-index. */
-	ensure_full_index(&the_index);
+	/*
+	 * Sparse directories are skip-worktree, so they are ignored unless
+	 * --sparse is given. In that case, expand them so that their files
+	 * are removed (and reported) one by one, like in a full index.
+	 */
+	if (pathspec_needs_expanded_index(&the_index, &pathspec) ||
+	    (include_sparse && pathspec_matches_sparse_dir(&the_index, &pathspec)))
+		ensure_full_index(&the_index);
+
 	for (i = 0; i < active_nr; i++) {
 		const struct cache_entry *ce = active_cache[i];
 
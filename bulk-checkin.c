@@ -12,9 +12,18 @@
 #include "tmp-objdir.h"
 #include "packfile.h"
 #include "object-store.h"
+#include "oidset.h"
+#include "thread-utils.h"
 
 static int odb_transaction_nesting;
 
+/*
+ * Serializes appending to bulk_checkin_packfile when blobs are written
+ * from several threads with index_blob_bulk_checkin_mem().
+ */
+static pthread_mutex_t bulk_checkin_mutex;
+static int bulk_checkin_mutex_initialized;
+
 static struct tmp_objdir *bulk_fsync_objdir;
 
 static struct bulk_checkin_packfile {
@@ -26,6 +35,7 @@ static struct bulk_checkin_packfile {
 	struct pack_idx_entry **written;
 	uint32_t alloc_written;
 	uint32_t nr_written;
+	struct oidset written_oids;
 } bulk_checkin_packfile;
 
 static void finish_tmp_packfile(struct strbuf *basename,
@@ -78,6 +88,7 @@ static void flush_bulk_checkin_packfile(struct bulk_checkin_packfile *state)
 
 clear_exit:
 	free(state->written);
+	oidset_clear(&state->written_oids);
 	memset(state, 0, sizeof(*state));
 
 	strbuf_release(&packname);
@@ -121,21 +132,28 @@ static void flush_batch_fsync(void)
 
 static int already_written(struct bulk_checkin_packfile *state, struct object_id *oid)
 {
-	int i;
-
 	/* The object may already exist in the repository */
 	if (has_object_file(oid))
 		return 1;
 
-	/* Might want to keep the list sorted */
-	for (i = 0; i < state->nr_written; i++)
-		if (oideq(&state->written[i]->oid, oid))
-			return 1;
+	/* Or we may have written it to the current pack already */
+	if (oidset_contains(&state->written_oids, oid))
+		return 1;
 
 	/* This is a new object we need to keep */
 	return 0;
 }
 
+static void record_written(struct bulk_checkin_packfile *state,
+			   struct pack_idx_entry *idx)
+{
+	ALLOC_GROW(state->written,
+		   state->nr_written + 1,
+		   state->alloc_written);
+	state->written[state->nr_written++] = idx;
+	oidset_insert(&state->written_oids, &idx->oid);
+}
+
 /*
  * Read the contents from fd for size bytes, streaming it to the
  * packfile in state while updating the hash in ctx. Signal a failure
@@ -305,11 +323,80 @@ static int deflate_to_pack(struct bulk_checkin_packfile *state,
 		free(idx);
 	} else {
 		oidcpy(&idx->oid, result_oid);
-		ALLOC_GROW(state->written,
-			   state->nr_written + 1,
-			   state->alloc_written);
-		state->written[state->nr_written++] = idx;
+		record_written(state, idx);
+	}
+	return 0;
+}
+
+/*
+ * Deflate an in-core blob into "out", prefixed with its in-pack object
+ * header, ready to be appended to a packfile as-is.
+ */
+static void deflate_blob_to_buffer(struct strbuf *out,
+				   const void *buf, size_t size)
+{
+	git_zstream s;
+	unsigned char hdr[MAX_PACK_OBJECT_HEADER];
+	unsigned hdrlen;
+	unsigned long bound;
+
+	hdrlen = encode_in_pack_object_header(hdr, sizeof(hdr), OBJ_BLOB, size);
+
+	git_deflate_init(&s, pack_compression_level);
+	bound = git_deflate_bound(&s, size);
+	strbuf_grow(out, hdrlen + bound);
+	strbuf_add(out, hdr, hdrlen);
+
+	s.next_in = (void *)buf;
+	s.avail_in = size;
+	s.next_out = (unsigned char *)out->buf + out->len;
+	s.avail_out = bound;
+	while (git_deflate(&s, Z_FINISH) == Z_OK)
+		; /* nothing */
+	git_deflate_end(&s);
+
+	strbuf_setlen(out, out->len + s.total_out);
+}
+
+int index_blob_bulk_checkin_mem(struct object_id *oid,
+				const void *buf, size_t size)
+{
+	struct bulk_checkin_packfile *state = &bulk_checkin_packfile;
+	struct strbuf deflated = STRBUF_INIT;
+
+	if (!odb_transaction_nesting)
+		BUG("index_blob_bulk_checkin_mem() outside of a transaction");
+
+	hash_object_file(the_hash_algo, buf, size, OBJ_BLOB, oid);
+	if (has_object_file(oid))
+		return 0;
+
+	deflate_blob_to_buffer(&deflated, buf, size);
+
+	pthread_mutex_lock(&bulk_checkin_mutex);
+	if (!already_written(state, oid)) {
+		struct pack_idx_entry *idx;
+
+		prepare_to_stream(state, HASH_WRITE_OBJECT);
+		if (state->nr_written && pack_size_limit_cfg &&
+		    pack_size_limit_cfg < state->offset + deflated.len) {
+			flush_bulk_checkin_packfile(state);
+			prepare_to_stream(state, HASH_WRITE_OBJECT);
+		}
+
+		CALLOC_ARRAY(idx, 1);
+		idx->offset = state->offset;
+		crc32_begin(state->f);
+		hashwrite(state->f, deflated.buf, deflated.len);
+		idx->crc32 = crc32_end(state->f);
+		state->offset += deflated.len;
+
+		oidcpy(&idx->oid, oid);
+		record_written(state, idx);
 	}
+	pthread_mutex_unlock(&bulk_checkin_mutex);
+
+	strbuf_release(&deflated);
 	return 0;
 }
 
@@ -357,6 +444,10 @@ int index_bulk_checkin(struct object_id *oid,
 
 void begin_odb_transaction(void)
 {
+	if (!bulk_checkin_mutex_initialized) {
+		pthread_mutex_init(&bulk_checkin_mutex, NULL);
+		bulk_checkin_mutex_initialized = 1;
+	}
 	odb_transaction_nesting += 1;
 }
 
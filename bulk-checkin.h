@@ -13,6 +13,19 @@ int index_bulk_checkin(struct object_id *oid,
 		       int fd, size_t size, enum object_type type,
 		       const char *path, unsigned flags);
 
+/*
+ * Write an in-core blob into the packfile of the current ODB
+ * transaction, and store its object name in "oid". Hashing and
+ * compressing the blob happen without holding any lock, so several
+ * threads may call this at the same time (with enable_obj_read_lock()
+ * in effect); only appending to the packfile is serialized.
+ *
+ * This must be called between begin_odb_transaction() and
+ * end_odb_transaction(). It does not apply any conversion to the blob.
+ */
+int index_blob_bulk_checkin_mem(struct object_id *oid,
+				const void *buf, size_t size);
+
 /*
  * Tell the object database to optimize for adding
  * multiple objects. end_odb_transaction must be called
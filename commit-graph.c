@@ -20,6 +20,7 @@
 #include "json-writer.h"
 #include "trace2.h"
 #include "chunk-format.h"
+#include "prio-queue.h"
 
 void git_test_write_commit_graph_or_die(void)
 {
@@ -45,8 +46,10 @@ void git_test_write_commit_graph_or_die(void)
 #define GRAPH_CHUNKID_BLOOMINDEXES 0x42494458 /* "BIDX" */
 #define GRAPH_CHUNKID_BLOOMDATA 0x42444154 /* "BDAT" */
 #define GRAPH_CHUNKID_BASE 0x42415345 /* "BASE" */
+#define GRAPH_CHUNKID_REACHABILITY 0x52494458 /* "RIDX" */
 
 #define GRAPH_DATA_WIDTH (the_hash_algo->rawsz + 16)
+#define GRAPH_REACHABILITY_WIDTH 16
 
 #define GRAPH_VERSION_1 0x1
 #define GRAPH_VERSION GRAPH_VERSION_1
@@ -321,6 +324,19 @@ static int graph_read_bloom_data(const unsigned char *chunk_start,
 	return 0;
 }
 
+static int graph_read_reachability(const unsigned char *chunk_start,
+				   size_t chunk_size, void *data)
+{
+	struct commit_graph *g = data;
+
+	if (chunk_size != st_mult(g->num_commits, GRAPH_REACHABILITY_WIDTH)) {
+		warning(_("commit-graph reachability index has wrong size; ignoring"));
+		return 0;
+	}
+	g->chunk_reachability = chunk_start;
+	return 0;
+}
+
 struct commit_graph *parse_commit_graph(struct repository *r,
 					void *graph_map, size_t graph_size)
 {
@@ -407,6 +423,10 @@ struct commit_graph *parse_commit_graph(struct repository *r,
 			   graph_read_bloom_data, graph);
 	}
 
+	if (r->settings.commit_graph_read_reachability_index)
+		read_chunk(cf, GRAPH_CHUNKID_REACHABILITY,
+			   graph_read_reachability, graph);
+
 	if (graph->chunk_bloom_indexes && graph->chunk_bloom_data) {
 		init_bloom_filters();
 	} else {
@@ -913,6 +933,84 @@ struct commit *lookup_commit_in_graph(struct repository *repo, const struct obje
 	return commit;
 }
 
+static const unsigned char *reachability_entry(struct commit_graph *g,
+						uint32_t pos,
+						struct commit_graph **layer)
+{
+	while (g && pos < g->num_commits_in_base)
+		g = g->base_graph;
+	if (!g || pos >= g->num_commits + g->num_commits_in_base)
+		return NULL;
+	if (!g->chunk_reachability)
+		return NULL;
+
+	if (layer)
+		*layer = g;
+	return g->chunk_reachability +
+	       st_mult(pos - g->num_commits_in_base, GRAPH_REACHABILITY_WIDTH);
+}
+
+int commit_graph_can_reach(struct repository *r,
+			   struct commit *from, struct commit *to)
+{
+	struct commit_graph *g, *from_layer, *to_layer;
+	const unsigned char *f, *t;
+	uint32_t from_pre, to_pre;
+
+	if (from == to)
+		return 1;
+	if (!prepare_commit_graph(r))
+		return -1;
+	g = r->objects->commit_graph;
+
+	f = reachability_entry(g, commit_graph_position(from), &from_layer);
+	t = reachability_entry(g, commit_graph_position(to), &to_layer);
+	if (!f || !t)
+		return -1;
+
+	/* "x" and "y" of an ancestor are both smaller */
+	if (get_be32(t) >= get_be32(f) ||
+	    get_be32(t + 4) >= get_be32(f + 4))
+		return 0;
+
+	/* "from" is in the first-parent subtree of "to" */
+	if (from_layer != to_layer)
+		return -1;
+	from_pre = get_be32(f + 8);
+	to_pre = get_be32(t + 8);
+	if (to_pre <= from_pre && from_pre <= get_be32(t + 12))
+		return 1;
+
+	return -1;
+}
+
+int commit_graph_has_topo_order(struct repository *r)
+{
+	struct commit_graph *g;
+
+	if (!prepare_commit_graph(r))
+		return 0;
+	for (g = r->objects->commit_graph; g; g = g->base_graph)
+		if (!g->chunk_reachability)
+			return 0;
+	return 1;
+}
+
+int commit_graph_topo_position(struct repository *r, struct commit *c,
+			       uint32_t *pos)
+{
+	const unsigned char *e;
+
+	if (!r->objects->commit_graph)
+		return 0;
+	e = reachability_entry(r->objects->commit_graph,
+			       commit_graph_position(c), NULL);
+	if (!e)
+		return 0;
+	*pos = get_be32(e);
+	return 1;
+}
+
 static int parse_commit_in_graph_one(struct repository *r,
 				     struct commit_graph *g,
 				     struct commit *item)
@@ -995,6 +1093,22 @@ struct packed_commit_list {
 	size_t alloc;
 };
 
+/*
+ * Per-commit data of the reachability index while writing a
+ * commit-graph; "x", "y", "pre" and "post" are written out as-is, the
+ * other fields are scratch space for compute_reachability_index().
+ */
+struct reach_index_entry {
+	uint32_t x, y;
+	uint32_t pre, post;
+	uint32_t in_layer;
+	uint32_t pending;
+	uint32_t size;
+	uint32_t next;
+};
+
+define_commit_slab(reach_index_slab, struct reach_index_entry);
+
 struct write_commit_graph_context {
 	struct repository *r;
 	struct object_directory *odb;
@@ -1023,9 +1137,11 @@ struct write_commit_graph_context {
 		 changed_paths:1,
 		 order_by_pack:1,
 		 write_generation_data:1,
-		 trust_generation_numbers:1;
+		 trust_generation_numbers:1,
+		 reachability_index:1;
 
 	struct topo_level_slab *topo_levels;
+	struct reach_index_slab *reach_index;
 	const struct commit_graph_opts *opts;
 	size_t total_bloom_filter_data_size;
 	const struct bloom_filter_settings *bloom_settings;
@@ -1186,6 +1302,26 @@ static int write_graph_chunk_data(struct hashfile *f,
 	return 0;
 }
 
+static int write_graph_chunk_reachability(struct hashfile *f,
+					  void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	int i;
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		struct reach_index_entry *e =
+			reach_index_slab_at(ctx->reach_index, ctx->commits.list[i]);
+
+		display_progress(ctx->progress, ++ctx->progress_cnt);
+		hashwrite_be32(f, e->x);
+		hashwrite_be32(f, e->y);
+		hashwrite_be32(f, e->pre);
+		hashwrite_be32(f, e->post);
+	}
+
+	return 0;
+}
+
 static int write_graph_chunk_generation_data(struct hashfile *f,
 					     void *data)
 {
@@ -1563,6 +1699,168 @@ static void compute_generation_numbers(struct write_commit_graph_context *ctx)
 	stop_progress(&ctx->progress);
 }
 
+static int reach_index_date_cmp(const void *va, const void *vb, void *unused)
+{
+	const struct commit *a = va, *b = vb;
+
+	/* newest first: tips of the layer get the largest coordinates */
+	if (a->date > b->date)
+		return -1;
+	if (a->date < b->date)
+		return 1;
+	return 0;
+}
+
+static int reach_index_x_cmp(const void *va, const void *vb, void *cb_data)
+{
+	struct reach_index_slab *slab = cb_data;
+	uint32_t xa = reach_index_slab_at(slab, (struct commit *)va)->x;
+	uint32_t xb = reach_index_slab_at(slab, (struct commit *)vb)->x;
+
+	/* smallest "x" first, to make "y" disagree with "x" where it can */
+	if (xa < xb)
+		return -1;
+	if (xa > xb)
+		return 1;
+	return 0;
+}
+
+/*
+ * Assign one coordinate to all commits of the layer being written, in
+ * a topological order where every commit comes after its parents. The
+ * order is found from the tips down, letting "cmp" pick among the
+ * commits whose children have all been numbered.
+ */
+static void reach_index_topo_order(struct write_commit_graph_context *ctx,
+				   prio_queue_compare_fn cmp, int set_x)
+{
+	struct prio_queue queue = { cmp, 0, ctx->reach_index };
+	uint32_t next = ctx->new_num_commits_in_base + ctx->commits.nr;
+	int i;
+
+	for (i = 0; i < ctx->commits.nr; i++)
+		reach_index_slab_at(ctx->reach_index, ctx->commits.list[i])->pending = 0;
+	for (i = 0; i < ctx->commits.nr; i++) {
+		struct commit_list *p;
+		for (p = ctx->commits.list[i]->parents; p; p = p->next) {
+			struct reach_index_entry *e =
+				reach_index_slab_at(ctx->reach_index, p->item);
+			if (e->in_layer)
+				e->pending++;
+		}
+	}
+	for (i = 0; i < ctx->commits.nr; i++)
+		if (!reach_index_slab_at(ctx->reach_index, ctx->commits.list[i])->pending)
+			prio_queue_put(&queue, ctx->commits.list[i]);
+
+	while (queue.nr) {
+		struct commit *c = prio_queue_get(&queue);
+		struct reach_index_entry *e = reach_index_slab_at(ctx->reach_index, c);
+		struct commit_list *p;
+
+		if (set_x)
+			e->x = --next;
+		else
+			e->y = --next;
+
+		for (p = c->parents; p; p = p->next) {
+			struct reach_index_entry *pe =
+				reach_index_slab_at(ctx->reach_index, p->item);
+			if (pe->in_layer && !--pe->pending)
+				prio_queue_put(&queue, p->item);
+		}
+	}
+
+	if (next != ctx->new_num_commits_in_base)
+		BUG("reachability index did not number all commits");
+	clear_prio_queue(&queue);
+}
+
+static int commit_x_cmp(const void *va, const void *vb, void *cb_data)
+{
+	struct reach_index_slab *slab = cb_data;
+	uint32_t xa = reach_index_slab_at(slab, *(struct commit **)va)->x;
+	uint32_t xb = reach_index_slab_at(slab, *(struct commit **)vb)->x;
+
+	return xa < xb ? -1 : xa > xb;
+}
+
+static struct commit *first_parent_in_layer(struct reach_index_slab *slab,
+					    struct commit *c)
+{
+	if (c->parents && reach_index_slab_at(slab, c->parents->item)->in_layer)
+		return c->parents->item;
+	return NULL;
+}
+
+/*
+ * Compute the reachability index for the commits in this layer.
+ *
+ * "x" and "y" are two topological orders in which parents come before
+ * their children, so "y" being reachable from "x" implies that both
+ * coordinates of "y" are smaller than those of "x" (FELINE). They are
+ * offset by the number of commits in the base graphs, so that they are
+ * comparable across the layers of a split commit-graph: commits in an
+ * upper layer are never reachable from commits in a lower one.
+ *
+ * "pre" and "post" describe an interval in a pre-order numbering of
+ * the forest of first-parent edges within this layer: a commit whose
+ * "pre" falls into the interval of another commit reaches it along
+ * its first-parent history. These are only comparable within a layer.
+ */
+static void compute_reachability_index(struct write_commit_graph_context *ctx)
+{
+	struct commit **sorted;
+	uint32_t next_pre = 0;
+	int i;
+
+	trace2_region_enter("commit-graph", "compute_reachability_index", ctx->r);
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		struct commit *c = ctx->commits.list[i];
+		repo_parse_commit(ctx->r, c);
+		reach_index_slab_at(ctx->reach_index, c)->in_layer = 1;
+	}
+
+	reach_index_topo_order(ctx, reach_index_date_cmp, 1);
+	reach_index_topo_order(ctx, reach_index_x_cmp, 0);
+
+	ALLOC_ARRAY(sorted, ctx->commits.nr);
+	COPY_ARRAY(sorted, ctx->commits.list, ctx->commits.nr);
+	QSORT_S(sorted, ctx->commits.nr, commit_x_cmp, ctx->reach_index);
+
+	/* subtree sizes, children before their first parent */
+	for (i = ctx->commits.nr - 1; i >= 0; i--) {
+		struct reach_index_entry *e = reach_index_slab_at(ctx->reach_index, sorted[i]);
+		struct commit *parent = first_parent_in_layer(ctx->reach_index, sorted[i]);
+
+		e->size++;
+		if (parent)
+			reach_index_slab_at(ctx->reach_index, parent)->size += e->size;
+	}
+
+	/* pre-order numbers, first parents before their children */
+	for (i = 0; i < ctx->commits.nr; i++) {
+		struct reach_index_entry *e = reach_index_slab_at(ctx->reach_index, sorted[i]);
+		struct commit *parent = first_parent_in_layer(ctx->reach_index, sorted[i]);
+
+		if (parent) {
+			struct reach_index_entry *pe =
+				reach_index_slab_at(ctx->reach_index, parent);
+			e->pre = pe->next;
+			pe->next += e->size;
+		} else {
+			e->pre = next_pre;
+			next_pre += e->size;
+		}
+		e->post = e->pre + e->size - 1;
+		e->next = e->pre + 1;
+	}
+
+	free(sorted);
+	trace2_region_leave("commit-graph", "compute_reachability_index", ctx->r);
+}
+
 static void trace2_bloom_filter_write_statistics(struct write_commit_graph_context *ctx)
 {
 	trace2_data_intmax("commit-graph", ctx->r, "filter-computed",
@@ -1904,6 +2202,10 @@ static int write_commit_graph_file(struct write_commit_graph_context *ctx)
 				+ ctx->total_bloom_filter_data_size,
 			  write_graph_chunk_bloom_data);
 	}
+	if (ctx->reachability_index)
+		add_chunk(cf, GRAPH_CHUNKID_REACHABILITY,
+			  GRAPH_REACHABILITY_WIDTH * ctx->commits.nr,
+			  write_graph_chunk_reachability);
 	if (ctx->num_commit_graphs_after > 1)
 		add_chunk(cf, GRAPH_CHUNKID_BASE,
 			  hashsz * (ctx->num_commit_graphs_after - 1),
@@ -2276,6 +2578,7 @@ int write_commit_graph(struct object_directory *odb,
 	int replace = 0;
 	struct bloom_filter_settings bloom_settings = DEFAULT_BLOOM_FILTER_SETTINGS;
 	struct topo_level_slab topo_levels;
+	struct reach_index_slab reach_index;
 
 	prepare_repo_settings(r);
 	if (!r->settings.core_commit_graph) {
@@ -2331,6 +2634,16 @@ int write_commit_graph(struct object_directory *odb,
 		}
 	}
 
+	if (flags & COMMIT_GRAPH_WRITE_REACHABILITY_INDEX)
+		ctx->reachability_index = 1;
+	if (!(flags & COMMIT_GRAPH_NO_WRITE_REACHABILITY_INDEX)) {
+		struct commit_graph *g = ctx->r->objects->commit_graph;
+
+		/* We have a reachability index already. Keep it in the next graph */
+		if (g && g->chunk_reachability)
+			ctx->reachability_index = 1;
+	}
+
 	if (ctx->split) {
 		struct commit_graph *g = ctx->r->objects->commit_graph;
 
@@ -2411,6 +2724,12 @@ int write_commit_graph(struct object_directory *odb,
 	if (ctx->changed_paths)
 		compute_bloom_filters(ctx);
 
+	if (ctx->reachability_index) {
+		init_reach_index_slab(&reach_index);
+		ctx->reach_index = &reach_index;
+		compute_reachability_index(ctx);
+	}
+
 	res = write_commit_graph_file(ctx);
 
 	if (ctx->split)
@@ -2423,6 +2742,8 @@ int write_commit_graph(struct object_directory *odb,
 	free(ctx->commits.list);
 	oid_array_clear(&ctx->oids);
 	clear_topo_level_slab(&topo_levels);
+	if (ctx->reach_index)
+		clear_reach_index_slab(ctx->reach_index);
 
 	if (ctx->commit_graph_filenames_after) {
 		for (i = 0; i < ctx->num_commit_graphs_after; i++) {
@@ -2579,6 +2900,17 @@ int verify_commit_graph(struct repository *r, struct commit_graph *g, int flags)
 			if (generation > max_generation)
 				max_generation = generation;
 
+			if (g->chunk_reachability) {
+				const unsigned char *c = reachability_entry(g, i + g->num_commits_in_base, NULL);
+				const unsigned char *p = reachability_entry(g, commit_graph_position(graph_parents->item), NULL);
+
+				if (p && (get_be32(p) >= get_be32(c) ||
+					  get_be32(p + 4) >= get_be32(c + 4)))
+					graph_report(_("commit-graph reachability index for commit %s is not after its parent %s"),
+						     oid_to_hex(&cur_oid),
+						     oid_to_hex(&graph_parents->item->object.oid));
+			}
+
 			graph_parents = graph_parents->next;
 			odb_parents = odb_parents->next;
 		}
@@ -83,6 +83,7 @@ struct commit_graph {
 	const unsigned char *chunk_base_graphs;
 	const unsigned char *chunk_bloom_indexes;
 	const unsigned char *chunk_bloom_data;
+	const unsigned char *chunk_reachability;
 
 	struct topo_level_slab *topo_levels;
 	struct bloom_filter_settings *bloom_filter_settings;
@@ -116,6 +117,8 @@ enum commit_graph_write_flags {
 	COMMIT_GRAPH_WRITE_SPLIT      = (1 << 2),
 	COMMIT_GRAPH_WRITE_BLOOM_FILTERS = (1 << 3),
 	COMMIT_GRAPH_NO_WRITE_BLOOM_FILTERS = (1 << 4),
+	COMMIT_GRAPH_WRITE_REACHABILITY_INDEX = (1 << 5),
+	COMMIT_GRAPH_NO_WRITE_REACHABILITY_INDEX = (1 << 6),
 };
 
 enum commit_graph_split_flags {
@@ -170,4 +173,29 @@ struct commit_graph_data {
  */
 timestamp_t commit_graph_generation(const struct commit *);
 uint32_t commit_graph_position(const struct commit *);
+
+/*
+ * Use the reachability index of the commit-graph to find out whether
+ * "to" is reachable from "from", without walking. Returns 1 or 0 if the
+ * index can answer, and -1 if it cannot (for example, because one of
+ * the commits is not in the commit-graph, or the index gives neither a
+ * positive nor a negative answer for this pair). Both commits must be
+ * parsed.
+ */
+int commit_graph_can_reach(struct repository *r,
+			   struct commit *from, struct commit *to);
+
+/*
+ * The reachability index also orders all commits of the commit-graph so
+ * that every commit comes after all of its parents, and newer lines of
+ * history come first where the graph allows it.
+ *
+ * commit_graph_has_topo_order() returns 1 if every layer of the
+ * commit-graph has that order. If so, commit_graph_topo_position()
+ * returns 1 and sets "*pos" to the position of "c" in it, or returns 0
+ * if "c" is not in the commit-graph. "c" must be parsed.
+ */
+int commit_graph_has_topo_order(struct repository *r);
+int commit_graph_topo_position(struct repository *r, struct commit *c,
+			       uint32_t *pos);
 #endif
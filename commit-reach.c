@@ -8,6 +8,8 @@
 #include "revision.h"
 #include "tag.h"
 #include "commit-reach.h"
+#include "ewah/ewok.h"
+#include "pack-bitmap.h"
 
 /* Remember to update object flag allocation in object.h */
 #define PARENT1		(1u<<16)
@@ -493,6 +495,16 @@ int repo_in_merge_bases_many(struct repository *r, struct commit *commit,
 	if (generation > max_generation)
 		return ret;
 
+	for (i = 0; i < nr_reference; i++) {
+		int reach = commit_graph_can_reach(r, reference[i], commit);
+		if (reach > 0)
+			return 1;
+		if (reach < 0)
+			break;
+	}
+	if (i == nr_reference)
+		return ret;
+
 	bases = paint_down_to_common(r, commit,
 				     nr_reference, reference,
 				     generation);
@@ -618,6 +630,35 @@ static int in_commit_list(const struct commit_list *want, struct commit *c)
 	return 0;
 }
 
+/*
+ * Use the stored bitmap of the candidate, if any, to find out whether it
+ * can reach any commit in the list. The bitmap is read only once for
+ * all of them.
+ */
+static enum contains_result contains_test_bitmap(struct bitmap_index *bitmap_git,
+						 struct commit *candidate,
+						 const struct commit_list *want)
+{
+	const struct object_id **oids;
+	unsigned char *reachable;
+	size_t nr = commit_list_count(want), i = 0;
+	int count;
+
+	ALLOC_ARRAY(oids, nr);
+	for (; want; want = want->next)
+		oids[i++] = &want->item->object.oid;
+	reachable = xmalloc(nr);
+
+	count = bitmap_commit_contains_many(bitmap_git, candidate, nr, oids,
+					    reachable);
+
+	free(reachable);
+	free(oids);
+	if (count < 0)
+		return CONTAINS_UNKNOWN;
+	return count ? CONTAINS_YES : CONTAINS_NO;
+}
+
 /*
  * Test whether the candidate is contained in the list.
  * Do not recurse to find out, though, but return -1 if inconclusive.
@@ -625,7 +666,8 @@ static int in_commit_list(const struct commit_list *want, struct commit *c)
 static enum contains_result contains_test(struct commit *candidate,
 					  const struct commit_list *want,
 					  struct contains_cache *cache,
-					  timestamp_t cutoff)
+					  timestamp_t cutoff,
+					  struct bitmap_index *bitmap_git)
 {
 	enum contains_result *cached = contains_cache_at(cache, candidate);
 
@@ -645,6 +687,16 @@ static enum contains_result contains_test(struct commit *candidate,
 	if (commit_graph_generation(candidate) < cutoff)
 		return CONTAINS_NO;
 
+	if (bitmap_git) {
+		enum contains_result result;
+
+		result = contains_test_bitmap(bitmap_git, candidate, want);
+		if (result != CONTAINS_UNKNOWN) {
+			*cached = result;
+			return result;
+		}
+	}
+
 	return CONTAINS_UNKNOWN;
 }
 
@@ -657,7 +709,8 @@ static void push_to_contains_stack(struct commit *candidate, struct contains_sta
 
 static enum contains_result contains_tag_algo(struct commit *candidate,
 					      const struct commit_list *want,
-					      struct contains_cache *cache)
+					      struct contains_cache *cache,
+					      struct bitmap_index *bitmap_git)
 {
 	struct contains_stack contains_stack = { 0, 0, NULL };
 	enum contains_result result;
@@ -673,7 +726,7 @@ static enum contains_result contains_tag_algo(struct commit *candidate,
 			cutoff = generation;
 	}
 
-	result = contains_test(candidate, want, cache, cutoff);
+	result = contains_test(candidate, want, cache, cutoff, bitmap_git);
 	if (result != CONTAINS_UNKNOWN)
 		return result;
 
@@ -691,7 +744,8 @@ static enum contains_result contains_tag_algo(struct commit *candidate,
 		 * If we just popped the stack, parents->item has been marked,
 		 * therefore contains_test will return a meaningful yes/no.
 		 */
-		else switch (contains_test(parents->item, want, cache, cutoff)) {
+		else switch (contains_test(parents->item, want, cache, cutoff,
+				      bitmap_git)) {
 		case CONTAINS_YES:
 			*contains_cache_at(cache, commit) = CONTAINS_YES;
 			contains_stack.nr--;
@@ -705,17 +759,24 @@ static enum contains_result contains_tag_algo(struct commit *candidate,
 		}
 	}
 	free(contains_stack.contains_stack);
-	return contains_test(candidate, want, cache, cutoff);
+	return contains_test(candidate, want, cache, cutoff, bitmap_git);
 }
 
 int commit_contains(struct ref_filter *filter, struct commit *commit,
 		    struct commit_list *list, struct contains_cache *cache)
 {
 	if (filter->with_commit_tag_algo)
-		return contains_tag_algo(commit, list, cache) == CONTAINS_YES;
+		return contains_tag_algo(commit, list, cache, NULL) == CONTAINS_YES;
 	return repo_is_descendant_of(the_repository, commit, list);
 }
 
+int commit_contains_bitmap(struct bitmap_index *bitmap_git,
+			   struct commit *commit, struct commit_list *list,
+			   struct contains_cache *cache)
+{
+	return contains_tag_algo(commit, list, cache, bitmap_git) == CONTAINS_YES;
+}
+
 int can_all_from_reach_with_flag(struct object_array *from,
 				 unsigned int with_flag,
 				 unsigned int assign_flag,
@@ -814,6 +875,45 @@ int can_all_from_reach_with_flag(struct object_array *from,
 	return result;
 }
 
+/*
+ * Try to answer can_all_from_reach() from the reachability index of
+ * the commit-graph alone. Returns -1 if some pair needs a walk.
+ */
+static int can_all_from_reach_index(struct repository *r,
+				    struct commit_list *from,
+				    struct commit_list *to)
+{
+	struct commit_list *from_iter, *to_iter;
+	size_t pairs = 0;
+
+	for (from_iter = from; from_iter; from_iter = from_iter->next)
+		for (to_iter = to; to_iter; to_iter = to_iter->next)
+			if (++pairs > 65536)
+				return -1;
+
+	for (from_iter = from; from_iter; from_iter = from_iter->next) {
+		int found = 0;
+
+		if (repo_parse_commit(r, from_iter->item))
+			return -1;
+		for (to_iter = to; to_iter && found <= 0; to_iter = to_iter->next) {
+			int reach;
+
+			if (repo_parse_commit(r, to_iter->item))
+				return -1;
+			reach = commit_graph_can_reach(r, from_iter->item,
+						       to_iter->item);
+			if (reach > 0 || (reach < 0 && !found))
+				found = reach;
+		}
+		if (!found)
+			return 0;
+		if (found < 0)
+			return -1;
+	}
+	return 1;
+}
+
 int can_all_from_reach(struct commit_list *from, struct commit_list *to,
 		       int cutoff_by_min_date)
 {
@@ -823,6 +923,10 @@ int can_all_from_reach(struct commit_list *from, struct commit_list *to,
 	int result;
 	timestamp_t min_generation = GENERATION_NUMBER_INFINITY;
 
+	result = can_all_from_reach_index(the_repository, from, to);
+	if (result >= 0)
+		return result;
+
 	while (from_iter) {
 		add_object_array(&from_iter->item->object, NULL, &from_objs);
 
@@ -942,3 +1046,204 @@ struct commit_list *get_reachable_subset(struct commit **from, int nr_from,
 
 	return found_commits;
 }
+
+/*
+ * Per-commit state for ahead_behind(): the set of input commits that
+ * can reach this commit and, for commits that are not covered by the
+ * commit-graph, a generation number larger than that of every parent.
+ */
+struct ahead_behind_data {
+	struct bitmap *reached_from;
+	timestamp_t generation;
+};
+
+define_commit_slab(ahead_behind_slab, struct ahead_behind_data);
+
+static timestamp_t known_generation(struct repository *r,
+				    struct ahead_behind_slab *slab,
+				    struct commit *c)
+{
+	struct ahead_behind_data *data = ahead_behind_slab_at(slab, c);
+	timestamp_t generation;
+
+	if (data->generation)
+		return data->generation;
+
+	repo_parse_commit(r, c);
+	generation = commit_graph_generation(c);
+	if (generation == GENERATION_NUMBER_INFINITY)
+		return 0;
+	return data->generation = generation;
+}
+
+/*
+ * The walk in ahead_behind() must visit every commit after all of
+ * its descendants that are part of the walk. Generation numbers from
+ * the commit-graph give us that order; for commits outside of the
+ * commit-graph, compute a substitute by walking down until we reach
+ * commits with a known generation (or the roots).
+ */
+static void fill_ahead_behind_generations(struct repository *r,
+					  struct ahead_behind_slab *slab,
+					  struct commit **commits, size_t nr)
+{
+	struct commit_list *stack = NULL;
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		if (!known_generation(r, slab, commits[i]))
+			commit_list_insert(commits[i], &stack);
+
+	while (stack) {
+		struct commit *c = stack->item;
+		struct commit_list *p;
+		timestamp_t max_generation = 0;
+		int all_known = 1;
+
+		if (ahead_behind_slab_at(slab, c)->generation) {
+			pop_commit(&stack);
+			continue;
+		}
+
+		for (p = c->parents; p; p = p->next) {
+			timestamp_t generation = known_generation(r, slab, p->item);
+
+			if (!generation) {
+				all_known = 0;
+				commit_list_insert(p->item, &stack);
+			} else if (generation > max_generation) {
+				max_generation = generation;
+			}
+		}
+
+		if (all_known) {
+			ahead_behind_slab_at(slab, c)->generation = max_generation + 1;
+			pop_commit(&stack);
+		}
+	}
+}
+
+static timestamp_t ahead_behind_generation(struct ahead_behind_slab *slab,
+					   const struct commit *c)
+{
+	struct ahead_behind_data *data = ahead_behind_slab_peek(slab, c);
+
+	if (data && data->generation)
+		return data->generation;
+	return commit_graph_generation(c);
+}
+
+static int compare_ahead_behind_generation(const void *a_, const void *b_,
+					   void *cb_data)
+{
+	struct ahead_behind_slab *slab = cb_data;
+	timestamp_t generation_a = ahead_behind_generation(slab, a_);
+	timestamp_t generation_b = ahead_behind_generation(slab, b_);
+
+	if (generation_a < generation_b)
+		return 1;
+	if (generation_a > generation_b)
+		return -1;
+	return compare_commits_by_commit_date(a_, b_, NULL);
+}
+
+static struct bitmap *get_reached_from(struct ahead_behind_slab *slab,
+				       struct commit *c, size_t width)
+{
+	struct ahead_behind_data *data = ahead_behind_slab_at(slab, c);
+
+	if (!data->reached_from)
+		data->reached_from = bitmap_word_alloc(width);
+	return data->reached_from;
+}
+
+void ahead_behind(struct repository *r,
+		  struct commit **commits, size_t commits_nr,
+		  struct ahead_behind_count *counts, size_t counts_nr)
+{
+	struct ahead_behind_slab slab;
+	struct prio_queue queue = {
+		.compare = compare_ahead_behind_generation,
+		.cb_data = &slab,
+	};
+	size_t width = DIV_ROUND_UP(commits_nr, BITS_IN_EWORD);
+	size_t i;
+
+	for (i = 0; i < counts_nr; i++) {
+		counts[i].ahead = 0;
+		counts[i].behind = 0;
+	}
+
+	if (!commits_nr || !counts_nr)
+		return;
+
+	init_ahead_behind_slab(&slab);
+	fill_ahead_behind_generations(r, &slab, commits, commits_nr);
+
+	trace2_region_enter("commit-reach", "ahead_behind", r);
+
+	for (i = 0; i < commits_nr; i++) {
+		struct commit *c = commits[i];
+
+		bitmap_set(get_reached_from(&slab, c, width), i);
+		if (!(c->object.flags & PARENT2)) {
+			c->object.flags |= PARENT2;
+			prio_queue_put(&queue, c);
+		}
+	}
+
+	while (queue_has_nonstale(&queue)) {
+		struct commit *c = prio_queue_get(&queue);
+		struct bitmap *reached_c = get_reached_from(&slab, c, width);
+		struct commit_list *p;
+
+		for (i = 0; i < counts_nr; i++) {
+			int from_tip = bitmap_get(reached_c, counts[i].tip_index);
+			int from_base = bitmap_get(reached_c, counts[i].base_index);
+
+			if (from_tip && !from_base)
+				counts[i].ahead++;
+			else if (from_base && !from_tip)
+				counts[i].behind++;
+		}
+
+		for (p = c->parents; p; p = p->next) {
+			struct bitmap *reached_p;
+
+			if (repo_parse_commit(r, p->item))
+				continue;
+
+			reached_p = get_reached_from(&slab, p->item, width);
+			bitmap_or(reached_p, reached_c);
+
+			/*
+			 * A commit that is reachable from every input commit
+			 * cannot contribute to any count, and neither can its
+			 * ancestors; mark it STALE so the walk can stop once
+			 * only such commits remain.
+			 */
+			if (bitmap_popcount(reached_p) == commits_nr)
+				p->item->object.flags |= STALE;
+
+			if (!(p->item->object.flags & PARENT2)) {
+				p->item->object.flags |= PARENT2;
+				prio_queue_put(&queue, p->item);
+			}
+		}
+
+		bitmap_free(reached_c);
+		ahead_behind_slab_at(&slab, c)->reached_from = NULL;
+	}
+
+	trace2_region_leave("commit-reach", "ahead_behind", r);
+
+	/* The queue may still hold STALE commits with their bitmaps. */
+	for (i = 0; i < queue.nr; i++) {
+		struct commit *c = queue.array[i].data;
+		bitmap_free(ahead_behind_slab_at(&slab, c)->reached_from);
+	}
+
+	clear_commit_marks_many((int)commits_nr, commits, PARENT2 | STALE);
+	clear_ahead_behind_slab(&slab);
+	clear_prio_queue(&queue);
+}
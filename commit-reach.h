@@ -4,6 +4,7 @@
 #include "commit.h"
 #include "commit-slab.h"
 
+struct bitmap_index;
 struct commit_list;
 struct ref_filter;
 struct object_id;
@@ -76,6 +77,16 @@ define_commit_slab(contains_cache, enum contains_result);
 int commit_contains(struct ref_filter *filter, struct commit *commit,
 		    struct commit_list *list, struct contains_cache *cache);
 
+/*
+ * Like commit_contains(), but stop the walk at commits that have a
+ * stored reachability bitmap and answer from the bitmap instead. Falls
+ * back to walking (with generation number pruning) from commits that
+ * are not covered by the bitmap.
+ */
+int commit_contains_bitmap(struct bitmap_index *bitmap_git,
+			   struct commit *commit, struct commit_list *list,
+			   struct contains_cache *cache);
+
 /*
  * Determine if every commit in 'from' can reach at least one commit
  * that is marked with 'with_flag'. As we traverse, use 'assign_flag'
@@ -104,4 +115,36 @@ struct commit_list *get_reachable_subset(struct commit **from, int nr_from,
 					 struct commit **to, int nr_to,
 					 unsigned int reachable_flag);
 
+struct ahead_behind_count {
+	/*
+	 * As input, 'tip_index' and 'base_index' select the positions in
+	 * the 'commits' array passed to ahead_behind() that form this
+	 * comparison.
+	 */
+	size_t tip_index;
+	size_t base_index;
+
+	/*
+	 * As output, 'ahead' is the number of commits reachable from the
+	 * tip but not from the base, and 'behind' is the number of commits
+	 * reachable from the base but not from the tip.
+	 */
+	unsigned int ahead;
+	unsigned int behind;
+};
+
+/*
+ * Compute the ahead/behind counts for every tip/base pair in 'counts',
+ * using a single walk over the commits reachable from 'commits'. Each
+ * visited commit carries a bitset of the input commits that can reach
+ * it, and the walk stops once every remaining commit is reachable from
+ * all of them.
+ *
+ * This method uses the PARENT2 and STALE flags during its operation,
+ * so be sure these flags are not set before calling the method.
+ */
+void ahead_behind(struct repository *r,
+		  struct commit **commits, size_t commits_nr,
+		  struct ahead_behind_count *counts, size_t counts_nr);
+
 #endif
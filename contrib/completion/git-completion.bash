@@ -1448,7 +1448,7 @@ _git_bisect ()
 	esac
 }
 
-__git_ref_fieldlist="refname objecttype objectsize objectname upstream push HEAD symref"
+__git_ref_fieldlist="refname objecttype objectsize objectname upstream push HEAD symref ahead-behind"
 
 _git_branch ()
 {
@@ -1704,7 +1704,7 @@ _git_describe ()
 	__git_complete_refs
 }
 
-__git_diff_algorithms="myers minimal patience histogram"
+__git_diff_algorithms="myers minimal patience histogram bounded"
 
 __git_diff_submodule_formats="diff log short"
 
@@ -1402,38 +1402,46 @@ const char *get_convert_attr_ascii(struct index_state *istate, const char *path)
 	return "";
 }
 
-int convert_to_git(struct index_state *istate,
-		   const char *path, const char *src, size_t len,
-		   struct strbuf *dst, int conv_flags)
+int convert_to_git_ca(struct index_state *istate,
+		      const struct conv_attrs *ca,
+		      const char *path, const char *src, size_t len,
+		      struct strbuf *dst, int conv_flags)
 {
 	int ret = 0;
-	struct conv_attrs ca;
 
-	convert_attrs(istate, &ca, path);
-
-	ret |= apply_filter(path, src, len, -1, dst, ca.drv, CAP_CLEAN, NULL, NULL);
-	if (!ret && ca.drv && ca.drv->required)
-		die(_("%s: clean filter '%s' failed"), path, ca.drv->name);
+	ret |= apply_filter(path, src, len, -1, dst, ca->drv, CAP_CLEAN, NULL, NULL);
+	if (!ret && ca->drv && ca->drv->required)
+		die(_("%s: clean filter '%s' failed"), path, ca->drv->name);
 
 	if (ret && dst) {
 		src = dst->buf;
 		len = dst->len;
 	}
 
-	ret |= encode_to_git(path, src, len, dst, ca.working_tree_encoding, conv_flags);
+	ret |= encode_to_git(path, src, len, dst, ca->working_tree_encoding, conv_flags);
 	if (ret && dst) {
 		src = dst->buf;
 		len = dst->len;
 	}
 
 	if (!(conv_flags & CONV_EOL_KEEP_CRLF)) {
-		ret |= crlf_to_git(istate, path, src, len, dst, ca.crlf_action, conv_flags);
+		ret |= crlf_to_git(istate, path, src, len, dst, ca->crlf_action, conv_flags);
 		if (ret && dst) {
 			src = dst->buf;
 			len = dst->len;
 		}
 	}
-	return ret | ident_to_git(src, len, dst, ca.ident);
+	return ret | ident_to_git(src, len, dst, ca->ident);
+}
+
+int convert_to_git(struct index_state *istate,
+		   const char *path, const char *src, size_t len,
+		   struct strbuf *dst, int conv_flags)
+{
+	struct conv_attrs ca;
+
+	convert_attrs(istate, &ca, path);
+	return convert_to_git_ca(istate, &ca, path, src, len, dst, conv_flags);
 }
 
 void convert_to_git_filter_fd(struct index_state *istate,
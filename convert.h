@@ -99,6 +99,10 @@ const char *get_convert_attr_ascii(struct index_state *istate,
 int convert_to_git(struct index_state *istate,
 		   const char *path, const char *src, size_t len,
 		   struct strbuf *dst, int conv_flags);
+int convert_to_git_ca(struct index_state *istate,
+		      const struct conv_attrs *ca,
+		      const char *path, const char *src, size_t len,
+		      struct strbuf *dst, int conv_flags);
 int convert_to_working_tree_ca(const struct conv_attrs *ca,
 			       const char *path, const char *src,
 			       size_t len, struct strbuf *dst,
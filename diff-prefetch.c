@@ -0,0 +1,390 @@
+#include "cache.h"
+#include "diff.h"
+#include "diff-prefetch.h"
+#include "diffcore.h"
+#include "object-store.h"
+#include "thread-utils.h"
+#include "trace2.h"
+
+/*
+ * One call of the change() or add_remove() callback of diff_options,
+ * recorded by a worker. For add_remove(), only the "new_*" fields are
+ * used and "addremove" is '+' or '-'; it is 0 for change().
+ */
+struct prefetch_change {
+	int addremove;
+	unsigned old_mode, new_mode;
+	struct object_id old_oid, new_oid;
+	int old_oid_valid, new_oid_valid;
+	unsigned old_dirty_submodule, new_dirty_submodule;
+	char *path;
+
+	/* blob contents read by the worker, if any */
+	void *old_data, *new_data;
+	unsigned long old_size, new_size;
+};
+
+struct prefetch_job {
+	struct object_id old_oid, new_oid;
+	unsigned has_old:1,
+		 done:1;
+
+	struct prefetch_change *changes;
+	size_t changes_nr, changes_alloc;
+
+	struct prefetch_job *next;
+};
+
+struct diff_prefetch {
+	struct diff_options opt;
+	int want_blobs;
+
+	pthread_t *threads;
+	int nr_threads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond; /* a job was queued, or shutting down */
+	pthread_cond_t done_cond; /* a job was done */
+
+	/* all jobs not replayed yet, and the first one not started yet */
+	struct prefetch_job *head, *tail, *todo;
+	int shutdown;
+
+	int nr_replayed;
+};
+
+static struct prefetch_change *record(struct diff_options *opt,
+				      const char *concatpath)
+{
+	struct prefetch_job *job = opt->change_fn_data;
+	struct prefetch_change *c;
+
+	ALLOC_GROW(job->changes, job->changes_nr + 1, job->changes_alloc);
+	c = &job->changes[job->changes_nr++];
+	memset(c, 0, sizeof(*c));
+	c->path = xstrdup(concatpath);
+	return c;
+}
+
+static void record_change(struct diff_options *opt,
+			  unsigned old_mode, unsigned new_mode,
+			  const struct object_id *old_oid,
+			  const struct object_id *new_oid,
+			  int old_oid_valid, int new_oid_valid,
+			  const char *concatpath,
+			  unsigned old_dirty_submodule,
+			  unsigned new_dirty_submodule)
+{
+	struct prefetch_change *c = record(opt, concatpath);
+
+	c->old_mode = old_mode;
+	c->new_mode = new_mode;
+	oidcpy(&c->old_oid, old_oid);
+	oidcpy(&c->new_oid, new_oid);
+	c->old_oid_valid = old_oid_valid;
+	c->new_oid_valid = new_oid_valid;
+	c->old_dirty_submodule = old_dirty_submodule;
+	c->new_dirty_submodule = new_dirty_submodule;
+}
+
+static void record_addremove(struct diff_options *opt,
+			     int addremove, unsigned mode,
+			     const struct object_id *oid,
+			     int oid_valid,
+			     const char *concatpath,
+			     unsigned dirty_submodule)
+{
+	struct prefetch_change *c = record(opt, concatpath);
+
+	c->addremove = addremove;
+	c->new_mode = mode;
+	oidcpy(&c->new_oid, oid);
+	c->new_oid_valid = oid_valid;
+	c->new_dirty_submodule = dirty_submodule;
+}
+
+/*
+ * Read a blob the way diff_populate_filespec() would, but leave blobs
+ * it would only look at the size of, and anything that is not a plain
+ * blob, to the main thread.
+ */
+static void *read_blob(struct repository *r, unsigned mode,
+		       const struct object_id *oid, int oid_valid,
+		       unsigned long *size)
+{
+	struct object_info oi = OBJECT_INFO_INIT;
+	void *data;
+
+	if (!oid_valid || !(S_ISREG(mode) || S_ISLNK(mode)))
+		return NULL;
+
+	oi.sizep = size;
+	if (oid_object_info_extended(r, oid, &oi,
+				     OBJECT_INFO_LOOKUP_REPLACE |
+				     OBJECT_INFO_SKIP_FETCH_OBJECT) ||
+	    *size > big_file_threshold)
+		return NULL;
+
+	oi.contentp = &data;
+	if (oid_object_info_extended(r, oid, &oi,
+				     OBJECT_INFO_LOOKUP_REPLACE |
+				     OBJECT_INFO_SKIP_FETCH_OBJECT))
+		return NULL;
+	return data;
+}
+
+static void read_blobs(struct repository *r, struct prefetch_job *job)
+{
+	size_t i;
+
+	for (i = 0; i < job->changes_nr; i++) {
+		struct prefetch_change *c = &job->changes[i];
+
+		if (!c->addremove) {
+			/* unchanged paths from --find-copies-harder */
+			if (c->old_mode == c->new_mode &&
+			    oideq(&c->old_oid, &c->new_oid))
+				continue;
+			c->old_data = read_blob(r, c->old_mode, &c->old_oid,
+						c->old_oid_valid, &c->old_size);
+		}
+		c->new_data = read_blob(r, c->new_mode, &c->new_oid,
+					c->new_oid_valid, &c->new_size);
+	}
+}
+
+static void *prefetch_worker(void *data)
+{
+	struct diff_prefetch *p = data;
+	struct diff_options opt = p->opt;
+
+	opt.change = record_change;
+	opt.add_remove = record_addremove;
+
+	pthread_mutex_lock(&p->mutex);
+	for (;;) {
+		struct prefetch_job *job;
+
+		while (!p->todo && !p->shutdown)
+			pthread_cond_wait(&p->work_cond, &p->mutex);
+		if (p->shutdown)
+			break;
+
+		job = p->todo;
+		p->todo = job->next;
+		pthread_mutex_unlock(&p->mutex);
+
+		opt.change_fn_data = job;
+		diff_tree_oid(job->has_old ? &job->old_oid : NULL,
+			      &job->new_oid, "", &opt);
+		if (p->want_blobs)
+			read_blobs(opt.repo, job);
+
+		pthread_mutex_lock(&p->mutex);
+		job->done = 1;
+		pthread_cond_broadcast(&p->done_cond);
+	}
+	pthread_mutex_unlock(&p->mutex);
+
+	return NULL;
+}
+
+struct diff_prefetch *diff_prefetch_start(struct diff_options *opt,
+					  int nr_threads, int want_blobs)
+{
+	struct diff_prefetch *p;
+	int i;
+
+	if (!HAVE_THREADS || nr_threads < 1)
+		BUG("diff_prefetch_start() needs threads");
+
+	CALLOC_ARRAY(p, 1);
+	p->opt = *opt;
+	p->want_blobs = want_blobs;
+	pthread_mutex_init(&p->mutex, NULL);
+	pthread_cond_init(&p->work_cond, NULL);
+	pthread_cond_init(&p->done_cond, NULL);
+
+	enable_obj_read_lock();
+
+	CALLOC_ARRAY(p->threads, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&p->threads[i], NULL, prefetch_worker, p)) {
+			warning(_("unable to create diff prefetch thread"));
+			break;
+		}
+		p->nr_threads++;
+	}
+	if (!p->nr_threads) {
+		diff_prefetch_finish(p);
+		return NULL;
+	}
+
+	trace2_data_intmax("diff", opt->repo, "prefetch/threads", p->nr_threads);
+	return p;
+}
+
+void diff_prefetch_add(struct diff_prefetch *p,
+		       const struct object_id *old_oid,
+		       const struct object_id *new_oid)
+{
+	struct prefetch_job *job;
+
+	CALLOC_ARRAY(job, 1);
+	if (old_oid) {
+		oidcpy(&job->old_oid, old_oid);
+		job->has_old = 1;
+	}
+	oidcpy(&job->new_oid, new_oid);
+
+	pthread_mutex_lock(&p->mutex);
+	if (p->tail)
+		p->tail->next = job;
+	else
+		p->head = job;
+	p->tail = job;
+	if (!p->todo)
+		p->todo = job;
+	pthread_cond_signal(&p->work_cond);
+	pthread_mutex_unlock(&p->mutex);
+}
+
+static void free_job(struct prefetch_job *job)
+{
+	size_t i;
+
+	for (i = 0; i < job->changes_nr; i++) {
+		free(job->changes[i].path);
+		free(job->changes[i].old_data);
+		free(job->changes[i].new_data);
+	}
+	free(job->changes);
+	free(job);
+}
+
+static int job_matches(struct prefetch_job *job,
+		       const struct object_id *old_oid,
+		       const struct object_id *new_oid)
+{
+	if (!oideq(&job->new_oid, new_oid))
+		return 0;
+	if (!old_oid)
+		return !job->has_old;
+	return job->has_old && oideq(&job->old_oid, old_oid);
+}
+
+static void attach_blob(struct diff_filespec *s,
+			const struct object_id *oid,
+			void **data, unsigned long size)
+{
+	if (!*data || s->data || !s->oid_valid || !oideq(&s->oid, oid))
+		return;
+
+	s->data = *data;
+	s->size = size;
+	s->should_free = 1;
+	*data = NULL;
+}
+
+static void replay_change(struct diff_options *opt, struct prefetch_change *c)
+{
+	int nr = diff_queued_diff.nr;
+	struct diff_filepair *pair;
+
+	if (c->addremove)
+		opt->add_remove(opt, c->addremove, c->new_mode,
+				&c->new_oid, c->new_oid_valid, c->path,
+				c->new_dirty_submodule);
+	else
+		opt->change(opt, c->old_mode, c->new_mode,
+			    &c->old_oid, &c->new_oid,
+			    c->old_oid_valid, c->new_oid_valid, c->path,
+			    c->old_dirty_submodule, c->new_dirty_submodule);
+
+	if (diff_queued_diff.nr != nr + 1)
+		return;
+
+	/* the filespecs may have been swapped by --reverse */
+	pair = diff_queued_diff.queue[nr];
+	attach_blob(pair->one, &c->old_oid, &c->old_data, c->old_size);
+	attach_blob(pair->one, &c->new_oid, &c->new_data, c->new_size);
+	attach_blob(pair->two, &c->new_oid, &c->new_data, c->new_size);
+	attach_blob(pair->two, &c->old_oid, &c->old_data, c->old_size);
+}
+
+int diff_prefetch_replay(struct diff_prefetch *p,
+			 const struct object_id *old_oid,
+			 const struct object_id *new_oid,
+			 struct diff_options *opt)
+{
+	struct prefetch_job *job, *skipped;
+	size_t i;
+
+	pthread_mutex_lock(&p->mutex);
+	for (job = p->head; job; job = job->next)
+		if (job_matches(job, old_oid, new_oid))
+			break;
+	if (!job) {
+		pthread_mutex_unlock(&p->mutex);
+		return 0;
+	}
+
+	/* the jobs before this one may still be running, too */
+	for (skipped = p->head; ; skipped = skipped->next) {
+		while (!skipped->done)
+			pthread_cond_wait(&p->done_cond, &p->mutex);
+		if (skipped == job)
+			break;
+	}
+
+	skipped = p->head;
+	p->head = job->next;
+	if (!p->head)
+		p->tail = NULL;
+	while (skipped != job) {
+		struct prefetch_job *next = skipped->next;
+		free_job(skipped);
+		skipped = next;
+	}
+	pthread_mutex_unlock(&p->mutex);
+
+	for (i = 0; i < job->changes_nr; i++)
+		replay_change(opt, &job->changes[i]);
+	free_job(job);
+
+	p->nr_replayed++;
+	return 1;
+}
+
+void diff_prefetch_finish(struct diff_prefetch *p)
+{
+	int i;
+
+	if (!p)
+		return;
+
+	if (p->nr_threads)
+		trace2_data_intmax("diff", p->opt.repo, "prefetch/replayed",
+				   p->nr_replayed);
+
+	pthread_mutex_lock(&p->mutex);
+	p->shutdown = 1;
+	pthread_cond_broadcast(&p->work_cond);
+	pthread_mutex_unlock(&p->mutex);
+
+	for (i = 0; i < p->nr_threads; i++)
+		pthread_join(p->threads[i], NULL);
+	free(p->threads);
+
+	while (p->head) {
+		struct prefetch_job *next = p->head->next;
+		free_job(p->head);
+		p->head = next;
+	}
+
+	disable_obj_read_lock();
+	pthread_cond_destroy(&p->done_cond);
+	pthread_cond_destroy(&p->work_cond);
+	pthread_mutex_destroy(&p->mutex);
+	free(p);
+}
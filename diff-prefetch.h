@@ -0,0 +1,49 @@
+#ifndef DIFF_PREFETCH_H
+#define DIFF_PREFETCH_H
+
+struct diff_options;
+struct object_id;
+struct diff_prefetch;
+
+/*
+ * Compute tree diffs, and read the blobs they touch, in a pool of
+ * worker threads ahead of the caller.
+ *
+ * The workers only walk trees and read objects. Everything else that
+ * diff_tree_oid() would do (filtering by --relative or ignored
+ * submodules, queueing filepairs), and all of diffcore and the output,
+ * still happens in the calling thread when the diff is replayed.
+ */
+
+/*
+ * Start "nr_threads" workers that compute tree diffs with the options
+ * in "opt". The caller must not change the pathspec or flags in "opt"
+ * until diff_prefetch_finish() is called. "want_blobs" asks for the
+ * contents of the blobs of changed paths to be read as well.
+ */
+struct diff_prefetch *diff_prefetch_start(struct diff_options *opt,
+					  int nr_threads, int want_blobs);
+
+/*
+ * Queue the tree diff between "old_oid" (NULL for a root commit) and
+ * "new_oid". Diffs must be queued in the order they will be replayed.
+ */
+void diff_prefetch_add(struct diff_prefetch *p,
+		       const struct object_id *old_oid,
+		       const struct object_id *new_oid);
+
+/*
+ * Replay a queued diff into "opt", as if diff_tree_oid() had been called
+ * with an empty base. Waits for the workers if needed. Queued diffs
+ * before this one that were never asked for are dropped. Returns 0
+ * without touching "opt" if this diff was not queued.
+ */
+int diff_prefetch_replay(struct diff_prefetch *p,
+			 const struct object_id *old_oid,
+			 const struct object_id *new_oid,
+			 struct diff_options *opt);
+
+/* Stop the workers and drop the queued diffs. */
+void diff_prefetch_finish(struct diff_prefetch *p);
+
+#endif /* DIFF_PREFETCH_H */
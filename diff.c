@@ -29,6 +29,9 @@
 #include "promisor-remote.h"
 #include "dir.h"
 #include "strmap.h"
+#include "thread-utils.h"
+#include "trace2.h"
+#include "streaming.h"
 
 #ifdef NO_FAST_WORKING_DIRECTORY
 #define FAST_WORKING_DIRECTORY 0
@@ -39,6 +42,8 @@
 static int diff_detect_rename_default;
 static int diff_indent_heuristic = 1;
 static int diff_rename_limit_default = 1000;
+static int diff_threads_default;
+static unsigned long diff_stream_threshold;
 static int diff_suppress_blank_empty;
 static int diff_use_color_default = -1;
 static int diff_color_moved_default;
@@ -209,6 +214,8 @@ long parse_algorithm_value(const char *value)
 		return XDF_PATIENCE_DIFF;
 	else if (!strcasecmp(value, "histogram"))
 		return XDF_HISTOGRAM_DIFF;
+	else if (!strcasecmp(value, "bounded"))
+		return XDF_BOUNDED_DIFF;
 	/*
 	 * Please update $__git_diff_algorithms in git-completion.bash
 	 * when you add new algorithms.
@@ -437,6 +444,19 @@ int git_diff_basic_config(const char *var, const char *value, void *cb)
 		return 0;
 	}
 
+	if (!strcmp(var, "diff.threads")) {
+		diff_threads_default = git_config_int(var, value);
+		if (diff_threads_default < 0)
+			die(_("invalid number of threads specified (%d) for %s"),
+			    diff_threads_default, var);
+		return 0;
+	}
+
+	if (!strcmp(var, "diff.streamthreshold")) {
+		diff_stream_threshold = git_config_ulong(var, value);
+		return 0;
+	}
+
 	if (userdiff_config(var, value) < 0)
 		return -1;
 
@@ -1104,9 +1124,13 @@ static int adjust_last_block(struct diff_options *o, int n, int block_length)
 	return 0;
 }
 
-/* Find blocks of moved code, delegate actual coloring decision to helper */
-static void mark_color_as_moved(struct diff_options *o,
-				struct moved_entry_list *entry_list)
+/*
+ * Find blocks of moved code among the symbols from "begin" up to but not
+ * including "end", delegate actual coloring decision to helper.
+ */
+static void mark_color_as_moved_range(struct diff_options *o,
+				      struct moved_entry_list *entry_list,
+				      int begin, int end)
 {
 	struct moved_block *pmb = NULL; /* potentially moved blocks */
 	int pmb_nr = 0, pmb_alloc = 0;
@@ -1114,7 +1138,7 @@ static void mark_color_as_moved(struct diff_options *o,
 	enum diff_symbol moved_symbol = DIFF_SYMBOL_BINARY_DIFF_HEADER;
 
 
-	for (n = 0; n < o->emitted_symbols->nr; n++) {
+	for (n = begin; n < end; n++) {
 		struct moved_entry *match = NULL;
 		struct emitted_diff_symbol *l = &o->emitted_symbols->buf[n];
 
@@ -1194,6 +1218,97 @@ static void mark_color_as_moved(struct diff_options *o,
 	free(pmb);
 }
 
+/*
+ * A block of moved lines never goes past a symbol that is neither a plus
+ * nor a minus line, and mark_color_as_moved_range() forgets all about
+ * the blocks before it once it has seen one. So the runs of lines in
+ * between can be looked at on their own, by several threads if there
+ * are enough of them.
+ */
+#define COLOR_MOVED_THREADS_MIN_SYMBOLS 1024
+
+struct color_moved_work {
+	struct diff_options *o;
+	struct moved_entry_list *entry_list;
+	/* the ith range starts at bounds[i] and ends at bounds[i + 1] */
+	int *bounds;
+	int nr, next;
+	pthread_mutex_t mutex;
+};
+
+static void *run_color_moved(void *arg)
+{
+	struct color_moved_work *w = arg;
+
+	trace2_thread_start("color-moved");
+	while (1) {
+		int i;
+
+		pthread_mutex_lock(&w->mutex);
+		i = w->next < w->nr ? w->next++ : -1;
+		pthread_mutex_unlock(&w->mutex);
+		if (i < 0)
+			break;
+		mark_color_as_moved_range(w->o, w->entry_list,
+					  w->bounds[i], w->bounds[i + 1]);
+	}
+	trace2_thread_exit();
+	return NULL;
+}
+
+static void mark_color_as_moved(struct diff_options *o,
+				struct moved_entry_list *entry_list)
+{
+	struct emitted_diff_symbols *esm = o->emitted_symbols;
+	int nr_threads = o->threads ? o->threads : online_cpus();
+	struct color_moved_work w = {
+		.o = o,
+		.entry_list = entry_list,
+	};
+	pthread_t *threads;
+	int i, n, range_size, bounds_alloc = 0;
+
+	if (!HAVE_THREADS || nr_threads < 2 ||
+	    o->color_moved == COLOR_MOVED_PLAIN ||
+	    esm->nr < COLOR_MOVED_THREADS_MIN_SYMBOLS) {
+		mark_color_as_moved_range(o, entry_list, 0, esm->nr);
+		return;
+	}
+
+	/* a few ranges per thread, each ending after a context line or header */
+	range_size = esm->nr / nr_threads / 4;
+	if (range_size < COLOR_MOVED_THREADS_MIN_SYMBOLS / 4)
+		range_size = COLOR_MOVED_THREADS_MIN_SYMBOLS / 4;
+	ALLOC_GROW(w.bounds, w.nr + 1, bounds_alloc);
+	w.bounds[w.nr] = 0;
+	for (n = range_size; n < esm->nr; n++) {
+		if (esm->buf[n - 1].s == DIFF_SYMBOL_PLUS ||
+		    esm->buf[n - 1].s == DIFF_SYMBOL_MINUS)
+			continue;
+		ALLOC_GROW(w.bounds, w.nr + 2, bounds_alloc);
+		w.bounds[++w.nr] = n;
+		n += range_size - 1;
+	}
+	ALLOC_GROW(w.bounds, w.nr + 2, bounds_alloc);
+	w.bounds[++w.nr] = esm->nr;
+
+	if (nr_threads > w.nr)
+		nr_threads = w.nr;
+	pthread_mutex_init(&w.mutex, NULL);
+	CALLOC_ARRAY(threads, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		int err = pthread_create(&threads[i], NULL, run_color_moved, &w);
+		if (err)
+			die(_("color-moved: failed to create thread: %s"),
+			    strerror(err));
+	}
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&w.mutex);
+	free(w.bounds);
+}
+
 static void dim_moved_lines(struct diff_options *o)
 {
 	int n;
@@ -3400,6 +3515,556 @@ static void add_formatted_headers(struct strbuf *msg,
 				     line_prefix, meta, reset);
 }
 
+static long diff_context_lines(struct diff_options *o)
+{
+	const char *diffopts = getenv("GIT_DIFF_OPTS");
+	const char *v;
+
+	if (!diffopts)
+		;
+	else if (skip_prefix(diffopts, "--unified=", &v))
+		return strtoul(v, NULL, 10);
+	else if (skip_prefix(diffopts, "-u", &v))
+		return strtoul(v, NULL, 10);
+	return o->context;
+}
+
+/*
+ * With diff.streamThreshold set, text files larger than it are not
+ * read into memory as a whole. Both sides are read a window of about
+ * diff.streamThreshold bytes at a time instead, from the object store
+ * with open_istream() or from the working tree, and xdiff compares the
+ * two windows. Everything up to the start of the last change in them
+ * is settled and is turned into unified diff lines for fn_out_consume(),
+ * just like the ones xdiff emits; the rest is compared again together
+ * with the next windows. Hunks that grow larger than a window are cut
+ * into several.
+ */
+struct stream_side {
+	struct git_istream *st;
+	int fd;
+	int eof;
+	struct strbuf buf;
+	/* offsets of the lines of the current window, and of its end */
+	size_t *line, line_nr, line_alloc;
+};
+
+struct stream_change {
+	long i1, chg1, i2, chg2;
+};
+
+struct stream_changes {
+	struct stream_change *change;
+	size_t nr, alloc;
+};
+
+struct stream_func_line {
+	long len;
+	char buf[80];
+};
+
+struct stream_emit {
+	struct emit_callback *ecbdata;
+	xdemitconf_t *xecfg;
+	long ctxlen, interhunkctxlen;
+	size_t max_hunk;
+	uintmax_t lno[2];
+	/* the last function line of the preimage before the hunks to come */
+	struct stream_func_line func;
+	/* the hunk being collected */
+	int in_hunk;
+	uintmax_t start[2], count[2];
+	long trailing;
+	struct stream_func_line hunk_func;
+	struct strbuf body;
+	/* common lines after the hunk, or before the next one */
+	struct strbuf gap;
+	long gap_nr;
+};
+
+static void stream_side_open(struct repository *r, struct stream_side *s,
+			     struct diff_filespec *spec)
+{
+	enum object_type type;
+	unsigned long size;
+
+	memset(s, 0, sizeof(*s));
+	s->fd = -1;
+	strbuf_init(&s->buf, 0);
+	if (!DIFF_FILE_VALID(spec)) {
+		s->eof = 1;
+	} else if (spec->oid_valid) {
+		/*
+		 * Streaming from a pack maps its windows without taking
+		 * the object read lock itself, but the diff prefetch
+		 * threads of "log" may be using the same packs.
+		 */
+		obj_read_lock();
+		s->st = open_istream(r, &spec->oid, &type, &size, NULL);
+		obj_read_unlock();
+		if (!s->st)
+			die(_("unable to read %s"), oid_to_hex(&spec->oid));
+	} else {
+		s->fd = open(spec->path, O_RDONLY);
+		if (s->fd < 0)
+			die_errno(_("could not open '%s'"), spec->path);
+	}
+}
+
+static void stream_side_close(struct stream_side *s)
+{
+	if (s->st) {
+		obj_read_lock();
+		close_istream(s->st);
+		obj_read_unlock();
+	}
+	if (s->fd >= 0)
+		close(s->fd);
+	strbuf_release(&s->buf);
+	free(s->line);
+}
+
+static void stream_side_fill(struct stream_side *s, size_t want)
+{
+	while (!s->eof && s->buf.len < want) {
+		ssize_t got;
+
+		strbuf_grow(&s->buf, want - s->buf.len);
+		if (s->st) {
+			obj_read_lock();
+			got = read_istream(s->st, s->buf.buf + s->buf.len,
+					   want - s->buf.len);
+			obj_read_unlock();
+		} else
+			got = xread(s->fd, s->buf.buf + s->buf.len,
+				    want - s->buf.len);
+		if (got < 0)
+			die_errno(_("unable to read files to diff"));
+		if (!got)
+			s->eof = 1;
+		else
+			strbuf_setlen(&s->buf, s->buf.len + got);
+	}
+}
+
+/*
+ * Read the next window of a side, which ends with the last complete
+ * line that fits, and find its lines. A line that is longer than the
+ * window makes the window larger.
+ */
+static void stream_side_window(struct stream_side *s, size_t want)
+{
+	size_t len, pos;
+
+	for (;;) {
+		stream_side_fill(s, want);
+		len = s->buf.len;
+		if (s->eof)
+			break;
+		while (len && s->buf.buf[len - 1] != '\n')
+			len--;
+		if (len)
+			break;
+		want = st_mult(s->buf.len, 2);
+	}
+
+	s->line_nr = 0;
+	for (pos = 0; pos < len; s->line_nr++) {
+		const char *eol = memchr(s->buf.buf + pos, '\n', len - pos);
+
+		ALLOC_GROW(s->line, s->line_nr + 2, s->line_alloc);
+		s->line[s->line_nr] = pos;
+		pos = eol ? eol - s->buf.buf + 1 : len;
+	}
+	ALLOC_GROW(s->line, s->line_nr + 1, s->line_alloc);
+	s->line[s->line_nr] = len;
+}
+
+/* the first window of a side is enough to guess whether it is binary */
+static int stream_side_is_binary(struct diff_filespec *spec,
+				 struct stream_side *s)
+{
+	if (!DIFF_FILE_VALID(spec) || spec->driver->binary != -1)
+		return 0;
+	return buffer_is_binary(s->buf.buf, s->buf.len);
+}
+
+static void stream_collect_change(void *data,
+				  long old_begin, long old_nr,
+				  long new_begin, long new_nr,
+				  const char *func, long funclen)
+{
+	struct stream_changes *changes = data;
+	struct stream_change *c;
+
+	ALLOC_GROW(changes->change, changes->nr + 1, changes->alloc);
+	c = &changes->change[changes->nr++];
+	c->i1 = old_nr ? old_begin - 1 : old_begin;
+	c->chg1 = old_nr;
+	c->i2 = new_nr ? new_begin - 1 : new_begin;
+	c->chg2 = new_nr;
+}
+
+/* like match_func_rec() in xdiff/xemit.c */
+static int stream_func_line(struct stream_emit *e, const char *line, size_t len)
+{
+	struct stream_func_line *f = &e->func;
+	long found;
+
+	if (len && line[len - 1] == '\n')
+		len--;
+	if (e->xecfg->find_func) {
+		found = e->xecfg->find_func(line, len, f->buf, sizeof(f->buf),
+					    e->xecfg->find_func_priv);
+	} else if (len && (isalpha((unsigned char)*line) ||
+			   *line == '_' || *line == '$')) {
+		found = len > sizeof(f->buf) ? sizeof(f->buf) : len;
+		while (found && isspace((unsigned char)line[found - 1]))
+			found--;
+		memcpy(f->buf, line, found);
+	} else {
+		found = -1;
+	}
+	if (found < 0)
+		return 0;
+	f->len = found;
+	return 1;
+}
+
+static void stream_add_line(struct strbuf *sb, char prefix,
+			    const char *line, size_t len)
+{
+	strbuf_addch(sb, prefix);
+	strbuf_add(sb, line, len);
+	if (!len || line[len - 1] != '\n')
+		strbuf_addstr(sb, "\n\\ No newline at end of file\n");
+}
+
+/* Take the first line off the gap, moving it to "into" if not NULL. */
+static void stream_drop_gap_line(struct stream_emit *e, struct strbuf *into)
+{
+	const char *eol = memchr(e->gap.buf, '\n', e->gap.len);
+	size_t len = eol - e->gap.buf + 1;
+
+	stream_func_line(e, e->gap.buf + 1, len - 1);
+	if (starts_with(e->gap.buf + len, "\\ "))
+		len += strchrnul(e->gap.buf + len, '\n') - (e->gap.buf + len) + 1;
+	if (into)
+		strbuf_add(into, e->gap.buf, len);
+	strbuf_remove(&e->gap, 0, len);
+	e->gap_nr--;
+}
+
+static void stream_append_range(struct strbuf *sb, uintmax_t start,
+				uintmax_t count)
+{
+	strbuf_addf(sb, "%"PRIuMAX, count ? start + 1 : start);
+	if (count != 1)
+		strbuf_addf(sb, ",%"PRIuMAX, count);
+}
+
+static void stream_flush_hunk(struct stream_emit *e)
+{
+	struct strbuf hdr = STRBUF_INIT;
+	char *line = e->body.buf, *end = e->body.buf + e->body.len;
+
+	strbuf_addstr(&hdr, "@@ -");
+	stream_append_range(&hdr, e->start[0], e->count[0]);
+	strbuf_addstr(&hdr, " +");
+	stream_append_range(&hdr, e->start[1], e->count[1]);
+	strbuf_addstr(&hdr, " @@");
+	if (e->hunk_func.len) {
+		strbuf_addch(&hdr, ' ');
+		strbuf_add(&hdr, e->hunk_func.buf, e->hunk_func.len);
+	}
+	strbuf_addch(&hdr, '\n');
+	fn_out_consume(e->ecbdata, hdr.buf, hdr.len);
+	strbuf_release(&hdr);
+
+	while (line < end) {
+		char *eol = memchr(line, '\n', end - line);
+
+		fn_out_consume(e->ecbdata, line, eol - line + 1);
+		line = eol + 1;
+	}
+	strbuf_reset(&e->body);
+	e->in_hunk = 0;
+}
+
+static void stream_common(struct stream_emit *e, const char *line, size_t len)
+{
+	e->lno[0]++;
+	e->lno[1]++;
+	if (e->in_hunk && e->trailing < e->ctxlen) {
+		stream_add_line(&e->body, ' ', line, len);
+		stream_func_line(e, line, len);
+		e->count[0]++;
+		e->count[1]++;
+		e->trailing++;
+		return;
+	}
+	stream_add_line(&e->gap, ' ', line, len);
+	e->gap_nr++;
+	if (e->in_hunk) {
+		if (e->gap_nr <= e->ctxlen + e->interhunkctxlen)
+			return;
+		stream_flush_hunk(e);
+	}
+	while (e->gap_nr > e->ctxlen)
+		stream_drop_gap_line(e, NULL);
+}
+
+static void stream_changed(struct stream_emit *e, int side,
+			   const char *line, size_t len)
+{
+	if (!e->in_hunk) {
+		e->in_hunk = 1;
+		e->start[0] = e->lno[0] - e->gap_nr;
+		e->start[1] = e->lno[1] - e->gap_nr;
+		e->count[0] = e->count[1] = 0;
+		e->hunk_func = e->func;
+	}
+	if (e->gap_nr) {
+		e->count[0] += e->gap_nr;
+		e->count[1] += e->gap_nr;
+		while (e->gap_nr)
+			stream_drop_gap_line(e, &e->body);
+	}
+	e->trailing = 0;
+	stream_add_line(&e->body, side ? '+' : '-', line, len);
+	if (!side)
+		stream_func_line(e, line, len);
+	e->lno[side]++;
+	e->count[side]++;
+
+	/* a change that does not fit is shown as several hunks */
+	if (e->body.len > e->max_hunk)
+		stream_flush_hunk(e);
+}
+
+/* Emit the lines of a window pair up to line a of one and b of two. */
+static void stream_emit_range(struct stream_emit *e, struct stream_side *s,
+			      const struct stream_change *c, size_t c_nr,
+			      long a, long b)
+{
+	long i1 = 0, i2 = 0;
+	size_t i;
+
+#define STREAM_LINE(side, n) (s)[side].buf.buf + (s)[side].line[n], \
+	(s)[side].line[(n) + 1] - (s)[side].line[n]
+
+	for (i = 0; i <= c_nr; i++) {
+		long end1 = i < c_nr ? c[i].i1 : a;
+		long end2 = i < c_nr ? c[i].i2 : b;
+
+		if (end1 - i1 != end2 - i2)
+			BUG("streaming diff lost track of common lines");
+		/* context lines come from the postimage, like in xdiff */
+		while (i2 < end2) {
+			if (!e->in_hunk && end2 - i2 > e->ctxlen) {
+				long skip = end2 - i2 - e->ctxlen, j;
+
+				while (e->gap_nr)
+					stream_drop_gap_line(e, NULL);
+				for (j = i1 + skip - 1; j >= i1; j--)
+					if (stream_func_line(e, STREAM_LINE(0, j)))
+						break;
+				e->lno[0] += skip;
+				e->lno[1] += skip;
+				i1 += skip;
+				i2 += skip;
+				continue;
+			}
+			stream_common(e, STREAM_LINE(1, i2));
+			i1++;
+			i2++;
+		}
+		if (i == c_nr)
+			break;
+		for (; i1 < c[i].i1 + c[i].chg1; i1++)
+			stream_changed(e, 0, STREAM_LINE(0, i1));
+		for (; i2 < c[i].i2 + c[i].chg2; i2++)
+			stream_changed(e, 1, STREAM_LINE(1, i2));
+	}
+#undef STREAM_LINE
+}
+
+static int want_stream_diff(struct diff_options *o,
+			    struct diff_filespec *one,
+			    struct diff_filespec *two)
+{
+	struct diff_populate_filespec_options dpf_options = {
+		.check_size_only = 1,
+	};
+	struct diff_filespec *spec[2] = { one, two };
+	int i, large = 0;
+
+	if (!diff_stream_threshold || o->flags.binary || o->word_diff ||
+	    o->color_moved || o->flags.funccontext ||
+	    o->ignore_regex_nr || (o->xdl_opts & XDF_IGNORE_BLANK_LINES))
+		return 0;
+
+	for (i = 0; i < 2; i++) {
+		struct diff_filespec *s = spec[i];
+
+		if (!DIFF_FILE_VALID(s))
+			continue;
+		if (!S_ISREG(s->mode) || s->data)
+			return 0;
+		diff_filespec_load_driver(s, o->repo->index);
+		if (s->driver->binary == 1 && !o->flags.text)
+			return 0;
+		/* we cannot stream files through convert_to_git() */
+		if (!s->oid_valid &&
+		    would_convert_to_git(o->repo->index, s->path))
+			return 0;
+		if (diff_populate_filespec(o->repo, s, &dpf_options))
+			return 0;
+		if (s->size > diff_stream_threshold)
+			large = 1;
+	}
+	return large;
+}
+
+static void builtin_diff_stream(struct diff_options *o,
+				struct diff_filespec *one,
+				struct diff_filespec *two,
+				const char **lbl,
+				struct strbuf *header,
+				int must_show_header,
+				const char *name_b)
+{
+	size_t window = diff_stream_threshold;
+	struct stream_side side[2];
+	struct stream_changes changes = { 0 };
+	struct stream_emit e = { 0 };
+	struct emit_callback ecbdata;
+	const struct userdiff_funcname *pe;
+	xpparam_t xpp;
+	xdemitconf_t xecfg;
+	int degraded = 0;
+
+	if (DIFF_FILE_VALID(one) && DIFF_FILE_VALID(two) &&
+	    one->oid_valid && two->oid_valid && oideq(&one->oid, &two->oid)) {
+		if (must_show_header)
+			emit_diff_symbol(o, DIFF_SYMBOL_HEADER,
+					 header->buf, header->len, 0);
+		return;
+	}
+
+	stream_side_open(o->repo, &side[0], one);
+	stream_side_open(o->repo, &side[1], two);
+	stream_side_window(&side[0], window);
+	stream_side_window(&side[1], window);
+
+	if (!o->flags.text &&
+	    (stream_side_is_binary(one, &side[0]) ||
+	     stream_side_is_binary(two, &side[1]))) {
+		struct strbuf sb = STRBUF_INIT;
+
+		emit_diff_symbol(o, DIFF_SYMBOL_HEADER,
+				 header->buf, header->len, 0);
+		strbuf_addf(&sb, "%sBinary files %s and %s differ\n",
+			    diff_line_prefix(o), lbl[0], lbl[1]);
+		emit_diff_symbol(o, DIFF_SYMBOL_BINARY_FILES,
+				 sb.buf, sb.len, 0);
+		strbuf_release(&sb);
+		o->found_changes = 1;
+		goto out;
+	}
+
+	if (must_show_header) {
+		emit_diff_symbol(o, DIFF_SYMBOL_HEADER,
+				 header->buf, header->len, 0);
+		strbuf_reset(header);
+	}
+
+	memset(&ecbdata, 0, sizeof(ecbdata));
+	if (o->flags.suppress_diff_headers)
+		lbl[0] = NULL;
+	ecbdata.label_path = lbl;
+	ecbdata.color_diff = want_color(o->use_color);
+	ecbdata.ws_rule = whitespace_rule(o->repo->index, name_b);
+	ecbdata.opt = o;
+	if (header->len && !o->flags.suppress_diff_headers)
+		ecbdata.header = header;
+
+	memset(&xpp, 0, sizeof(xpp));
+	memset(&xecfg, 0, sizeof(xecfg));
+	xpp.flags = o->xdl_opts;
+	xpp.anchors = o->anchors;
+	xpp.anchors_nr = o->anchors_nr;
+	xpp.degraded = &degraded;
+	pe = diff_funcname_pattern(o, one);
+	if (!pe)
+		pe = diff_funcname_pattern(o, two);
+	if (pe)
+		xdiff_set_find_func(&xecfg, pe->pattern, pe->cflags);
+
+	e.ecbdata = &ecbdata;
+	e.xecfg = &xecfg;
+	e.ctxlen = diff_context_lines(o);
+	e.interhunkctxlen = o->interhunkcontext;
+	e.max_hunk = window;
+	strbuf_init(&e.body, 0);
+	strbuf_init(&e.gap, 0);
+
+	while (side[0].line_nr || side[1].line_nr) {
+		mmfile_t mf1, mf2;
+		const struct stream_change *last;
+		size_t commit;
+		long a, b;
+
+		mf1.ptr = side[0].buf.buf;
+		mf1.size = side[0].line[side[0].line_nr];
+		mf2.ptr = side[1].buf.buf;
+		mf2.size = side[1].line[side[1].line_nr];
+		changes.nr = 0;
+		if (xdi_diff_outf(&mf1, &mf2, stream_collect_change, NULL,
+				  &changes, &xpp, &xecfg))
+			die("unable to generate diff for %s", one->path);
+
+		/*
+		 * The last change may only be there because the windows
+		 * end in different places, unless common lines follow it.
+		 * Keep it for the next round, unless there is nothing
+		 * before it, or nothing after the windows.
+		 */
+		a = side[0].line_nr;
+		b = side[1].line_nr;
+		commit = changes.nr;
+		last = changes.nr ? &changes.change[changes.nr - 1] : NULL;
+		if (last && last->i1 + last->chg1 == a &&
+		    last->i2 + last->chg2 == b &&
+		    (last->i1 || last->i2) &&
+		    !(side[0].eof && side[0].buf.len == mf1.size &&
+		      side[1].eof && side[1].buf.len == mf2.size)) {
+			a = last->i1;
+			b = last->i2;
+			commit--;
+		}
+		stream_emit_range(&e, side, changes.change, commit, a, b);
+		strbuf_remove(&side[0].buf, 0, side[0].line[a]);
+		strbuf_remove(&side[1].buf, 0, side[1].line[b]);
+		stream_side_window(&side[0], window);
+		stream_side_window(&side[1], window);
+	}
+	if (e.in_hunk)
+		stream_flush_hunk(&e);
+	if (degraded)
+		warning(_("the bounded diff algorithm ran out of budget "
+			  "for '%s'; some changes are shown coarser "
+			  "than necessary"), two->path);
+	xdiff_clear_find_func(&xecfg);
+
+out:
+	stream_side_close(&side[0]);
+	stream_side_close(&side[1]);
+	strbuf_release(&e.body);
+	strbuf_release(&e.gap);
+	free(changes.change);
+}
+
 static void builtin_diff(const char *name_a,
 			 const char *name_b,
 			 struct diff_filespec *one,
@@ -3516,6 +4181,10 @@ static void builtin_diff(const char *name_a,
 				 header.len, 0);
 		strbuf_reset(&header);
 		goto free_ab_and_return;
+	} else if (!textconv_one && !textconv_two &&
+		   want_stream_diff(o, one, two)) {
+		builtin_diff_stream(o, one, two, lbl, &header,
+				    must_show_header, name_b);
 	} else if (!o->flags.text &&
 		   ( (!textconv_one && diff_filespec_is_binary(o->repo, one)) ||
 		     (!textconv_two && diff_filespec_is_binary(o->repo, two)) )) {
@@ -3564,12 +4233,11 @@ static void builtin_diff(const char *name_a,
 		o->found_changes = 1;
 	} else {
 		/* Crazy xdl interfaces.. */
-		const char *diffopts;
-		const char *v;
 		xpparam_t xpp;
 		xdemitconf_t xecfg;
 		struct emit_callback ecbdata;
 		const struct userdiff_funcname *pe;
+		int degraded = 0;
 
 		if (must_show_header) {
 			emit_diff_symbol(o, DIFF_SYMBOL_HEADER,
@@ -3602,7 +4270,7 @@ static void builtin_diff(const char *name_a,
 		xpp.ignore_regex_nr = o->ignore_regex_nr;
 		xpp.anchors = o->anchors;
 		xpp.anchors_nr = o->anchors_nr;
-		xecfg.ctxlen = o->context;
+		xecfg.ctxlen = diff_context_lines(o);
 		xecfg.interhunkctxlen = o->interhunkcontext;
 		xecfg.flags = XDL_EMIT_FUNCNAMES;
 		if (o->flags.funccontext)
@@ -3610,19 +4278,16 @@ static void builtin_diff(const char *name_a,
 		if (pe)
 			xdiff_set_find_func(&xecfg, pe->pattern, pe->cflags);
 
-		diffopts = getenv("GIT_DIFF_OPTS");
-		if (!diffopts)
-			;
-		else if (skip_prefix(diffopts, "--unified=", &v))
-			xecfg.ctxlen = strtoul(v, NULL, 10);
-		else if (skip_prefix(diffopts, "-u", &v))
-			xecfg.ctxlen = strtoul(v, NULL, 10);
-
 		if (o->word_diff)
 			init_diff_words_data(&ecbdata, o, one, two);
+		xpp.degraded = &degraded;
 		if (xdi_diff_outf(&mf1, &mf2, NULL, fn_out_consume,
 				  &ecbdata, &xpp, &xecfg))
 			die("unable to generate diff for %s", one->path);
+		if (degraded)
+			warning(_("the bounded diff algorithm ran out of budget "
+				  "for '%s'; some changes are shown coarser "
+				  "than necessary"), two->path);
 		if (o->word_diff)
 			free_diff_words_data(&ecbdata);
 		if (textconv_one)
@@ -3694,6 +4359,13 @@ static void builtin_diffstat(const char *name_a, const char *name_b,
 		return;
 	}
 
+	/* counted already, e.g. by the diffstat index */
+	if (p->has_line_counts) {
+		data->added = p->lines_added;
+		data->deleted = p->lines_deleted;
+		return;
+	}
+
 	/* saves some reads if true, not a guarantee of diff outcome */
 	may_differ = !(one->oid_valid && two->oid_valid &&
 			oideq(&one->oid, &two->oid));
@@ -3836,6 +4508,30 @@ static void builtin_checkdiff(const char *name_a, const char *name_b,
 		o->flags.check_failed = 1;
 }
 
+/*
+ * The filespecs and filepairs that diff_change() and its friends queue,
+ * which are most of them, are allocated from a pool instead of one by
+ * one. Once the last of them is freed, which diff_flush() usually does,
+ * the whole pool is cleared at once. They are only ever queued by the
+ * main thread, so the pool needs no lock.
+ */
+static struct mem_pool diff_pool;
+static size_t diff_pool_live;
+
+static void *diff_pool_calloc(size_t size)
+{
+	if (!diff_pool.block_alloc)
+		mem_pool_init(&diff_pool, 0);
+	diff_pool_live++;
+	return mem_pool_calloc(&diff_pool, 1, size);
+}
+
+static void diff_pool_release(void)
+{
+	if (!--diff_pool_live)
+		mem_pool_clear(&diff_pool);
+}
+
 struct diff_filespec *alloc_filespec(const char *path)
 {
 	struct diff_filespec *spec;
@@ -3846,11 +4542,29 @@ struct diff_filespec *alloc_filespec(const char *path)
 	return spec;
 }
 
+/* alloc_filespec() from the pool of the diff run */
+static struct diff_filespec *alloc_pooled_filespec(const char *path)
+{
+	size_t len = strlen(path);
+	struct diff_filespec *spec;
+
+	spec = diff_pool_calloc(st_add3(sizeof(*spec), len, 1));
+	spec->path = (char *)(spec + 1);
+	memcpy(spec->path, path, len);
+	spec->count = 1;
+	spec->is_binary = -1;
+	spec->pooled = 1;
+	return spec;
+}
+
 void free_filespec(struct diff_filespec *spec)
 {
 	if (!--spec->count) {
 		diff_free_filespec_data(spec);
-		free(spec);
+		if (spec->pooled)
+			diff_pool_release();
+		else
+			free(spec);
 	}
 }
 
@@ -4593,6 +5307,7 @@ void repo_diff_setup(struct repository *r, struct diff_options *options)
 	options->line_termination = '\n';
 	options->break_opt = -1;
 	options->rename_limit = -1;
+	options->threads = diff_threads_default;
 	options->dirstat_permille = diff_dirstat_permille_default;
 	options->context = diff_context_default;
 	options->interhunkcontext = diff_interhunk_context_default;
@@ -4748,6 +5463,7 @@ void diff_setup_done(struct diff_options *options)
 	 */
 	if (options->pickaxe_opts & DIFF_PICKAXE_KINDS_MASK)
 		options->flags.recursive = 1;
+	diffcore_pickaxe_setup(options);
 	/*
 	 * When patches are generated, submodules diffed against the work tree
 	 * must be checked for dirtiness too so it can be shown in the output
@@ -5719,7 +6435,8 @@ struct diff_filepair *diff_queue(struct diff_queue_struct *queue,
 				 struct diff_filespec *one,
 				 struct diff_filespec *two)
 {
-	struct diff_filepair *dp = xcalloc(1, sizeof(*dp));
+	struct diff_filepair *dp = diff_pool_calloc(sizeof(*dp));
+	dp->pooled = 1;
 	dp->one = one;
 	dp->two = two;
 	if (queue)
@@ -5727,11 +6444,19 @@ struct diff_filepair *diff_queue(struct diff_queue_struct *queue,
 	return dp;
 }
 
+void diff_free_filepair_only(struct diff_filepair *p)
+{
+	if (p->pooled)
+		diff_pool_release();
+	else
+		free(p);
+}
+
 void diff_free_filepair(struct diff_filepair *p)
 {
 	free_filespec(p->one);
 	free_filespec(p->two);
-	free(p);
+	diff_free_filepair_only(p);
 }
 
 const char *diff_aligned_abbrev(const struct object_id *oid, int len)
@@ -6467,6 +7192,7 @@ void diff_free(struct diff_options *options)
 
 	diff_free_file(options);
 	diff_free_ignore_regex(options);
+	diffcore_pickaxe_release(options);
 	clear_pathspec(&options->pathspec);
 	FREE_AND_NULL(options->parseopts);
 }
@@ -6906,8 +7632,8 @@ void diff_addremove(struct diff_options *options,
 	    strncmp(concatpath, options->prefix, options->prefix_length))
 		return;
 
-	one = alloc_filespec(concatpath);
-	two = alloc_filespec(concatpath);
+	one = alloc_pooled_filespec(concatpath);
+	two = alloc_pooled_filespec(concatpath);
 
 	if (addremove != '+')
 		fill_filespec(one, oid, oid_valid, mode);
@@ -6947,8 +7673,8 @@ void diff_change(struct diff_options *options,
 	    strncmp(concatpath, options->prefix, options->prefix_length))
 		return;
 
-	one = alloc_filespec(concatpath);
-	two = alloc_filespec(concatpath);
+	one = alloc_pooled_filespec(concatpath);
+	two = alloc_pooled_filespec(concatpath);
 	fill_filespec(one, old_oid, old_oid_valid, old_mode);
 	fill_filespec(two, new_oid, new_oid_valid, new_mode);
 	one->dirty_submodule = old_dirty_submodule;
@@ -6977,8 +7703,8 @@ struct diff_filepair *diff_unmerge(struct diff_options *options, const char *pat
 	    strncmp(path, options->prefix, options->prefix_length))
 		return NULL;
 
-	one = alloc_filespec(path);
-	two = alloc_filespec(path);
+	one = alloc_pooled_filespec(path);
+	two = alloc_pooled_filespec(path);
 	pair = diff_queue(&diff_queued_diff, one, two);
 	pair->is_unmerged = 1;
 	return pair;
@@ -69,6 +69,7 @@ struct diff_options;
 struct diff_queue_struct;
 struct oid_array;
 struct option;
+struct pickaxe_cache;
 struct repository;
 struct rev_info;
 struct strbuf;
@@ -267,6 +268,14 @@ struct diff_options {
 	const char *pickaxe;
 	unsigned pickaxe_opts;
 
+	/*
+	 * How often the pickaxe was found in the blobs it already looked
+	 * at; shared by the copies of these diff_options, but freed only
+	 * by diff_free() of the diff_options that diff_setup_done()
+	 * allocated it for.
+	 */
+	struct pickaxe_cache *pickaxe_cache;
+
 	/* -I<regex> */
 	regex_t **ignore_regex;
 	size_t ignore_regex_nr, ignore_regex_alloc;
@@ -312,6 +321,14 @@ struct diff_options {
 	int rename_limit;
 
 	int needed_rename_limit;
+
+	/*
+	 * How many threads diffcore may use where it can use several,
+	 * like pickaxe does with many filepairs, or --color-moved with
+	 * many lines; 0 means one per CPU.
+	 */
+	int threads;
+
 	int degraded_cc_to_c;
 	int show_rename_progress;
 	int dirstat_permille;
@@ -217,9 +217,8 @@ void diffcore_break(struct repository *r, int break_score)
 
 				diff_free_filespec_blob(p->one);
 				diff_free_filespec_blob(p->two);
-				free(p); /* not diff_free_filepair(), we are
-					  * reusing one and two here.
-					  */
+				/* we are reusing one and two here */
+				diff_free_filepair_only(p);
 				continue;
 			}
 		}
@@ -264,8 +263,8 @@ static void merge_broken(struct diff_filepair *p,
 	d->one->rename_used++;
 	diff_free_filespec_data(d->two);
 	diff_free_filespec_data(c->one);
-	free(d);
-	free(c);
+	diff_free_filepair_only(d);
+	diff_free_filepair_only(c);
 }
 
 void diffcore_merge_broken(void)
@@ -9,6 +9,13 @@
 #include "kwset.h"
 #include "commit.h"
 #include "quote.h"
+#include "object-store.h"
+#include "userdiff.h"
+#include "thread-utils.h"
+#include "trace2.h"
+#include "oidmap.h"
+#include "notes-cache.h"
+#include "config.h"
 
 typedef int (*pickaxe_fn)(mmfile_t *one, mmfile_t *two,
 			  struct diff_options *o,
@@ -122,6 +129,236 @@ static int has_changes(mmfile_t *one, mmfile_t *two,
 	return c1 != c2;
 }
 
+/*
+ * The same blob is usually the postimage of one commit and the preimage
+ * of the next one the walk looks at, so remember how often the pattern
+ * occurs in the blobs already searched, for as long as the diff_options
+ * live. With diff.pickaxeCache, the counts are also kept in a notes
+ * cache, for the next search for the same pattern.
+ */
+struct pickaxe_count {
+	struct oidmap_entry entry;
+	unsigned int count;
+	/* not set if the search stopped after "count" occurrences */
+	unsigned exact:1;
+};
+
+/*
+ * Once the current generation has this many blobs, the one before is
+ * dropped, so that long walks do not keep every blob they saw.
+ */
+#define PICKAXE_CACHE_GENERATION (1 << 18)
+
+struct pickaxe_cache {
+	/*
+	 * The diff_options that allocated the cache, and is the only one
+	 * to free it; struct copies of it share the cache.
+	 */
+	const struct diff_options *owner;
+	int initialized;
+	/* the current generation, and the one before */
+	struct oidmap counts[2];
+	struct notes_cache *notes;
+	intmax_t hits, searched;
+};
+
+void diffcore_pickaxe_setup(struct diff_options *o)
+{
+	if ((o->pickaxe_opts & (DIFF_PICKAXE_KIND_S | DIFF_PICKAXE_KIND_G)) &&
+	    !o->pickaxe_cache) {
+		CALLOC_ARRAY(o->pickaxe_cache, 1);
+		o->pickaxe_cache->owner = o;
+	}
+}
+
+static void pickaxe_cache_init(struct diff_options *o, const char *key)
+{
+	struct pickaxe_cache *c = o->pickaxe_cache;
+	int enabled;
+
+	c->initialized = 1;
+	oidmap_init(&c->counts[0], 0);
+	oidmap_init(&c->counts[1], 0);
+
+	if (!repo_config_get_bool(o->repo, "diff.pickaxecache", &enabled) &&
+	    enabled) {
+		struct strbuf name = STRBUF_INIT;
+		struct object_id oid;
+
+		hash_object_file(o->repo->hash_algo, key, strlen(key),
+				 OBJ_BLOB, &oid);
+		strbuf_addf(&name, "pickaxe/%s", oid_to_hex(&oid));
+		CALLOC_ARRAY(c->notes, 1);
+		notes_cache_init(o->repo, c->notes, name.buf, "pickaxe counts");
+		strbuf_release(&name);
+	}
+}
+
+void diffcore_pickaxe_release(struct diff_options *o)
+{
+	struct pickaxe_cache *c = o->pickaxe_cache;
+
+	if (!c)
+		return;
+	if (c->owner != o) {
+		o->pickaxe_cache = NULL;
+		return;
+	}
+	if (c->initialized) {
+		trace2_data_intmax("pickaxe", o->repo, "cache/hits", c->hits);
+		trace2_data_intmax("pickaxe", o->repo, "cache/searched",
+				   c->searched);
+		oidmap_free(&c->counts[0], 1);
+		oidmap_free(&c->counts[1], 1);
+	}
+	if (c->notes) {
+		notes_cache_write(c->notes);
+		free_notes(&c->notes->tree);
+		free(c->notes->validity);
+		free(c->notes);
+	}
+	FREE_AND_NULL(o->pickaxe_cache);
+}
+
+static struct pickaxe_count *pickaxe_cache_lookup(struct pickaxe_cache *c,
+						  const struct object_id *oid)
+{
+	struct pickaxe_count *e;
+	char *value, *end;
+	size_t size;
+
+	e = oidmap_get(&c->counts[0], oid);
+	if (!e)
+		e = oidmap_get(&c->counts[1], oid);
+	if (e || !c->notes)
+		return e;
+
+	value = notes_cache_get(c->notes, (struct object_id *)oid, &size);
+	if (!value)
+		return NULL;
+	CALLOC_ARRAY(e, 1);
+	oidcpy(&e->entry.oid, oid);
+	e->count = strtoul(value, &end, 10);
+	e->exact = *end != '+';
+	free(value);
+	oidmap_put(&c->counts[0], e);
+	return e;
+}
+
+/*
+ * Do we know how often the pattern occurs in "one", or, if "limit" is
+ * not 0, whether it occurs at least "limit" times?
+ */
+static int pickaxe_cache_get(struct pickaxe_cache *c, struct diff_filespec *one,
+			     unsigned int limit, unsigned int *count)
+{
+	struct pickaxe_count *e;
+
+	if (!DIFF_FILE_VALID(one)) {
+		*count = 0;
+		return 1;
+	}
+	if (!c || !one->oid_valid || !(e = pickaxe_cache_lookup(c, &one->oid)))
+		return 0;
+	if (limit && e->count >= limit)
+		*count = limit;
+	else if (e->exact)
+		*count = e->count;
+	else
+		return 0;
+	c->hits++;
+	return 1;
+}
+
+static void pickaxe_cache_put(struct pickaxe_cache *c, struct diff_filespec *one,
+			      unsigned int count, unsigned int limit)
+{
+	struct pickaxe_count *e;
+	int exact = !limit || count < limit;
+
+	if (!c || !DIFF_FILE_VALID(one) || !one->oid_valid)
+		return;
+	c->searched++;
+
+	e = oidmap_get(&c->counts[0], &one->oid);
+	if (e && (e->exact || (!exact && e->count >= count)))
+		return;
+	if (!e) {
+		if (hashmap_get_size(&c->counts[0].map) >=
+		    PICKAXE_CACHE_GENERATION) {
+			oidmap_free(&c->counts[1], 1);
+			c->counts[1] = c->counts[0];
+			oidmap_init(&c->counts[0], 0);
+		}
+		CALLOC_ARRAY(e, 1);
+		oidcpy(&e->entry.oid, &one->oid);
+		oidmap_put(&c->counts[0], e);
+	}
+	e->count = count;
+	e->exact = exact;
+
+	if (c->notes) {
+		struct strbuf value = STRBUF_INIT;
+
+		strbuf_addf(&value, "%u%s", count, exact ? "" : "+");
+		notes_cache_put(c->notes, &one->oid, value.buf, value.len);
+		strbuf_release(&value);
+	}
+}
+
+/*
+ * How often does the pattern occur in "one"? With a "limit", counting
+ * stops after that many.
+ */
+static unsigned int side_count(struct diff_options *o,
+			       struct diff_filespec *one, unsigned int limit,
+			       regex_t *regexp, kwset_t kws)
+{
+	mmfile_t mf;
+	unsigned int count;
+
+	if (pickaxe_cache_get(o->pickaxe_cache, one, limit, &count))
+		return count;
+	mf.size = fill_textconv(o->repo, NULL, one, &mf.ptr);
+	count = contains(&mf, regexp, kws, limit);
+	pickaxe_cache_put(o->pickaxe_cache, one, count, limit);
+	return count;
+}
+
+/*
+ * pickaxe_match() without textconv: count the occurrences in each side,
+ * and only diff them for -G when there are any, as every line it could
+ * find in the diff is in one of them.
+ */
+static int pickaxe_match_counted(struct diff_filepair *p,
+				 struct diff_options *o,
+				 regex_t *regexp, kwset_t kws)
+{
+	int is_g = o->pickaxe_opts & DIFF_PICKAXE_KIND_G;
+	unsigned int c1, c2;
+	mmfile_t mf1, mf2;
+	int ret;
+
+	c1 = side_count(o, p->one, is_g ? 1 : 0, regexp, kws);
+	c2 = side_count(o, p->two, is_g ? 1 : c1 + 1, regexp, kws);
+	if (!is_g)
+		ret = c1 != c2;
+	else if (!c1 && !c2)
+		ret = 0;
+	else if (!o->flags.text &&
+		 (diff_filespec_is_binary(o->repo, p->one) ||
+		  diff_filespec_is_binary(o->repo, p->two)))
+		ret = 0;
+	else {
+		mf1.size = fill_textconv(o->repo, NULL, p->one, &mf1.ptr);
+		mf2.size = fill_textconv(o->repo, NULL, p->two, &mf2.ptr);
+		ret = diff_grep(&mf1, &mf2, o, regexp, kws);
+	}
+	diff_free_filespec_data(p->one);
+	diff_free_filespec_data(p->two);
+	return ret;
+}
+
 static int pickaxe_match(struct diff_filepair *p, struct diff_options *o,
 			 regex_t *regexp, kwset_t kws, pickaxe_fn fn)
 {
@@ -156,6 +393,9 @@ static int pickaxe_match(struct diff_filepair *p, struct diff_options *o,
 	if (textconv_one == textconv_two && diff_unmodified_pair(p))
 		return 0;
 
+	if (!textconv_one && !textconv_two)
+		return pickaxe_match_counted(p, o, regexp, kws);
+
 	if ((o->pickaxe_opts & DIFF_PICKAXE_KIND_G) &&
 	    !o->flags.text &&
 	    ((!textconv_one && diff_filespec_is_binary(o->repo, p->one)) ||
@@ -177,11 +417,332 @@ static int pickaxe_match(struct diff_filepair *p, struct diff_options *o,
 	return ret;
 }
 
+static void regcomp_or_die(regex_t *regex, const char *needle, int cflags)
+{
+	int err = regcomp(regex, needle, cflags);
+	if (err) {
+		/* The POSIX.2 people are surely sick */
+		char errbuf[1024];
+		regerror(err, regex, errbuf, 1024);
+		die("invalid regex: %s", errbuf);
+	}
+}
+
+/*
+ * The filepairs of a diff that changes many files, like the one of a root
+ * commit or between trees far apart, are searched by several threads.
+ * They only read the blobs and search them: whatever needs attributes,
+ * textconv or the working tree is done by the main thread, and the pairs
+ * that need those are searched there, too.
+ */
+#define PICKAXE_THREADS_MIN_PAIRS 32
+
+struct pickaxe_job {
+	struct diff_filepair *p;
+	/* look at the contents to tell whether the sides are binary */
+	unsigned check_binary_one:1, check_binary_two:1;
+	unsigned hit:1;
+	/* which counts the threads found, and not the cache */
+	unsigned counted_one:1, counted_two:1;
+	/* occurrences of the pattern in each side, -1 if not known yet */
+	int count[2];
+	unsigned int limit[2];
+};
+
+struct pickaxe_work {
+	struct diff_options *o;
+	struct pickaxe_job *jobs;
+	int nr, next;
+	pthread_mutex_t mutex;
+
+	regex_t *regexp;
+	kwset_t kws;
+	pickaxe_fn fn;
+	/* for the threads to compile a regexp of their own */
+	const char *regex_src;
+	int cflags;
+};
+
+/* Is "one" binary, if its attributes can tell? -1 if they cannot. */
+static int binary_by_attributes(struct diff_options *o,
+				struct diff_filespec *one)
+{
+	struct userdiff_driver *driver = NULL;
+
+	if (one->is_binary != -1)
+		return one->is_binary;
+	if (!DIFF_FILE_VALID(one))
+		return 0;
+	if (one->driver)
+		driver = one->driver;
+	else if (S_ISREG(one->mode))
+		driver = userdiff_find_by_path(o->repo->index, one->path);
+	if (!driver)
+		driver = userdiff_find_by_name("default");
+	return driver->binary;
+}
+
+/*
+ * Can the threads search "p" on their own? If so, fill in "job"; the
+ * answer may then already be known, in which case it is in job->hit and
+ * there is nothing to search.
+ */
+static int pickaxe_prepare_job(struct diff_filepair *p, struct diff_options *o,
+			       struct pickaxe_job *job, int *searched)
+{
+	struct diff_filespec *sides[2] = { p->one, p->two };
+	unsigned int count;
+	int i;
+
+	if (o->objfind)
+		return 0;
+	if (o->flags.allow_textconv &&
+	    (get_textconv(o->repo, p->one) || get_textconv(o->repo, p->two)))
+		return 0;
+	for (i = 0; i < 2; i++)
+		if (DIFF_FILE_VALID(sides[i]) &&
+		    (!sides[i]->oid_valid || S_ISGITLINK(sides[i]->mode) ||
+		     S_ISDIR(sides[i]->mode) || sides[i]->data))
+			return 0;
+
+	job->p = p;
+	job->hit = 0;
+	job->check_binary_one = job->check_binary_two = 0;
+	job->counted_one = job->counted_two = 0;
+	job->count[0] = job->count[1] = -1;
+	*searched = 0;
+
+	/* see pickaxe_match() */
+	if (!DIFF_FILE_VALID(p->one) && !DIFF_FILE_VALID(p->two))
+		return 1;
+	if (diff_unmodified_pair(p))
+		return 1;
+	if ((o->pickaxe_opts & DIFF_PICKAXE_KIND_G) && !o->flags.text) {
+		int one = binary_by_attributes(o, p->one);
+		int two = binary_by_attributes(o, p->two);
+
+		if (one == 1 || two == 1)
+			return 1;
+		job->check_binary_one = one < 0;
+		job->check_binary_two = two < 0;
+	}
+
+	/* see pickaxe_match_counted() */
+	job->limit[0] = (o->pickaxe_opts & DIFF_PICKAXE_KIND_G) ? 1 : 0;
+	if (pickaxe_cache_get(o->pickaxe_cache, p->one, job->limit[0], &count)) {
+		job->count[0] = count;
+		job->limit[1] = (o->pickaxe_opts & DIFF_PICKAXE_KIND_G) ?
+				1 : count + 1;
+		if (pickaxe_cache_get(o->pickaxe_cache, p->two,
+				      job->limit[1], &count))
+			job->count[1] = count;
+	}
+	if (job->count[0] >= 0 && job->count[1] >= 0) {
+		if (!(o->pickaxe_opts & DIFF_PICKAXE_KIND_G)) {
+			job->hit = job->count[0] != job->count[1];
+			return 1;
+		}
+		if (!job->count[0] && !job->count[1])
+			return 1;
+	}
+	*searched = 1;
+	return 1;
+}
+
+static void read_side(struct repository *r, struct diff_filespec *one,
+		      mmfile_t *mf)
+{
+	struct object_info info = OBJECT_INFO_INIT;
+	unsigned long size;
+
+	if (!DIFF_FILE_VALID(one)) {
+		mf->ptr = xstrdup("");
+		mf->size = 0;
+		return;
+	}
+	info.contentp = (void **)&mf->ptr;
+	info.sizep = &size;
+	if (oid_object_info_extended(r, &one->oid, &info,
+				     OBJECT_INFO_LOOKUP_REPLACE))
+		die("unable to read %s", oid_to_hex(&one->oid));
+	mf->size = size;
+}
+
+static int is_binary_blob(mmfile_t *mf)
+{
+	return mf->size > big_file_threshold ||
+	       buffer_is_binary(mf->ptr, mf->size);
+}
+
+static void run_pickaxe_job(struct pickaxe_work *w, struct pickaxe_job *job,
+			    regex_t *regexp)
+{
+	int is_g = w->o->pickaxe_opts & DIFF_PICKAXE_KIND_G;
+	mmfile_t mf1 = { NULL }, mf2 = { NULL };
+
+	if (job->count[0] < 0) {
+		read_side(w->o->repo, job->p->one, &mf1);
+		job->count[0] = contains(&mf1, regexp, w->kws, job->limit[0]);
+		job->counted_one = 1;
+		job->limit[1] = is_g ? 1 : job->count[0] + 1;
+	}
+	if (job->count[1] < 0) {
+		read_side(w->o->repo, job->p->two, &mf2);
+		job->count[1] = contains(&mf2, regexp, w->kws, job->limit[1]);
+		job->counted_two = 1;
+	}
+
+	if (!is_g)
+		job->hit = job->count[0] != job->count[1];
+	else if (!job->count[0] && !job->count[1])
+		job->hit = 0;
+	else {
+		if (!mf1.ptr)
+			read_side(w->o->repo, job->p->one, &mf1);
+		if (!mf2.ptr)
+			read_side(w->o->repo, job->p->two, &mf2);
+		if ((job->check_binary_one && is_binary_blob(&mf1)) ||
+		    (job->check_binary_two && is_binary_blob(&mf2)))
+			job->hit = 0;
+		else
+			job->hit = !!w->fn(&mf1, &mf2, w->o, regexp, w->kws);
+	}
+	free(mf1.ptr);
+	free(mf2.ptr);
+}
+
+static void *run_pickaxe(void *arg)
+{
+	struct pickaxe_work *w = arg;
+	regex_t regex, *regexp = NULL;
+
+	trace2_thread_start("pickaxe");
+
+	/* searching with the same regex_t from several threads serializes */
+	if (w->regexp) {
+		regcomp_or_die(&regex, w->regex_src, w->cflags);
+		regexp = &regex;
+	}
+
+	while (1) {
+		struct pickaxe_job *job;
+
+		pthread_mutex_lock(&w->mutex);
+		job = w->next < w->nr ? &w->jobs[w->next++] : NULL;
+		pthread_mutex_unlock(&w->mutex);
+		if (!job)
+			break;
+
+		run_pickaxe_job(w, job, regexp);
+	}
+
+	if (regexp)
+		regfree(regexp);
+	trace2_thread_exit();
+	return NULL;
+}
+
+/*
+ * Find out which filepairs of "q" match, using several threads if it has
+ * enough of them. Returns NULL if it did not, because it would not be
+ * worth it, and leaves the searching to the caller.
+ */
+static int *pickaxe_threaded(struct diff_queue_struct *q,
+			     struct diff_options *o, struct pickaxe_work *w)
+{
+	int nr_threads = o->threads ? o->threads : online_cpus();
+	pthread_t *threads;
+	int *hit, *job_of;
+	int i, searched;
+
+	if (!HAVE_THREADS || nr_threads < 2 ||
+	    q->nr < PICKAXE_THREADS_MIN_PAIRS)
+		return NULL;
+
+	CALLOC_ARRAY(hit, q->nr);
+	ALLOC_ARRAY(job_of, q->nr);
+	ALLOC_ARRAY(w->jobs, q->nr);
+	w->nr = 0;
+	for (i = 0; i < q->nr; i++) {
+		struct pickaxe_job job;
+
+		job_of[i] = -1;
+		if (!pickaxe_prepare_job(q->queue[i], o, &job, &searched))
+			continue;
+		if (searched) {
+			job_of[i] = w->nr;
+			w->jobs[w->nr++] = job;
+		} else {
+			hit[i] = job.hit;
+			job_of[i] = -2;
+		}
+	}
+	if (w->nr < PICKAXE_THREADS_MIN_PAIRS) {
+		free(hit);
+		free(job_of);
+		FREE_AND_NULL(w->jobs);
+		return NULL;
+	}
+	w->next = 0;
+	if (nr_threads > w->nr)
+		nr_threads = w->nr;
+
+	pthread_mutex_init(&w->mutex, NULL);
+	enable_obj_read_lock();
+	CALLOC_ARRAY(threads, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		int err = pthread_create(&threads[i], NULL, run_pickaxe, w);
+		if (err)
+			die(_("pickaxe: failed to create thread: %s"),
+			    strerror(err));
+	}
+
+	/* meanwhile, search the pairs the threads cannot */
+	for (i = 0; i < q->nr; i++)
+		if (job_of[i] == -1)
+			hit[i] = pickaxe_match(q->queue[i], o, w->regexp,
+					       w->kws, w->fn);
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	disable_obj_read_lock();
+	pthread_mutex_destroy(&w->mutex);
+
+	for (i = 0; i < q->nr; i++) {
+		struct pickaxe_job *job;
+
+		if (job_of[i] < 0)
+			continue;
+		job = &w->jobs[job_of[i]];
+		hit[i] = job->hit;
+		if (job->counted_one)
+			pickaxe_cache_put(o->pickaxe_cache, job->p->one,
+					  job->count[0], job->limit[0]);
+		if (job->counted_two)
+			pickaxe_cache_put(o->pickaxe_cache, job->p->two,
+					  job->count[1], job->limit[1]);
+	}
+	free(job_of);
+	FREE_AND_NULL(w->jobs);
+	return hit;
+}
+
 static void pickaxe(struct diff_queue_struct *q, struct diff_options *o,
-		    regex_t *regexp, kwset_t kws, pickaxe_fn fn)
+		    regex_t *regexp, kwset_t kws, pickaxe_fn fn,
+		    const char *regex_src, int cflags)
 {
 	int i;
 	struct diff_queue_struct outq;
+	struct pickaxe_work work = {
+		.o = o,
+		.regexp = regexp,
+		.kws = kws,
+		.fn = fn,
+		.regex_src = regex_src,
+		.cflags = cflags,
+	};
+	int *hit = pickaxe_threaded(q, o, &work);
 
 	DIFF_QUEUE_CLEAR(&outq);
 
@@ -189,8 +750,10 @@ static void pickaxe(struct diff_queue_struct *q, struct diff_options *o,
 		/* Showing the whole changeset if needle exists */
 		for (i = 0; i < q->nr; i++) {
 			struct diff_filepair *p = q->queue[i];
-			if (pickaxe_match(p, o, regexp, kws, fn))
+			if (hit ? hit[i] : pickaxe_match(p, o, regexp, kws, fn)) {
+				free(hit);
 				return; /* do not munge the queue */
+			}
 		}
 
 		/*
@@ -204,33 +767,25 @@ static void pickaxe(struct diff_queue_struct *q, struct diff_options *o,
 		/* Showing only the filepairs that has the needle */
 		for (i = 0; i < q->nr; i++) {
 			struct diff_filepair *p = q->queue[i];
-			if (pickaxe_match(p, o, regexp, kws, fn))
+			if (hit ? hit[i] : pickaxe_match(p, o, regexp, kws, fn))
 				diff_q(&outq, p);
 			else
 				diff_free_filepair(p);
 		}
 	}
 
+	free(hit);
 	free(q->queue);
 	*q = outq;
 }
 
-static void regcomp_or_die(regex_t *regex, const char *needle, int cflags)
-{
-	int err = regcomp(regex, needle, cflags);
-	if (err) {
-		/* The POSIX.2 people are surely sick */
-		char errbuf[1024];
-		regerror(err, regex, errbuf, 1024);
-		die("invalid regex: %s", errbuf);
-	}
-}
-
 void diffcore_pickaxe(struct diff_options *o)
 {
 	const char *needle = o->pickaxe;
 	int opts = o->pickaxe_opts;
 	regex_t regex, *regexp = NULL;
+	struct strbuf regex_src = STRBUF_INIT;
+	int cflags = 0;
 	kwset_t kws = NULL;
 	pickaxe_fn fn;
 
@@ -238,10 +793,11 @@ void diffcore_pickaxe(struct diff_options *o)
 	    (!needle || !*needle))
 		BUG("should have needle under -G or -S");
 	if (opts & (DIFF_PICKAXE_REGEX | DIFF_PICKAXE_KIND_G)) {
-		int cflags = REG_EXTENDED | REG_NEWLINE;
+		cflags = REG_EXTENDED | REG_NEWLINE;
 		if (o->pickaxe_opts & DIFF_PICKAXE_IGNORE_CASE)
 			cflags |= REG_ICASE;
-		regcomp_or_die(&regex, needle, cflags);
+		strbuf_addstr(&regex_src, needle);
+		regcomp_or_die(&regex, regex_src.buf, cflags);
 		regexp = &regex;
 
 		if (opts & DIFF_PICKAXE_KIND_G)
@@ -260,12 +816,9 @@ void diffcore_pickaxe(struct diff_options *o)
 	} else if (opts & DIFF_PICKAXE_KIND_S) {
 		if (o->pickaxe_opts & DIFF_PICKAXE_IGNORE_CASE &&
 		    has_non_ascii(needle)) {
-			struct strbuf sb = STRBUF_INIT;
-			int cflags = REG_NEWLINE | REG_ICASE;
-
-			basic_regex_quote_buf(&sb, needle);
-			regcomp_or_die(&regex, sb.buf, cflags);
-			strbuf_release(&sb);
+			cflags = REG_NEWLINE | REG_ICASE;
+			basic_regex_quote_buf(&regex_src, needle);
+			regcomp_or_die(&regex, regex_src.buf, cflags);
 			regexp = &regex;
 		} else {
 			kws = kwsalloc(o->pickaxe_opts & DIFF_PICKAXE_IGNORE_CASE
@@ -280,10 +833,23 @@ void diffcore_pickaxe(struct diff_options *o)
 		BUG("unknown pickaxe_opts flag");
 	}
 
-	pickaxe(&diff_queued_diff, o, regexp, kws, fn);
+	if (o->pickaxe_cache && !o->pickaxe_cache->initialized) {
+		struct strbuf key = STRBUF_INIT;
+
+		if (regexp)
+			strbuf_addf(&key, "regex %d\n%s", cflags, regex_src.buf);
+		else
+			strbuf_addf(&key, "fixed %d\n%s",
+				    !!(opts & DIFF_PICKAXE_IGNORE_CASE), needle);
+		pickaxe_cache_init(o, key.buf);
+		strbuf_release(&key);
+	}
+
+	pickaxe(&diff_queued_diff, o, regexp, kws, fn, regex_src.buf, cflags);
 
 	if (regexp)
 		regfree(regexp);
+	strbuf_release(&regex_src);
 	if (kws)
 		kwsfree(kws);
 	return;
@@ -59,6 +59,7 @@ struct diff_filespec {
 	unsigned has_more_entries : 1; /* only appear in combined diff */
 	/* data should be considered "binary"; -1 means "don't know yet" */
 	signed int is_binary : 2;
+	unsigned pooled : 1; /* allocated from the pool of the diff run */
 	struct userdiff_driver *driver;
 };
 
@@ -111,6 +112,10 @@ struct diff_filepair {
 	unsigned is_unmerged : 1;
 	unsigned done_skip_stat_unmatch : 1;
 	unsigned skip_stat_unmatch_result : 1;
+	unsigned has_line_counts : 1;
+	unsigned pooled : 1; /* allocated from the pool of the diff run */
+	/* lines added and deleted, valid if has_line_counts is set */
+	uint32_t lines_added, lines_deleted;
 };
 
 #define DIFF_PAIR_UNMERGED(p) ((p)->is_unmerged)
@@ -127,6 +132,8 @@ struct diff_filepair {
 #define DIFF_PAIR_MODE_CHANGED(p) ((p)->one->mode != (p)->two->mode)
 
 void diff_free_filepair(struct diff_filepair *);
+/* Free the filepair but not its filespecs, e.g. to reuse them elsewhere */
+void diff_free_filepair_only(struct diff_filepair *);
 void pool_diff_free_filepair(struct mem_pool *pool,
 			     struct diff_filepair *p);
 
@@ -187,7 +194,9 @@ void diffcore_rename_extended(struct diff_options *options,
 			      struct strmap *dir_rename_count,
 			      struct strmap *cached_pairs);
 void diffcore_merge_broken(void);
+void diffcore_pickaxe_setup(struct diff_options *);
 void diffcore_pickaxe(struct diff_options *);
+void diffcore_pickaxe_release(struct diff_options *);
 void diffcore_order(const char *orderfile);
 void diffcore_rotate(struct diff_options *);
 
@@ -0,0 +1,615 @@
+#include "cache.h"
+#include "chunk-format.h"
+#include "commit.h"
+#include "config.h"
+#include "csum-file.h"
+#include "diff.h"
+#include "diffcore.h"
+#include "diffstat-index.h"
+#include "dir.h"
+#include "object-store.h"
+#include "progress.h"
+#include "revision.h"
+#include "side-index.h"
+#include "strvec.h"
+#include "userdiff.h"
+#include "xdiff-interface.h"
+
+#define DIFFSTAT_INDEX_SIGNATURE 0x44535449 /* "DSTI" */
+#define DIFFSTAT_INDEX_VERSION 1
+
+#define DIFFSTAT_CHUNKID_OFFSETS 0x444f4646 /* "DOFF" */
+#define DIFFSTAT_CHUNKID_DATA 0x44415441 /* "DATA" */
+
+/* the path has line counts; binary files do not */
+#define DIFFSTAT_PATH_HAS_LINES (1 << 0)
+
+static const struct side_index_format diffstat_index_format = {
+	.name = "diffstat-index",
+	.signature = DIFFSTAT_INDEX_SIGNATURE,
+	.version = DIFFSTAT_INDEX_VERSION,
+	.close = close_diffstat_index,
+};
+
+struct diffstat_index {
+	/* its objects are the commits */
+	struct side_index si;
+	const unsigned char *chunk_offsets;
+	const unsigned char *chunk_data;
+	size_t chunk_data_size;
+};
+
+struct diffstat_path {
+	unsigned old_mode, new_mode;
+	struct object_id old_oid, new_oid;
+	unsigned flags;
+	uint32_t added, deleted;
+	const char *path;
+};
+
+static int read_data(const unsigned char *chunk_start,
+		     size_t chunk_size, void *data)
+{
+	struct diffstat_index *di = data;
+	di->chunk_data = chunk_start;
+	di->chunk_data_size = chunk_size;
+	return 0;
+}
+
+static int read_chunks(struct chunkfile *cf, void *data)
+{
+	struct diffstat_index *di = data;
+
+	pair_chunk(cf, DIFFSTAT_CHUNKID_OFFSETS, &di->chunk_offsets);
+	read_chunk(cf, DIFFSTAT_CHUNKID_DATA, read_data, di);
+	if (!di->chunk_offsets || !di->chunk_data)
+		return -1;
+	return 0;
+}
+
+static struct diffstat_index *load_diffstat_index(struct repository *r)
+{
+	struct diffstat_index *di;
+
+	CALLOC_ARRAY(di, 1);
+	if (load_side_index(r, &diffstat_index_format, &di->si,
+			    read_chunks, di) < 0)
+		FREE_AND_NULL(di);
+	return di;
+}
+
+static void free_diffstat_index(struct diffstat_index *di)
+{
+	if (!di)
+		return;
+	release_side_index(&di->si);
+	free(di);
+}
+
+struct diffstat_index *prepare_diffstat_index(struct repository *r)
+{
+	int enabled = 1;
+
+	if (r->objects->diffstat_index_attempted)
+		return r->objects->diffstat_index;
+	r->objects->diffstat_index_attempted = 1;
+
+	repo_config_get_bool(r, "core.diffstatindex", &enabled);
+	if (enabled)
+		r->objects->diffstat_index = load_diffstat_index(r);
+	return r->objects->diffstat_index;
+}
+
+void close_diffstat_index(struct raw_object_store *o)
+{
+	free_diffstat_index(o->diffstat_index);
+	o->diffstat_index = NULL;
+	o->diffstat_index_attempted = 0;
+}
+
+/*
+ * Find the entry of "oid" and point "start" and "end" at its data.
+ */
+static int lookup_entry(struct diffstat_index *di, const struct object_id *oid,
+			const unsigned char **start, const unsigned char **end)
+{
+	uint32_t pos;
+	uint64_t from, to;
+
+	if (!side_index_lookup(&di->si, oid, &pos))
+		return 0;
+
+	from = get_be64(di->chunk_offsets + 8 * (size_t)pos);
+	to = get_be64(di->chunk_offsets + 8 * ((size_t)pos + 1));
+	if (from > to || to > di->chunk_data_size) {
+		error(_("diffstat index has a bad offset for %s"),
+		      oid_to_hex(oid));
+		return 0;
+	}
+
+	*start = di->chunk_data + from;
+	*end = di->chunk_data + to;
+	return 1;
+}
+
+/*
+ * Read the path at "p", which must end before "end". Returns a pointer
+ * after it, or NULL if it is truncated.
+ */
+static const unsigned char *read_path(const unsigned char *p,
+				      const unsigned char *end,
+				      struct diffstat_path *out)
+{
+	size_t rawsz = the_hash_algo->rawsz;
+	const unsigned char *nul;
+
+	if (end - p < 17 + 2 * rawsz)
+		return NULL;
+
+	out->old_mode = get_be32(p);
+	out->new_mode = get_be32(p + 4);
+	p += 8;
+	oidread(&out->old_oid, p);
+	oidread(&out->new_oid, p + rawsz);
+	p += 2 * rawsz;
+	out->flags = *p++;
+	out->added = get_be32(p);
+	out->deleted = get_be32(p + 4);
+	p += 8;
+
+	nul = memchr(p, '\0', end - p);
+	if (!nul)
+		return NULL;
+	out->path = (const char *)p;
+	return nul + 1;
+}
+
+static int has_textconv(struct userdiff_driver *driver,
+			enum userdiff_driver_type type, void *data)
+{
+	return !!driver->textconv;
+}
+
+/*
+ * Whether "opt" would produce the same filepairs and line counts from a
+ * plain tree diff as the index has.
+ */
+static int diffstat_index_usable(struct diff_options *opt)
+{
+	unsigned formats = DIFF_FORMAT_RAW | DIFF_FORMAT_DIFFSTAT |
+			   DIFF_FORMAT_NUMSTAT | DIFF_FORMAT_SHORTSTAT |
+			   DIFF_FORMAT_SUMMARY | DIFF_FORMAT_NAME |
+			   DIFF_FORMAT_NAME_STATUS | DIFF_FORMAT_NO_OUTPUT;
+
+	if (opt->output_format & ~formats)
+		return 0;
+
+	/* the queue is built the way diff_tree_oid() would */
+	if (opt->change != diff_change || opt->add_remove != diff_addremove ||
+	    !opt->flags.recursive || opt->flags.tree_in_recursive ||
+	    opt->flags.follow_renames || (opt->pathspec.magic & PATHSPEC_ATTR))
+		return 0;
+
+	/* diffcore only looks at the pairs, and not at the contents */
+	if (opt->detect_rename == DIFF_DETECT_COPY || opt->break_opt != -1 ||
+	    (opt->pickaxe_opts & DIFF_PICKAXE_KINDS_MASK))
+		return 0;
+
+	/* and the lines are counted the same */
+	if ((opt->xdl_opts & (XDF_WHITESPACE_FLAGS | XDF_IGNORE_BLANK_LINES |
+			      XDF_NEED_MINIMAL | XDF_DIFF_ALGORITHM_MASK)) ||
+	    opt->ignore_regex_nr || opt->anchors_nr)
+		return 0;
+	if (opt->flags.allow_textconv &&
+	    for_each_userdiff_driver(has_textconv, NULL))
+		return 0;
+
+	return 1;
+}
+
+int diffstat_index_queue(struct diff_options *opt,
+			 struct commit *parent, struct commit *commit)
+{
+	struct diffstat_index *di;
+	const unsigned char *p, *end;
+	struct object_id parent_tree, tree;
+	struct diffstat_path *paths = NULL;
+	size_t paths_nr = 0, paths_alloc = 0, i;
+	int added = 0, deleted = 0;
+	uint32_t nr;
+
+	if (!diffstat_index_usable(opt))
+		return 0;
+	di = prepare_diffstat_index(opt->repo);
+	if (!di || !lookup_entry(di, &commit->object.oid, &p, &end))
+		return 0;
+
+	if (end - p < 2 * the_hash_algo->rawsz + 4)
+		goto corrupt;
+	oidread(&parent_tree, p);
+	oidread(&tree, p + the_hash_algo->rawsz);
+	p += 2 * the_hash_algo->rawsz;
+	/*
+	 * History may have been rewritten by grafts or replace refs,
+	 * which can give the commit or its parent a different tree
+	 * without changing their names.
+	 */
+	if (parent && repo_parse_commit(opt->repo, parent))
+		return 0;
+	if (!oideq(&tree, get_commit_tree_oid(commit)) ||
+	    !oideq(&parent_tree,
+		   parent ? get_commit_tree_oid(parent) : null_oid()))
+		return 0;
+
+	nr = get_be32(p);
+	p += 4;
+	while (nr--) {
+		struct diffstat_path path;
+
+		p = read_path(p, end, &path);
+		if (!p)
+			goto corrupt;
+
+		if (opt->pathspec.nr &&
+		    !match_pathspec(opt->repo->index, &opt->pathspec,
+				    path.path, strlen(path.path), 0, NULL, 0))
+			continue;
+
+		added |= !path.old_mode;
+		deleted |= !path.new_mode;
+		ALLOC_GROW(paths, paths_nr + 1, paths_alloc);
+		paths[paths_nr++] = path;
+	}
+
+	/* renames pair deleted paths with added ones */
+	if (opt->detect_rename && added && deleted) {
+		free(paths);
+		return 0;
+	}
+
+	for (i = 0; i < paths_nr; i++) {
+		struct diffstat_path *path = &paths[i];
+		int queued = diff_queued_diff.nr;
+
+		if (!path->old_mode)
+			opt->add_remove(opt, '+', path->new_mode, &path->new_oid,
+					1, path->path, 0);
+		else if (!path->new_mode)
+			opt->add_remove(opt, '-', path->old_mode, &path->old_oid,
+					1, path->path, 0);
+		else
+			opt->change(opt, path->old_mode, path->new_mode,
+				    &path->old_oid, &path->new_oid, 1, 1,
+				    path->path, 0, 0);
+
+		if ((path->flags & DIFFSTAT_PATH_HAS_LINES) &&
+		    diff_queued_diff.nr == queued + 1) {
+			struct diff_filepair *pair = diff_queued_diff.queue[queued];
+
+			pair->has_line_counts = 1;
+			pair->lines_added = path->added;
+			pair->lines_deleted = path->deleted;
+			if (opt->flags.reverse_diff)
+				SWAP(pair->lines_added, pair->lines_deleted);
+		}
+	}
+
+	free(paths);
+	return 1;
+
+corrupt:
+	error(_("diffstat index has a corrupt entry for %s"),
+	      oid_to_hex(&commit->object.oid));
+	free(paths);
+	return 0;
+}
+
+struct write_entry {
+	struct object_id oid;
+	const unsigned char *data;
+	size_t len;
+};
+
+struct write_context {
+	struct write_entry *entries;
+	size_t nr, alloc;
+	struct strbuf new_data;
+};
+
+struct record_path {
+	struct diffstat_path path;
+	struct diff_filepair *pair;
+};
+
+struct record_context {
+	struct record_path *paths;
+	size_t nr, alloc;
+};
+
+static struct record_path *record(struct diff_options *opt, const char *path)
+{
+	struct record_context *ctx = opt->change_fn_data;
+	struct record_path *r;
+
+	ALLOC_GROW(ctx->paths, ctx->nr + 1, ctx->alloc);
+	r = &ctx->paths[ctx->nr++];
+	memset(r, 0, sizeof(*r));
+	r->path.path = xstrdup(path);
+	return r;
+}
+
+static void record_pair(struct record_path *r, int queued)
+{
+	if (diff_queued_diff.nr == queued + 1)
+		r->pair = diff_queued_diff.queue[queued];
+}
+
+static void record_change(struct diff_options *opt,
+			  unsigned old_mode, unsigned new_mode,
+			  const struct object_id *old_oid,
+			  const struct object_id *new_oid,
+			  int old_oid_valid, int new_oid_valid,
+			  const char *concatpath,
+			  unsigned old_dirty_submodule,
+			  unsigned new_dirty_submodule)
+{
+	struct record_path *r = record(opt, concatpath);
+	int queued = diff_queued_diff.nr;
+
+	r->path.old_mode = old_mode;
+	r->path.new_mode = new_mode;
+	oidcpy(&r->path.old_oid, old_oid);
+	oidcpy(&r->path.new_oid, new_oid);
+
+	diff_change(opt, old_mode, new_mode, old_oid, new_oid,
+		    old_oid_valid, new_oid_valid, concatpath,
+		    old_dirty_submodule, new_dirty_submodule);
+	record_pair(r, queued);
+}
+
+static void record_addremove(struct diff_options *opt,
+			     int addremove, unsigned mode,
+			     const struct object_id *oid,
+			     int oid_valid,
+			     const char *concatpath,
+			     unsigned dirty_submodule)
+{
+	struct record_path *r = record(opt, concatpath);
+	int queued = diff_queued_diff.nr;
+
+	if (addremove == '+') {
+		r->path.new_mode = mode;
+		oidcpy(&r->path.new_oid, oid);
+	} else {
+		r->path.old_mode = mode;
+		oidcpy(&r->path.old_oid, oid);
+	}
+
+	diff_addremove(opt, addremove, mode, oid, oid_valid, concatpath,
+		       dirty_submodule);
+	record_pair(r, queued);
+}
+
+static void count_lines_of_pair(struct diff_options *opt,
+				struct record_path *r)
+{
+	struct diff_queue_struct q = { .queue = &r->pair, .nr = 1, .alloc = 1 };
+	struct diffstat_t stat;
+
+	if (!r->pair)
+		return;
+
+	compute_diffstat(opt, &stat, &q);
+	if (stat.nr == 1 &&
+	    !stat.files[0]->is_binary && !stat.files[0]->is_unmerged &&
+	    stat.files[0]->added <= UINT32_MAX &&
+	    stat.files[0]->deleted <= UINT32_MAX) {
+		r->path.flags |= DIFFSTAT_PATH_HAS_LINES;
+		r->path.added = stat.files[0]->added;
+		r->path.deleted = stat.files[0]->deleted;
+	}
+	free_diffstat_info(&stat);
+}
+
+static void add_commit_entry(struct repository *r, struct commit *commit,
+			     struct strbuf *out)
+{
+	struct commit *parent = commit->parents ? commit->parents->item : NULL;
+	struct record_context ctx = { 0 };
+	struct diff_options opt;
+	unsigned char be[4];
+	size_t i;
+
+	repo_diff_setup(r, &opt);
+	opt.flags.recursive = 1;
+	/* record every submodule; the readers decide what to ignore */
+	opt.flags.override_submodule_config = 1;
+	opt.detect_rename = 0;
+	opt.xdl_opts &= ~(XDF_WHITESPACE_FLAGS | XDF_IGNORE_BLANK_LINES |
+			  XDF_NEED_MINIMAL | XDF_DIFF_ALGORITHM_MASK);
+	opt.output_format = DIFF_FORMAT_NO_OUTPUT;
+	opt.change = record_change;
+	opt.add_remove = record_addremove;
+	opt.change_fn_data = &ctx;
+	diff_setup_done(&opt);
+
+	if (parent && repo_parse_commit(r, parent))
+		die(_("unable to parse commit %s"),
+		    oid_to_hex(&parent->object.oid));
+	diff_tree_oid(parent ? get_commit_tree_oid(parent) : NULL,
+		      get_commit_tree_oid(commit), "", &opt);
+	diffcore_std(&opt);
+
+	strbuf_add(out, parent ? get_commit_tree_oid(parent)->hash :
+		   null_oid()->hash, the_hash_algo->rawsz);
+	strbuf_add(out, get_commit_tree_oid(commit)->hash,
+		   the_hash_algo->rawsz);
+	put_be32(be, ctx.nr);
+	strbuf_add(out, be, 4);
+
+	for (i = 0; i < ctx.nr; i++) {
+		struct diffstat_path *path = &ctx.paths[i].path;
+
+		count_lines_of_pair(&opt, &ctx.paths[i]);
+
+		put_be32(be, path->old_mode);
+		strbuf_add(out, be, 4);
+		put_be32(be, path->new_mode);
+		strbuf_add(out, be, 4);
+		strbuf_add(out, path->old_oid.hash, the_hash_algo->rawsz);
+		strbuf_add(out, path->new_oid.hash, the_hash_algo->rawsz);
+		strbuf_addch(out, path->flags);
+		put_be32(be, path->added);
+		strbuf_add(out, be, 4);
+		put_be32(be, path->deleted);
+		strbuf_add(out, be, 4);
+		strbuf_add(out, path->path, strlen(path->path) + 1);
+
+		free((char *)path->path);
+	}
+
+	for (i = 0; i < diff_queued_diff.nr; i++)
+		diff_free_filepair(diff_queued_diff.queue[i]);
+	free(diff_queued_diff.queue);
+	DIFF_QUEUE_CLEAR(&diff_queued_diff);
+	diff_free(&opt);
+	free(ctx.paths);
+}
+
+static int write_entry_cmp(const void *va, const void *vb)
+{
+	const struct write_entry *a = va, *b = vb;
+	return oidcmp(&a->oid, &b->oid);
+}
+
+static int write_offsets(struct hashfile *f, void *data)
+{
+	struct side_index_writer *w = data;
+	struct write_context *ctx = w->data;
+	uint64_t offset = 0;
+	size_t i;
+
+	for (i = 0; i < ctx->nr; i++) {
+		hashwrite_be64(f, offset);
+		offset += ctx->entries[i].len;
+	}
+	hashwrite_be64(f, offset);
+	return 0;
+}
+
+static int write_data(struct hashfile *f, void *data)
+{
+	struct side_index_writer *w = data;
+	struct write_context *ctx = w->data;
+	size_t i;
+
+	for (i = 0; i < ctx->nr; i++)
+		hashwrite(f, ctx->entries[i].data, ctx->entries[i].len);
+	return 0;
+}
+
+static void add_chunks(struct chunkfile *cf, struct side_index_writer *w)
+{
+	struct write_context *ctx = w->data;
+	size_t i, data_size = 0;
+
+	for (i = 0; i < ctx->nr; i++)
+		data_size += ctx->entries[i].len;
+
+	add_chunk(cf, DIFFSTAT_CHUNKID_OFFSETS, st_mult(ctx->nr + 1, 8),
+		  write_offsets);
+	add_chunk(cf, DIFFSTAT_CHUNKID_DATA, data_size, write_data);
+}
+
+int write_diffstat_index(struct repository *r, unsigned flags)
+{
+	struct diffstat_index *old = load_diffstat_index(r);
+	struct write_context ctx = { .new_data = STRBUF_INIT };
+	struct side_index_writer w = { .data = &ctx };
+	struct object_id *oids;
+	struct progress *progress = NULL;
+	struct rev_info revs;
+	struct commit *commit;
+	struct strvec args = STRVEC_INIT;
+	size_t *new_offsets = NULL, new_nr = 0, new_alloc = 0;
+	struct object_id *new_oids = NULL;
+	size_t new_oids_alloc = 0, i;
+	uint32_t pos;
+
+	if (flags & SIDE_INDEX_WRITE_PROGRESS)
+		progress = start_delayed_progress(_("Computing diffstats"), 0);
+
+	repo_init_revisions(r, &revs, NULL);
+	strvec_pushl(&args, "", "--all", NULL);
+	setup_revisions(args.nr, args.v, &revs, NULL);
+	if (prepare_revision_walk(&revs))
+		die(_("revision walk setup failed"));
+
+	while ((commit = get_revision(&revs))) {
+		if (old && side_index_lookup(&old->si, &commit->object.oid, &pos))
+			continue;
+
+		ALLOC_GROW(new_oids, new_nr + 1, new_oids_alloc);
+		ALLOC_GROW(new_offsets, new_nr + 1, new_alloc);
+		oidcpy(&new_oids[new_nr], &commit->object.oid);
+		new_offsets[new_nr] = ctx.new_data.len;
+		new_nr++;
+
+		add_commit_entry(r, commit, &ctx.new_data);
+		display_progress(progress, new_nr);
+	}
+	stop_progress(&progress);
+	release_revisions(&revs);
+	strvec_clear(&args);
+
+	if (!new_nr && old) {
+		free_diffstat_index(old);
+		return 0;
+	}
+
+	if (old) {
+		for (pos = 0; pos < old->si.num_objects; pos++) {
+			struct write_entry *e;
+			uint64_t from = get_be64(old->chunk_offsets + 8 * (size_t)pos);
+			uint64_t to = get_be64(old->chunk_offsets + 8 * ((size_t)pos + 1));
+
+			if (from > to || to > old->chunk_data_size)
+				die(_("diffstat index has a bad offset for commit %"PRIu32),
+				    pos);
+
+			ALLOC_GROW(ctx.entries, ctx.nr + 1, ctx.alloc);
+			e = &ctx.entries[ctx.nr++];
+			side_index_nth_oid(&old->si, pos, &e->oid);
+			e->data = old->chunk_data + from;
+			e->len = to - from;
+		}
+	}
+	for (i = 0; i < new_nr; i++) {
+		struct write_entry *e;
+		size_t end = i + 1 < new_nr ? new_offsets[i + 1] :
+					      ctx.new_data.len;
+
+		ALLOC_GROW(ctx.entries, ctx.nr + 1, ctx.alloc);
+		e = &ctx.entries[ctx.nr++];
+		oidcpy(&e->oid, &new_oids[i]);
+		e->data = (const unsigned char *)ctx.new_data.buf + new_offsets[i];
+		e->len = end - new_offsets[i];
+	}
+	QSORT(ctx.entries, ctx.nr, write_entry_cmp);
+
+	ALLOC_ARRAY(oids, ctx.nr);
+	for (i = 0; i < ctx.nr; i++)
+		oidcpy(&oids[i], &ctx.entries[i].oid);
+	w.oids = oids;
+	w.nr = ctx.nr;
+	write_side_index(r, &diffstat_index_format, &w, add_chunks,
+			 old ? &old->si : NULL);
+	free_diffstat_index(old);
+
+	free(oids);
+	free(ctx.entries);
+	free(new_oids);
+	free(new_offsets);
+	strbuf_release(&ctx.new_data);
+	return 0;
+}
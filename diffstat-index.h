@@ -0,0 +1,47 @@
+#ifndef DIFFSTAT_INDEX_H
+#define DIFFSTAT_INDEX_H
+
+struct commit;
+struct diff_options;
+struct raw_object_store;
+struct repository;
+
+/*
+ * The diffstat index remembers, for each commit, the tree diff between
+ * its first parent (or the empty tree, for a root commit) and itself:
+ * the modes and object names on both sides of every changed path, and
+ * the number of lines added and deleted, as "diff --numstat" would
+ * count them without any options.
+ *
+ * It lives in $GIT_DIR/objects/info/diffstat-index and is written by the
+ * "diffstat-index" task of git-maintenance(1). See
+ * Documentation/technical/diffstat-index-format.txt for the format.
+ */
+struct diffstat_index;
+
+/*
+ * Load the diffstat index of "r", if it has one and core.diffstatIndex
+ * is not false. Returns NULL otherwise.
+ */
+struct diffstat_index *prepare_diffstat_index(struct repository *r);
+
+void close_diffstat_index(struct raw_object_store *o);
+
+/*
+ * If the diff between "parent" (NULL for the empty tree) and "commit" is
+ * in the diffstat index, and "opt" asks for nothing that the index cannot
+ * answer, queue the filepairs as diff_tree_oid() would, with their line
+ * counts, and return 1. Otherwise return 0 without touching "opt", and
+ * the caller should diff the trees itself.
+ */
+int diffstat_index_queue(struct diff_options *opt,
+			 struct commit *parent, struct commit *commit);
+
+/*
+ * Add the commits reachable from the refs of "r" that are not in its
+ * diffstat index yet to it. "flags" can have SIDE_INDEX_WRITE_PROGRESS.
+ * Returns 0 on success.
+ */
+int write_diffstat_index(struct repository *r, unsigned flags);
+
+#endif /* DIFFSTAT_INDEX_H */
@@ -30,6 +30,7 @@ static void fsmonitor_ewah_callback(size_t pos, void *is)
 
 	ce = istate->cache[pos];
 	ce->ce_flags &= ~CE_FSMONITOR_VALID;
+	istate->fsmonitor_all_valid = 0;
 }
 
 static int fsmonitor_hook_version(void)
@@ -181,6 +182,12 @@ static int query_fsmonitor_hook(struct repository *r,
 	return result;
 }
 
+static void invalidate_ce(struct index_state *istate, struct cache_entry *ce)
+{
+	ce->ce_flags &= ~CE_FSMONITOR_VALID;
+	istate->fsmonitor_all_valid = 0;
+}
+
 static void fsmonitor_refresh_callback(struct index_state *istate, char *name)
 {
 	int i, len = strlen(name);
@@ -211,7 +218,7 @@ static void fsmonitor_refresh_callback(struct index_state *istate, char *name)
 		for (i = pos; i < istate->cache_nr; i++) {
 			if (!starts_with(istate->cache[i]->name, name))
 				break;
-			istate->cache[i]->ce_flags &= ~CE_FSMONITOR_VALID;
+			invalidate_ce(istate, istate->cache[i]);
 		}
 
 		/*
@@ -224,7 +231,7 @@ static void fsmonitor_refresh_callback(struct index_state *istate, char *name)
 		 * We have an exact match for this path and can just
 		 * invalidate it.
 		 */
-		istate->cache[pos]->ce_flags &= ~CE_FSMONITOR_VALID;
+		invalidate_ce(istate, istate->cache[pos]);
 	} else {
 		/*
 		 * The path is not a tracked file -or- it is a
@@ -245,7 +252,7 @@ static void fsmonitor_refresh_callback(struct index_state *istate, char *name)
 			if ((unsigned char)istate->cache[i]->name[len] > '/')
 				break;
 			if (istate->cache[i]->name[len] == '/')
-				istate->cache[i]->ce_flags &= ~CE_FSMONITOR_VALID;
+				invalidate_ce(istate, istate->cache[i]);
 		}
 	}
 
@@ -480,6 +487,7 @@ void refresh_fsmonitor(struct index_state *istate)
 		 */
 		int is_cache_changed = 0;
 
+		istate->fsmonitor_all_valid = 0;
 		for (i = 0; i < istate->cache_nr; i++) {
 			if (istate->cache[i]->ce_flags & CE_FSMONITOR_VALID) {
 				is_cache_changed = 1;
@@ -547,6 +555,7 @@ void add_fsmonitor(struct index_state *istate)
 		initialize_fsmonitor_last_update(istate);
 
 		/* reset the fsmonitor state */
+		istate->fsmonitor_all_valid = 0;
 		for (i = 0; i < istate->cache_nr; i++)
 			istate->cache[i]->ce_flags &= ~CE_FSMONITOR_VALID;
 
@@ -578,11 +587,21 @@ void tweak_fsmonitor(struct index_state *istate)
 
 	if (istate->fsmonitor_dirty) {
 		if (fsmonitor_enabled) {
-			/* Mark all entries valid */
+			/*
+			 * Mark all entries valid, and remember whether the
+			 * index was written with nothing left to check.
+			 */
+			istate->fsmonitor_all_valid = 1;
 			for (i = 0; i < istate->cache_nr; i++) {
-				if (S_ISGITLINK(istate->cache[i]->ce_mode))
+				struct cache_entry *ce = istate->cache[i];
+
+				if (ce_stage(ce) || ce_intent_to_add(ce))
+					istate->fsmonitor_all_valid = 0;
+				if (S_ISGITLINK(ce->ce_mode)) {
+					istate->fsmonitor_all_valid = 0;
 					continue;
-				istate->cache[i]->ce_flags |= CE_FSMONITOR_VALID;
+				}
+				ce->ce_flags |= CE_FSMONITOR_VALID;
 			}
 
 			/* Mark all previously saved entries as dirty */
@@ -64,6 +64,20 @@ static inline int is_fsmonitor_refreshed(const struct index_state *istate)
 		istate->fsmonitor_has_run_once;
 }
 
+/*
+ * Check if every entry of the index is known to match the working tree
+ * without looking at any of them: the index was written with all of its
+ * entries flagged CE_FSMONITOR_VALID, fsmonitor has since reported no
+ * changes to tracked paths, and nothing modified the index in memory.
+ * Callers can then skip walking the index to lstat() or refresh it.
+ */
+static inline int is_fsmonitor_all_valid(const struct index_state *istate)
+{
+	return istate->fsmonitor_has_run_once &&
+	       istate->fsmonitor_all_valid &&
+	       !istate->cache_changed;
+}
+
 /*
  * Set the given cache entries CE_FSMONITOR_VALID bit. This should be
  * called any time the cache entry has been updated to reflect the
@@ -105,6 +119,7 @@ static inline void mark_fsmonitor_invalid(struct index_state *istate, struct cac
 
 	if (fsm_mode > FSMONITOR_MODE_DISABLED) {
 		ce->ce_flags &= ~CE_FSMONITOR_VALID;
+		istate->fsmonitor_all_valid = 0;
 		untracked_cache_invalidate_path(istate, ce->name, 1);
 		trace_printf_key(&trace_fsmonitor, "mark_fsmonitor_invalid '%s'", ce->name);
 	}
@@ -0,0 +1,889 @@
+#include "cache.h"
+#include "chunk-format.h"
+#include "commit.h"
+#include "config.h"
+#include "csum-file.h"
+#include "ewah/ewok.h"
+#include "grep.h"
+#include "grep-index.h"
+#include "object-store.h"
+#include "oid-array.h"
+#include "oidset.h"
+#include "progress.h"
+#include "refs.h"
+#include "side-index.h"
+#include "tree-walk.h"
+#include "varint.h"
+
+#define GREP_INDEX_SIGNATURE 0x47524958 /* "GRIX" */
+#define GREP_INDEX_VERSION 1
+
+#define GREP_CHUNKID_TRIGRAMS 0x54524947 /* "TRIG" */
+#define GREP_CHUNKID_OFFSETS 0x504f4646 /* "POFF" */
+#define GREP_CHUNKID_POSTINGS 0x504f5354 /* "POST" */
+
+static const struct side_index_format grep_index_format = {
+	.name = "grep-index",
+	.signature = GREP_INDEX_SIGNATURE,
+	.version = GREP_INDEX_VERSION,
+	.close = close_grep_index,
+};
+
+struct grep_index {
+	/* its objects are the blobs */
+	struct side_index si;
+
+	uint32_t num_trigrams;
+	const unsigned char *chunk_trigrams;
+	const unsigned char *chunk_offsets;
+	const unsigned char *chunk_postings;
+	size_t chunk_postings_size;
+};
+
+struct grep_index_filter {
+	struct grep_index *gi;
+	/* the positions in the OID Lookup chunk of the blobs that can match */
+	struct bitmap *blobs;
+};
+
+static int read_trigrams(const unsigned char *chunk_start,
+			 size_t chunk_size, void *data)
+{
+	struct grep_index *gi = data;
+	gi->chunk_trigrams = chunk_start;
+	gi->num_trigrams = chunk_size / 4;
+	return 0;
+}
+
+static int read_postings(const unsigned char *chunk_start,
+			 size_t chunk_size, void *data)
+{
+	struct grep_index *gi = data;
+	gi->chunk_postings = chunk_start;
+	gi->chunk_postings_size = chunk_size;
+	return 0;
+}
+
+static int read_chunks(struct chunkfile *cf, void *data)
+{
+	struct grep_index *gi = data;
+
+	read_chunk(cf, GREP_CHUNKID_TRIGRAMS, read_trigrams, gi);
+	pair_chunk(cf, GREP_CHUNKID_OFFSETS, &gi->chunk_offsets);
+	read_chunk(cf, GREP_CHUNKID_POSTINGS, read_postings, gi);
+	if (!gi->chunk_trigrams || !gi->chunk_offsets || !gi->chunk_postings)
+		return -1;
+	return 0;
+}
+
+static struct grep_index *load_grep_index(struct repository *r)
+{
+	struct grep_index *gi;
+
+	CALLOC_ARRAY(gi, 1);
+	if (load_side_index(r, &grep_index_format, &gi->si,
+			    read_chunks, gi) < 0)
+		FREE_AND_NULL(gi);
+	return gi;
+}
+
+static void free_grep_index(struct grep_index *gi)
+{
+	if (!gi)
+		return;
+	release_side_index(&gi->si);
+	free(gi);
+}
+
+struct grep_index *prepare_grep_index(struct repository *r)
+{
+	int enabled = 1;
+
+	if (r->objects->grep_index_attempted)
+		return r->objects->grep_index;
+	r->objects->grep_index_attempted = 1;
+
+	repo_config_get_bool(r, "core.grepindex", &enabled);
+	if (enabled)
+		r->objects->grep_index = load_grep_index(r);
+	return r->objects->grep_index;
+}
+
+void close_grep_index(struct raw_object_store *o)
+{
+	free_grep_index(o->grep_index);
+	o->grep_index = NULL;
+	o->grep_index_attempted = 0;
+}
+
+static uint32_t trigram_at(const char *s)
+{
+	const unsigned char *u = (const unsigned char *)s;
+	return ((uint32_t)u[0] << 16) | ((uint32_t)u[1] << 8) | u[2];
+}
+
+/*
+ * Point "start" and "end" at the posting list of trigram "t". Returns 0
+ * if no blob in the index contains it.
+ */
+static int lookup_trigram(struct grep_index *gi, uint32_t t,
+			  const unsigned char **start,
+			  const unsigned char **end)
+{
+	uint32_t lo = 0, hi = gi->num_trigrams;
+	uint64_t from, to;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		uint32_t v = get_be32(gi->chunk_trigrams + 4 * (size_t)mid);
+
+		if (v == t) {
+			from = get_be64(gi->chunk_offsets + 8 * (size_t)mid);
+			to = get_be64(gi->chunk_offsets + 8 * ((size_t)mid + 1));
+			if (from > to || to > gi->chunk_postings_size) {
+				error(_("grep index has a bad offset for trigram %"PRIu32),
+				      mid);
+				return -1;
+			}
+			*start = gi->chunk_postings + from;
+			*end = gi->chunk_postings + to;
+			return 1;
+		}
+		if (v < t)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0;
+}
+
+/*
+ * Call "fn" with each position in the posting list between "p" and
+ * "end". A posting list is a sequence of varints: the position of the
+ * first blob, and then the distance of each blob from the one before.
+ * Returns -1 if it is corrupt.
+ */
+static int for_each_posting(const unsigned char *p, const unsigned char *end,
+			    uint32_t num_blobs,
+			    void (*fn)(uint32_t pos, void *data), void *data)
+{
+	uint64_t pos = 0;
+	int first = 1;
+
+	while (p < end) {
+		const unsigned char *next = p;
+		uint64_t v = decode_varint(&next);
+
+		if (next == p || next > end || (!first && !v))
+			return -1;
+		p = next;
+		pos = first ? v : pos + v;
+		first = 0;
+		if (pos >= num_blobs)
+			return -1;
+		fn(pos, data);
+	}
+	return 0;
+}
+
+static void set_posting(uint32_t pos, void *data)
+{
+	bitmap_set(data, pos);
+}
+
+/*
+ * The blobs containing trigram "t", or NULL if we cannot tell and all
+ * of them have to be assumed to.
+ */
+static struct bitmap *trigram_blobs(struct grep_index *gi, uint32_t t)
+{
+	const unsigned char *start, *end;
+	struct bitmap *b;
+	int found = lookup_trigram(gi, t, &start, &end);
+
+	if (found < 0)
+		return NULL;
+	b = bitmap_word_alloc(gi->si.num_objects / BITS_IN_EWORD + 1);
+	if (found &&
+	    for_each_posting(start, end, gi->si.num_objects, set_posting, b) < 0) {
+		error(_("grep index has a corrupt posting list"));
+		bitmap_free(b);
+		return NULL;
+	}
+	return b;
+}
+
+static void intersect(struct bitmap *self, struct bitmap *other)
+{
+	size_t i;
+
+	for (i = 0; i < self->word_alloc; i++)
+		self->words[i] &= i < other->word_alloc ? other->words[i] : 0;
+}
+
+struct trigrams {
+	uint32_t *v;
+	size_t nr, alloc;
+};
+
+static void add_run(struct trigrams *t, const char *run, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i + 3 <= len; i++) {
+		ALLOC_GROW(t->v, t->nr + 1, t->alloc);
+		t->v[t->nr++] = trigram_at(run + i);
+	}
+}
+
+/*
+ * Skip the bracket expression starting at "pat[*i]", leaving "*i" at
+ * its closing bracket. Returns -1 if there is none.
+ */
+static int skip_bracket(const char *pat, size_t len, size_t *i, int pcre)
+{
+	size_t j = *i + 1;
+
+	if (j < len && pat[j] == '^')
+		j++;
+	if (j < len && pat[j] == ']')
+		j++;
+	for (; j < len; j++) {
+		if (pat[j] == ']') {
+			*i = j;
+			return 0;
+		}
+		if (pcre && pat[j] == '\\') {
+			j++;
+		} else if (pat[j] == '[' && j + 1 < len && pat[j + 1] &&
+			   strchr(":.=", pat[j + 1])) {
+			/* [:class:], [.coll.] and [=equiv=] */
+			char close = pat[j + 1];
+
+			for (j += 2; j + 1 < len; j++)
+				if (pat[j] == close && pat[j + 1] == ']')
+					break;
+			if (j + 1 >= len)
+				return -1;
+			j++;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Skip the interval "{n,m}" (or "\{n,m\}" in a basic regular
+ * expression) whose opening brace is at "pat[*i]". Returns -1 if it is
+ * not closed.
+ */
+static int skip_interval(const char *pat, size_t len, size_t *i, int basic)
+{
+	size_t j;
+
+	for (j = *i + 1; j < len; j++) {
+		if (basic && pat[j] == '\\' && j + 1 < len && pat[j + 1] == '}') {
+			*i = j + 1;
+			return 0;
+		}
+		if (!basic && pat[j] == '}') {
+			*i = j;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Collect the trigrams of the strings that every match of the regular
+ * expression "pat" contains: runs of ordinary characters outside of any
+ * group whose last character is not made optional by a quantifier.
+ *
+ * This errs on the side of finding too little: an alternative at the
+ * top level, or syntax we do not understand, leaves us with nothing,
+ * and every blob can match.
+ */
+static void regex_trigrams(const char *pat, size_t len,
+			   enum grep_pattern_type type, struct trigrams *out)
+{
+	int basic = type == GREP_PATTERN_TYPE_BRE;
+	int pcre = type == GREP_PATTERN_TYPE_PCRE;
+	struct strbuf run = STRBUF_INIT;
+	struct trigrams found = { 0 };
+	int depth = 0;
+	size_t i;
+
+	/* inline options such as "(?i)" or "(?x)" change what is literal */
+	if (pcre && memmem(pat, len, "(?", 2))
+		return;
+
+	for (i = 0; i < len; i++) {
+		unsigned char c = pat[i];
+		int literal = 0, quantifier = 0;
+
+		if (c == '\\') {
+			if (++i == len)
+				goto give_up;
+			c = pat[i];
+			if (basic && c == '(') {
+				depth++;
+			} else if (basic && c == ')') {
+				if (depth)
+					depth--;
+			} else if (basic && c == '|') {
+				if (!depth)
+					goto give_up;
+			} else if (basic && (c == '+' || c == '?')) {
+				quantifier = 1;
+			} else if (basic && c == '{') {
+				if (skip_interval(pat, len, &i, 1) < 0)
+					goto give_up;
+				quantifier = 1;
+			} else if (pcre && isalnum(c) && !strchr("dDwWsSbBAzZ", c)) {
+				/*
+				 * e.g. "\x41", "\101", "\cA" or "\N{U+41}",
+				 * whose arguments are not literal text
+				 */
+				goto give_up;
+			} else if (c && !isalnum(c) && !strchr("<>`'", c)) {
+				literal = 1;
+			}
+			/* otherwise a class, an anchor or a back-reference */
+		} else if (c == '[') {
+			if (skip_bracket(pat, len, &i, pcre) < 0)
+				goto give_up;
+		} else if (c == '*' || (!basic && (c == '+' || c == '?'))) {
+			quantifier = 1;
+		} else if (!basic && c == '{') {
+			if (skip_interval(pat, len, &i, 0) < 0)
+				goto give_up;
+			quantifier = 1;
+		} else if (!basic && c == '(') {
+			depth++;
+		} else if (!basic && c == ')') {
+			if (depth)
+				depth--;
+		} else if (!basic && c == '|') {
+			if (!depth)
+				goto give_up;
+		} else if (c != '.' && c != '^' && c != '$') {
+			literal = 1;
+		}
+
+		if (quantifier && run.len) {
+			/*
+			 * The last character may be repeated or left out;
+			 * if it is a multi-byte one, drop the whole run
+			 * rather than guess where it starts.
+			 */
+			if (run.buf[run.len - 1] & 0x80)
+				strbuf_reset(&run);
+			else
+				strbuf_setlen(&run, run.len - 1);
+		}
+		if (literal && !depth) {
+			strbuf_addch(&run, c);
+		} else {
+			add_run(&found, run.buf, run.len);
+			strbuf_reset(&run);
+		}
+	}
+	add_run(&found, run.buf, run.len);
+
+	ALLOC_GROW(out->v, out->nr + found.nr, out->alloc);
+	COPY_ARRAY(out->v + out->nr, found.v, found.nr);
+	out->nr += found.nr;
+
+give_up:
+	free(found.v);
+	strbuf_release(&run);
+}
+
+/*
+ * The blobs that can match pattern "p", or NULL for all of them.
+ */
+static struct bitmap *pattern_blobs(struct grep_index *gi, struct grep_pat *p,
+				    enum grep_pattern_type type)
+{
+	struct trigrams t = { 0 };
+	struct bitmap *res = NULL;
+	size_t i;
+
+	if (p->token != GREP_PATTERN)
+		return NULL;
+	if (p->fixed)
+		add_run(&t, p->pattern, p->patternlen);
+	else
+		regex_trigrams(p->pattern, p->patternlen, type, &t);
+
+	for (i = 0; i < t.nr; i++) {
+		struct bitmap *b = trigram_blobs(gi, t.v[i]);
+
+		if (!b)
+			continue;
+		if (!res) {
+			res = b;
+		} else {
+			intersect(res, b);
+			bitmap_free(b);
+		}
+	}
+
+	free(t.v);
+	return res;
+}
+
+static struct bitmap *expr_blobs(struct grep_index *gi, struct grep_expr *x,
+				 enum grep_pattern_type type)
+{
+	struct bitmap *left, *right;
+
+	switch (x->node) {
+	case GREP_NODE_ATOM:
+		return pattern_blobs(gi, x->u.atom, type);
+	case GREP_NODE_AND:
+		left = expr_blobs(gi, x->u.binary.left, type);
+		right = expr_blobs(gi, x->u.binary.right, type);
+		if (!left)
+			return right;
+		if (right) {
+			intersect(left, right);
+			bitmap_free(right);
+		}
+		return left;
+	case GREP_NODE_OR:
+		left = expr_blobs(gi, x->u.binary.left, type);
+		if (!left)
+			return NULL;
+		right = expr_blobs(gi, x->u.binary.right, type);
+		if (!right) {
+			bitmap_free(left);
+			return NULL;
+		}
+		bitmap_or(left, right);
+		bitmap_free(right);
+		return left;
+	default:
+		/* "--not" and the true node match without any pattern */
+		return NULL;
+	}
+}
+
+struct grep_index_filter *grep_index_filter(struct repository *r,
+					    struct grep_opt *opt)
+{
+	struct grep_index_filter *f;
+	struct grep_index *gi;
+	struct bitmap *blobs = NULL;
+	struct grep_pat *p;
+
+	/*
+	 * These show blobs that do not match, or match something else
+	 * than their contents. Case-insensitive matching is left alone,
+	 * as the locale decides which bytes fold to which.
+	 */
+	if (opt->invert || opt->unmatch_name_only || opt->allow_textconv ||
+	    opt->ignore_case || opt->header_list)
+		return NULL;
+
+	gi = prepare_grep_index(r);
+	if (!gi)
+		return NULL;
+
+	if (opt->extended) {
+		if (opt->pattern_expression)
+			blobs = expr_blobs(gi, opt->pattern_expression,
+					   opt->pattern_type_option);
+	} else {
+		for (p = opt->pattern_list; p; p = p->next) {
+			struct bitmap *b = pattern_blobs(gi, p,
+							 opt->pattern_type_option);
+
+			if (!b) {
+				bitmap_free(blobs);
+				blobs = NULL;
+				break;
+			}
+			if (!blobs) {
+				blobs = b;
+			} else {
+				bitmap_or(blobs, b);
+				bitmap_free(b);
+			}
+		}
+	}
+	if (!blobs)
+		return NULL;
+
+	CALLOC_ARRAY(f, 1);
+	f->gi = gi;
+	f->blobs = blobs;
+	return f;
+}
+
+int grep_index_filter_may_match(struct grep_index_filter *f,
+				const struct object_id *oid)
+{
+	uint32_t pos;
+
+	if (!side_index_lookup(&f->gi->si, oid, &pos))
+		return 1;
+	return bitmap_get(f->blobs, pos);
+}
+
+void grep_index_filter_free(struct grep_index_filter *f)
+{
+	if (!f)
+		return;
+	bitmap_free(f->blobs);
+	free(f);
+}
+
+struct write_context {
+	/* the blobs to index, sorted */
+	struct oid_array blobs;
+	/* their position in the new index, or -1 if they are not in it */
+	int64_t *new_pos;
+	/* (trigram << 32 | position) of every posting */
+	uint64_t *pairs;
+	size_t pairs_nr, pairs_alloc;
+
+	/* what is written, built from the sorted pairs */
+	uint32_t num_blobs;
+	uint32_t *trigrams;
+	uint64_t *offsets;
+	size_t trigrams_nr, trigrams_alloc, offsets_alloc;
+	struct strbuf postings;
+};
+
+static void add_pair(struct write_context *ctx, uint32_t t, uint32_t pos)
+{
+	ALLOC_GROW(ctx->pairs, ctx->pairs_nr + 1, ctx->pairs_alloc);
+	ctx->pairs[ctx->pairs_nr++] = ((uint64_t)t << 32) | pos;
+}
+
+struct collect_data {
+	struct repository *r;
+	struct oidset trees;
+	struct oidset blobs;
+};
+
+static void collect_tree(struct collect_data *data,
+			 const struct object_id *oid)
+{
+	struct tree_desc desc;
+	struct name_entry entry;
+	enum object_type type;
+	unsigned long size;
+	void *buf;
+
+	if (oidset_insert(&data->trees, oid))
+		return;
+	/* do not fetch what a partial clone left out */
+	if (!has_object(data->r, oid, 0))
+		return;
+	buf = repo_read_object_file(data->r, oid, &type, &size);
+	if (!buf || type != OBJ_TREE)
+		die(_("unable to read tree (%s)"), oid_to_hex(oid));
+
+	init_tree_desc(&desc, buf, size);
+	while (tree_entry(&desc, &entry)) {
+		if (S_ISDIR(entry.mode))
+			collect_tree(data, &entry.oid);
+		else if (S_ISREG(entry.mode))
+			oidset_insert(&data->blobs, &entry.oid);
+	}
+	free(buf);
+}
+
+static int collect_ref(const char *refname, const struct object_id *oid,
+		       int flags, void *cb_data)
+{
+	struct collect_data *data = cb_data;
+	struct commit *commit;
+
+	commit = lookup_commit_reference_gently(data->r, oid, 1);
+	if (!commit)
+		return 0;
+	collect_tree(data, get_commit_tree_oid(commit));
+	return 0;
+}
+
+struct remap_data {
+	struct write_context *ctx;
+	const int64_t *old_to_new;
+	uint32_t t;
+};
+
+static void remap_posting(uint32_t pos, void *cb_data)
+{
+	struct remap_data *data = cb_data;
+
+	if (data->old_to_new[pos] >= 0)
+		add_pair(data->ctx, data->t, data->old_to_new[pos]);
+}
+
+/*
+ * Carry the postings of the blobs in "old" that are still wanted over.
+ * Returns the number of blobs it had that are not wanted anymore.
+ */
+static uint32_t reuse_old_index(struct write_context *ctx,
+				struct grep_index *old, int *from_old)
+{
+	int64_t *old_to_new;
+	struct remap_data data = { .ctx = ctx };
+	uint32_t pos, dropped = 0;
+
+	ALLOC_ARRAY(old_to_new, old->si.num_objects);
+	for (pos = 0; pos < old->si.num_objects; pos++) {
+		struct object_id oid;
+		int i;
+
+		side_index_nth_oid(&old->si, pos, &oid);
+		i = oid_array_lookup(&ctx->blobs, &oid);
+		if (i < 0) {
+			old_to_new[pos] = -1;
+			dropped++;
+		} else {
+			from_old[i] = 1;
+			old_to_new[pos] = i;
+		}
+	}
+
+	data.old_to_new = old_to_new;
+	for (pos = 0; pos < old->num_trigrams; pos++) {
+		uint64_t from = get_be64(old->chunk_offsets + 8 * (size_t)pos);
+		uint64_t to = get_be64(old->chunk_offsets + 8 * ((size_t)pos + 1));
+
+		data.t = get_be32(old->chunk_trigrams + 4 * (size_t)pos);
+		if (from > to || to > old->chunk_postings_size ||
+		    for_each_posting(old->chunk_postings + from,
+				     old->chunk_postings + to,
+				     old->si.num_objects, remap_posting, &data) < 0)
+			die(_("grep index has a corrupt posting list"));
+	}
+
+	free(old_to_new);
+	return dropped;
+}
+
+/*
+ * Add the postings of the blob at position "pos", whose contents are
+ * "buf". "seen" has a bit for each trigram, all of them clear.
+ */
+static void index_blob(struct write_context *ctx, uint32_t pos,
+		       const char *buf, unsigned long size,
+		       unsigned char *seen)
+{
+	size_t first = ctx->pairs_nr, i;
+	unsigned long j;
+
+	for (j = 0; j + 3 <= size; j++) {
+		uint32_t t = trigram_at(buf + j);
+
+		if (seen[t >> 3] & (1 << (t & 7)))
+			continue;
+		seen[t >> 3] |= 1 << (t & 7);
+		add_pair(ctx, t, pos);
+	}
+	for (i = first; i < ctx->pairs_nr; i++) {
+		uint32_t t = ctx->pairs[i] >> 32;
+		seen[t >> 3] &= ~(1 << (t & 7));
+	}
+}
+
+static int pair_cmp(const void *va, const void *vb)
+{
+	uint64_t a = *(const uint64_t *)va, b = *(const uint64_t *)vb;
+	return a < b ? -1 : a > b;
+}
+
+static void build_postings(struct write_context *ctx)
+{
+	unsigned char varint[16];
+	size_t i;
+	uint32_t last_pos = 0;
+
+	QSORT(ctx->pairs, ctx->pairs_nr, pair_cmp);
+
+	for (i = 0; i < ctx->pairs_nr; i++) {
+		uint32_t t = ctx->pairs[i] >> 32;
+		uint32_t pos = ctx->pairs[i] & 0xffffffff;
+		int new_trigram = !ctx->trigrams_nr ||
+			ctx->trigrams[ctx->trigrams_nr - 1] != t;
+
+		if (new_trigram) {
+			ALLOC_GROW(ctx->trigrams, ctx->trigrams_nr + 1,
+				   ctx->trigrams_alloc);
+			ALLOC_GROW(ctx->offsets, ctx->trigrams_nr + 1,
+				   ctx->offsets_alloc);
+			ctx->trigrams[ctx->trigrams_nr] = t;
+			ctx->offsets[ctx->trigrams_nr] = ctx->postings.len;
+			ctx->trigrams_nr++;
+		}
+		strbuf_add(&ctx->postings, varint,
+			   encode_varint(new_trigram ? pos : pos - last_pos,
+					 varint));
+		last_pos = pos;
+	}
+	ALLOC_GROW(ctx->offsets, ctx->trigrams_nr + 1, ctx->offsets_alloc);
+	ctx->offsets[ctx->trigrams_nr] = ctx->postings.len;
+}
+
+static int write_trigrams(struct hashfile *f, void *data)
+{
+	struct side_index_writer *w = data;
+	struct write_context *ctx = w->data;
+	size_t i;
+
+	for (i = 0; i < ctx->trigrams_nr; i++)
+		hashwrite_be32(f, ctx->trigrams[i]);
+	return 0;
+}
+
+static int write_offsets(struct hashfile *f, void *data)
+{
+	struct side_index_writer *w = data;
+	struct write_context *ctx = w->data;
+	size_t i;
+
+	for (i = 0; i <= ctx->trigrams_nr; i++)
+		hashwrite_be64(f, ctx->offsets[i]);
+	return 0;
+}
+
+static int write_postings(struct hashfile *f, void *data)
+{
+	struct side_index_writer *w = data;
+	struct write_context *ctx = w->data;
+
+	hashwrite(f, ctx->postings.buf, ctx->postings.len);
+	return 0;
+}
+
+static void add_chunks(struct chunkfile *cf, struct side_index_writer *w)
+{
+	struct write_context *ctx = w->data;
+
+	add_chunk(cf, GREP_CHUNKID_TRIGRAMS, st_mult(ctx->trigrams_nr, 4),
+		  write_trigrams);
+	add_chunk(cf, GREP_CHUNKID_OFFSETS, st_mult(ctx->trigrams_nr + 1, 8),
+		  write_offsets);
+	add_chunk(cf, GREP_CHUNKID_POSTINGS, ctx->postings.len,
+		  write_postings);
+}
+
+int write_grep_index(struct repository *r, unsigned flags)
+{
+	struct grep_index *old = load_grep_index(r);
+	struct write_context ctx = { .blobs = OID_ARRAY_INIT,
+				     .postings = STRBUF_INIT };
+	struct side_index_writer w = { .data = &ctx };
+	struct collect_data data = { .r = r };
+	struct progress *progress = NULL;
+	struct oidset_iter iter;
+	const struct object_id *oid;
+	struct object_id *oids;
+	unsigned char *seen;
+	int *from_old;
+	uint32_t dropped = 0, added = 0;
+	size_t i;
+
+	oidset_init(&data.trees, 0);
+	oidset_init(&data.blobs, 0);
+	head_ref(collect_ref, &data);
+	for_each_ref(collect_ref, &data);
+	oidset_iter_init(&data.blobs, &iter);
+	while ((oid = oidset_iter_next(&iter)))
+		oid_array_append(&ctx.blobs, oid);
+	oidset_clear(&data.trees);
+	oidset_clear(&data.blobs);
+	oid_array_sort(&ctx.blobs);
+
+	CALLOC_ARRAY(from_old, ctx.blobs.nr);
+	if (old)
+		dropped = reuse_old_index(&ctx, old, from_old);
+
+	/*
+	 * Decide which blobs go in before reading any, as the postings
+	 * refer to the blobs by their position in the new index. Blobs
+	 * that are missing or too large to be read whole are left out,
+	 * and are always searched.
+	 */
+	ALLOC_ARRAY(ctx.new_pos, ctx.blobs.nr);
+	for (i = 0; i < ctx.blobs.nr; i++) {
+		unsigned long size;
+
+		if (!from_old[i]) {
+			struct object_info oi = OBJECT_INFO_INIT;
+
+			oi.sizep = &size;
+			if (oid_object_info_extended(r, &ctx.blobs.oid[i], &oi,
+						     OBJECT_INFO_SKIP_FETCH_OBJECT |
+						     OBJECT_INFO_QUICK) < 0 ||
+			    size > big_file_threshold) {
+				ctx.new_pos[i] = -1;
+				continue;
+			}
+			added++;
+		}
+		ctx.new_pos[i] = ctx.num_blobs++;
+	}
+
+	if (old && !added && !dropped) {
+		free_grep_index(old);
+		goto out;
+	}
+
+	/* the old postings were collected with the positions in "blobs" */
+	for (i = 0; i < ctx.pairs_nr; i++) {
+		uint32_t pos = ctx.pairs[i] & 0xffffffff;
+		ctx.pairs[i] = (ctx.pairs[i] & ~(uint64_t)0xffffffff) |
+			       ctx.new_pos[pos];
+	}
+
+	if (flags & SIDE_INDEX_WRITE_PROGRESS)
+		progress = start_delayed_progress(_("Indexing blobs for grep"),
+						  added);
+	seen = xcalloc(1 << 21, 1);
+	added = 0;
+	for (i = 0; i < ctx.blobs.nr; i++) {
+		enum object_type type;
+		unsigned long size;
+		void *buf;
+
+		if (from_old[i] || ctx.new_pos[i] < 0)
+			continue;
+		buf = repo_read_object_file(r, &ctx.blobs.oid[i], &type, &size);
+		if (!buf || type != OBJ_BLOB)
+			die(_("unable to read blob %s"),
+			    oid_to_hex(&ctx.blobs.oid[i]));
+		index_blob(&ctx, ctx.new_pos[i], buf, size, seen);
+		free(buf);
+		display_progress(progress, ++added);
+	}
+	stop_progress(&progress);
+	free(seen);
+
+	build_postings(&ctx);
+
+	ALLOC_ARRAY(oids, ctx.num_blobs);
+	for (i = 0; i < ctx.blobs.nr; i++)
+		if (ctx.new_pos[i] >= 0)
+			oidcpy(&oids[ctx.new_pos[i]], &ctx.blobs.oid[i]);
+	w.oids = oids;
+	w.nr = ctx.num_blobs;
+	write_side_index(r, &grep_index_format, &w, add_chunks,
+			 old ? &old->si : NULL);
+	free_grep_index(old);
+	free(oids);
+
+out:
+	oid_array_clear(&ctx.blobs);
+	free(ctx.new_pos);
+	free(ctx.pairs);
+	free(ctx.trigrams);
+	free(ctx.offsets);
+	strbuf_release(&ctx.postings);
+	free(from_old);
+	return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef GREP_INDEX_H
+#define GREP_INDEX_H
+
+struct grep_opt;
+struct object_id;
+struct raw_object_store;
+struct repository;
+
+/*
+ * The grep index remembers, for each blob in the trees of the refs,
+ * which trigrams (sequences of three bytes) occur in its contents, as
+ * a list of blobs per trigram.
+ *
+ * "git grep" asks it which blobs can possibly match its patterns, and
+ * does not read the others at all. A blob that is not in the index can
+ * always match.
+ *
+ * It lives in $GIT_DIR/objects/info/grep-index and is written by the
+ * "grep-index" task of git-maintenance(1). See
+ * Documentation/technical/grep-index-format.txt for the format.
+ */
+struct grep_index;
+
+/*
+ * Load the grep index of "r", if it has one and core.grepIndex is not
+ * false. Returns NULL otherwise.
+ */
+struct grep_index *prepare_grep_index(struct repository *r);
+
+void close_grep_index(struct raw_object_store *o);
+
+/*
+ * The blobs of a grep index that can match the patterns of a grep_opt.
+ */
+struct grep_index_filter;
+
+/*
+ * Find the blobs in the grep index of "r" that can match the compiled
+ * patterns of "opt". Returns NULL if there is no index, or if "opt"
+ * asks for something that does not need the patterns to match, such as
+ * --invert-match, in which case every blob has to be searched.
+ */
+struct grep_index_filter *grep_index_filter(struct repository *r,
+					    struct grep_opt *opt);
+
+/*
+ * Can the blob "oid" match? Blobs that are not in the index always can.
+ */
+int grep_index_filter_may_match(struct grep_index_filter *f,
+				const struct object_id *oid);
+
+void grep_index_filter_free(struct grep_index_filter *f);
+
+/*
+ * Write the grep index of "r" for the blobs in the trees of its refs,
+ * reusing what the old one knows about blobs that are still there.
+ * "flags" can have SIDE_INDEX_WRITE_PROGRESS. Returns 0 on success.
+ */
+int write_grep_index(struct repository *r, unsigned flags);
+
+#endif /* GREP_INDEX_H */
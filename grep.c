@@ -9,6 +9,7 @@
 #include "commit.h"
 #include "quote.h"
 #include "help.h"
+#include "kwset.h"
 
 static int grep_source_load(struct grep_source *gs);
 static int grep_source_is_binary(struct grep_source *gs,
@@ -704,6 +705,37 @@ static struct grep_expr *grep_splice_or(struct grep_expr *x, struct grep_expr *y
 	return z;
 }
 
+/*
+ * When the patterns are two or more strings without any characters
+ * special to regular expressions, and a line matches if any one of them
+ * does, look for all of them in a single pass with a kwset, instead of
+ * scanning each line once for every pattern.
+ *
+ * Case-insensitive matching is left to the regex engines, which know
+ * how the locale folds non-ASCII characters.
+ */
+static void compile_fixed_kwset(struct grep_opt *opt)
+{
+	struct grep_pat *p;
+	int nr = 0;
+
+	if (opt->ignore_case)
+		return;
+	for (p = opt->pattern_list; p; p = p->next) {
+		if (p->token != GREP_PATTERN || !p->patternlen ||
+		    !(p->fixed || is_fixed(p->pattern, p->patternlen)))
+			return;
+		nr++;
+	}
+	if (nr < 2)
+		return;
+
+	opt->kws = kwsalloc(NULL);
+	for (p = opt->pattern_list; p; p = p->next)
+		kwsincr(opt->kws, p->pattern, p->patternlen);
+	kwsprep(opt->kws);
+}
+
 void compile_grep_patterns(struct grep_opt *opt)
 {
 	struct grep_pat *p;
@@ -724,8 +756,10 @@ void compile_grep_patterns(struct grep_opt *opt)
 
 	if (opt->all_match || opt->no_body_match || header_expr)
 		opt->extended = 1;
-	else if (!opt->extended)
+	else if (!opt->extended) {
+		compile_fixed_kwset(opt);
 		return;
+	}
 
 	p = opt->pattern_list;
 	if (p)
@@ -790,6 +824,9 @@ void free_grep_patterns(struct grep_opt *opt)
 		free(p);
 	}
 
+	if (opt->kws)
+		kwsfree(opt->kws);
+
 	if (!opt->extended)
 		return;
 	free_pattern_expr(opt->pattern_expression);
@@ -1056,6 +1093,23 @@ static int match_line(struct grep_opt *opt,
 		return match_expr(opt, bol, eol, ctx, col, icol,
 				  collect_hits);
 
+	if (opt->kws) {
+		struct kwsmatch kwsm;
+		size_t offset = kwsexec(opt->kws, bol, eol - bol, &kwsm);
+
+		if (offset == -1)
+			return 0;
+		/*
+		 * The leftmost match of any pattern is what we would find
+		 * below; only with -w may it not count.
+		 */
+		if (!opt->word_regexp) {
+			if (opt->columnnum && (*col < 0 || offset < *col))
+				*col = offset;
+			return 1;
+		}
+	}
+
 	/* we do not call with collect_hits without being extended */
 	for (p = opt->pattern_list; p; p = p->next) {
 		regmatch_t tmp;
@@ -1108,6 +1162,23 @@ int grep_next_match(struct grep_opt *opt,
 	int hit = 0;
 
 	pmatch->rm_so = pmatch->rm_eo = -1;
+	if (opt->kws && !opt->word_regexp && ctx != GREP_CONTEXT_HEAD) {
+		/*
+		 * Like match_next_pattern(), kwsexec() picks the leftmost
+		 * match, and the longest one of those.
+		 */
+		struct kwsmatch kwsm;
+		size_t offset;
+
+		if (bol >= eol)
+			return 0;
+		offset = kwsexec(opt->kws, bol, eol - bol, &kwsm);
+		if (offset == -1)
+			return 0;
+		pmatch->rm_so = offset;
+		pmatch->rm_eo = offset + kwsm.size[0];
+		return 1;
+	}
 	if (bol < eol) {
 		for (p = ((ctx == GREP_CONTEXT_HEAD)
 			   ? opt->header_list : opt->pattern_list);
@@ -1192,7 +1263,7 @@ static void show_line(struct grep_opt *opt,
 		 */
 		show_line_header(opt, name, lno, cno, sign);
 	}
-	if (opt->color || opt->only_matching) {
+	if (want_color(opt->color) || opt->only_matching) {
 		regmatch_t match;
 		enum grep_context ctx = GREP_CONTEXT_BODY;
 		int eflags = 0;
@@ -1366,16 +1437,39 @@ static void show_pre_context(struct grep_opt *opt, struct grep_source *gs,
 	}
 }
 
+/*
+ * Does a line have to match at least one of the patterns in "x" for
+ * the whole expression to match it?
+ */
+static int expr_needs_atom(struct grep_expr *x)
+{
+	switch (x->node) {
+	case GREP_NODE_ATOM:
+		return 1;
+	case GREP_NODE_AND:
+		return expr_needs_atom(x->u.binary.left) ||
+			expr_needs_atom(x->u.binary.right);
+	case GREP_NODE_OR:
+		return expr_needs_atom(x->u.binary.left) &&
+			expr_needs_atom(x->u.binary.right);
+	default:
+		return 0; /* "--not" and the true node match lines without any */
+	}
+}
+
 static int should_lookahead(struct grep_opt *opt)
 {
 	struct grep_pat *p;
 
-	if (opt->extended)
-		return 0; /* punt for too complex stuff */
 	if (opt->invert)
 		return 0;
+	if (opt->extended &&
+	    !(opt->pattern_expression &&
+	      expr_needs_atom(opt->pattern_expression)))
+		return 0; /* punt for too complex stuff */
 	for (p = opt->pattern_list; p; p = p->next) {
-		if (p->token != GREP_PATTERN)
+		if (p->token == GREP_PATTERN_HEAD ||
+		    p->token == GREP_PATTERN_BODY)
 			return 0; /* punt for "header only" and stuff */
 	}
 	return 1;
@@ -1389,18 +1483,41 @@ static int look_ahead(struct grep_opt *opt,
 	unsigned lno = *lno_p;
 	const char *bol = *bol_p;
 	struct grep_pat *p;
-	const char *sp, *last_bol;
+	const char *sp, *last_bol, *end = bol + *left_p;
 	regoff_t earliest = -1;
 
-	for (p = opt->pattern_list; p; p = p->next) {
-		int hit;
+	if (opt->kws) {
+		struct kwsmatch kwsm;
+		size_t offset = kwsexec(opt->kws, bol, *left_p, &kwsm);
+
+		if (offset != -1)
+			earliest = offset;
+	}
+
+	for (p = opt->kws ? NULL : opt->pattern_list; p; p = p->next) {
 		regmatch_t m;
 
-		hit = patmatch(p, bol, bol + *left_p, &m, 0);
-		if (!hit || m.rm_so < 0 || m.rm_eo < 0)
+		if (p->token != GREP_PATTERN)
+			continue; /* an operator in an extended expression */
+
+		/*
+		 * Where we last found this pattern is still its earliest
+		 * match from "bol" on until we have gone past it, so
+		 * search again only then. Otherwise a pattern that does
+		 * not occur would be searched for to the end of the
+		 * buffer after each hit of another one.
+		 */
+		if (!p->lookahead_hit || p->lookahead_hit < bol) {
+			if (patmatch(p, bol, end, &m, 0) &&
+			    m.rm_so >= 0 && m.rm_eo >= 0)
+				p->lookahead_hit = bol + m.rm_so;
+			else
+				p->lookahead_hit = end;
+		}
+		if (p->lookahead_hit == end)
 			continue;
-		if (earliest < 0 || m.rm_so < earliest)
-			earliest = m.rm_so;
+		if (earliest < 0 || p->lookahead_hit - bol < earliest)
+			earliest = p->lookahead_hit - bol;
 	}
 
 	if (earliest < 0) {
@@ -1573,6 +1690,12 @@ static int grep_source_1(struct grep_opt *opt, struct grep_source *gs, int colle
 
 	bol = gs->buf;
 	left = gs->size;
+	if (try_lookahead) {
+		struct grep_pat *p;
+
+		for (p = opt->pattern_list; p; p = p->next)
+			p->lookahead_hit = NULL;
+	}
 	while (left) {
 		const char *eol;
 		int hit;
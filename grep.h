@@ -83,6 +83,9 @@ struct grep_pat {
 	unsigned is_fixed:1;
 	unsigned ignore_case:1;
 	unsigned word_regexp:1;
+
+	/* where look_ahead() last found this pattern in the buffer */
+	const char *lookahead_hit;
 };
 
 enum grep_expr_node {
@@ -114,6 +117,8 @@ struct grep_expr {
 	} u;
 };
 
+struct kwset_t;
+
 struct grep_opt {
 	struct grep_pat *pattern_list;
 	struct grep_pat **pattern_tail;
@@ -121,6 +126,13 @@ struct grep_opt {
 	struct grep_pat **header_tail;
 	struct grep_expr *pattern_expression;
 
+	/*
+	 * All the patterns in pattern_list, when they are two or more
+	 * fixed strings any one of which makes a line match. See
+	 * compile_fixed_kwset().
+	 */
+	struct kwset_t *kws;
+
 	/*
 	 * NEEDSWORK: See if we can remove this field, because the repository
 	 * should probably be per-source. That is, grep.c functions using this
@@ -1079,7 +1079,7 @@ static int process_diff_filepair(struct rev_info *rev,
 
 static struct diff_filepair *diff_filepair_dup(struct diff_filepair *pair)
 {
-	struct diff_filepair *new_filepair = xmalloc(sizeof(struct diff_filepair));
+	struct diff_filepair *new_filepair = xcalloc(1, sizeof(struct diff_filepair));
 	new_filepair->one = pair->one;
 	new_filepair->two = pair->two;
 	new_filepair->one->count++;
@@ -1147,35 +1147,19 @@ int line_log_print(struct rev_info *rev, struct commit *commit)
 	return 1;
 }
 
+/*
+ * Returns 0 if the changed-path Bloom filter of "commit" says that none
+ * of the files in "range" differ from the first parent, which can then
+ * take all the blame without looking at the trees.
+ */
 static int bloom_filter_check(struct rev_info *rev,
 			      struct commit *commit,
 			      struct line_log_data *range)
 {
-	struct bloom_filter *filter;
-	struct bloom_key key;
-	int result = 0;
-
-	if (!commit->parents)
-		return 1;
-
-	if (!rev->bloom_filter_settings ||
-	    !(filter = get_bloom_filter(rev->repo, commit)))
-		return 1;
-
-	if (!range)
-		return 0;
-
-	while (!result && range) {
-		fill_bloom_key(range->path, strlen(range->path), &key, rev->bloom_filter_settings);
-
-		if (bloom_filter_contains(filter, &key, rev->bloom_filter_settings))
-			result = 1;
-
-		clear_bloom_key(&key);
-		range = range->next;
-	}
-
-	return result;
+	for (; range; range = range->next)
+		if (check_path_in_bloom_filter(rev, commit, range->path))
+			return 1;
+	return 0;
 }
 
 static int process_ranges_ordinary_commit(struct rev_info *rev, struct commit *commit,
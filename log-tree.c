@@ -2,7 +2,10 @@
 #include "commit-reach.h"
 #include "config.h"
 #include "diff.h"
+#include "diff-prefetch.h"
+#include "diffstat-index.h"
 #include "object-store.h"
+#include "promisor-remote.h"
 #include "repository.h"
 #include "tmp-objdir.h"
 #include "commit.h"
@@ -1008,6 +1011,83 @@ static int do_remerge_diff(struct rev_info *opt,
 	return !opt->loginfo;
 }
 
+/*
+ * Can the tree diffs of this walk be computed ahead of time, before
+ * log_tree_commit() is called for each commit? This rules out anything
+ * that has the revision walk and the output interleave (--graph,
+ * --show-linear-break, reflogs), diffs that depend on the result of
+ * earlier diffs (--follow, --quiet) and tree diffs that look at more
+ * than the object database.
+ */
+int log_tree_prefetch_supported(struct rev_info *opt)
+{
+	if (!opt->diff || opt->line_level_traverse)
+		return 0;
+	if (opt->graph || opt->track_linear || opt->reflog_info ||
+	    opt->early_output || opt->boundary || opt->full_diff ||
+	    opt->remerge_diff)
+		return 0;
+	if (opt->diffopt.flags.follow_renames || opt->diffopt.flags.quick ||
+	    opt->diffopt.max_changes ||
+	    (opt->diffopt.pathspec.magic & PATHSPEC_ATTR))
+		return 0;
+	if (has_promisor_remote())
+		return 0;
+	return 1;
+}
+
+/*
+ * Queue the tree diff log_tree_diff() is going to compute for this
+ * commit, so that it can be replayed from opt->diff_prefetch.
+ */
+void log_tree_prefetch(struct rev_info *opt, struct commit *commit)
+{
+	struct commit_list *parents;
+
+	if (!opt->diff_prefetch || repo_parse_commit(opt->repo, commit))
+		return;
+
+	parents = get_saved_parents(opt, commit);
+	if (!parents) {
+		if (opt->show_root_diff)
+			diff_prefetch_add(opt->diff_prefetch, NULL,
+					  get_commit_tree_oid(commit));
+		return;
+	}
+
+	/* Of the merge diffs, only a diff to the first parent is a tree diff */
+	if (parents->next &&
+	    (opt->combine_merges || !opt->separate_merges ||
+	     !opt->first_parent_merges))
+		return;
+
+	if (repo_parse_commit(opt->repo, parents->item))
+		return;
+	diff_prefetch_add(opt->diff_prefetch,
+			  get_commit_tree_oid(parents->item),
+			  get_commit_tree_oid(commit));
+}
+
+static void log_tree_diff_tree_oid(struct rev_info *opt,
+				   const struct object_id *old_oid,
+				   const struct object_id *new_oid)
+{
+	if (opt->diff_prefetch &&
+	    diff_prefetch_replay(opt->diff_prefetch, old_oid, new_oid,
+				 &opt->diffopt))
+		return;
+	diff_tree_oid(old_oid, new_oid, "", &opt->diffopt);
+}
+
+static void log_tree_diff_commits(struct rev_info *opt,
+				  struct commit *parent, struct commit *commit)
+{
+	if (diffstat_index_queue(&opt->diffopt, parent, commit))
+		return;
+	log_tree_diff_tree_oid(opt, parent ? get_commit_tree_oid(parent) : NULL,
+			       get_commit_tree_oid(commit));
+}
+
 /*
  * Show the diff of a commit.
  *
@@ -1035,7 +1115,7 @@ static int log_tree_diff(struct rev_info *opt, struct commit *commit, struct log
 	/* Root commit? */
 	if (!parents) {
 		if (opt->show_root_diff) {
-			diff_root_tree_oid(oid, "", &opt->diffopt);
+			log_tree_diff_commits(opt, NULL, commit);
 			log_tree_diff_flush(opt);
 		}
 		return !opt->loginfo;
@@ -1070,8 +1150,10 @@ static int log_tree_diff(struct rev_info *opt, struct commit *commit, struct log
 		struct commit *parent = parents->item;
 
 		parse_commit_or_die(parent);
-		diff_tree_oid(get_commit_tree_oid(parent),
-			      oid, "", &opt->diffopt);
+		if (opt->diffopt.flags.follow_renames)
+			diff_tree_follow(opt, parent, commit);
+		else
+			log_tree_diff_commits(opt, parent, commit);
 		log_tree_diff_flush(opt);
 
 		showed_log |= !opt->loginfo;
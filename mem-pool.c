@@ -84,6 +84,27 @@ void mem_pool_discard(struct mem_pool *pool, int invalidate_memory)
 	pool->pool_alloc = 0;
 }
 
+void mem_pool_clear(struct mem_pool *pool)
+{
+	struct mp_block *keep = pool->mp_block;
+	size_t keep_size;
+
+	/* do not hold on to a block that was made for a large allocation */
+	if (!keep ||
+	    (keep_size = keep->end - (char *)keep->space) > pool->block_alloc) {
+		mem_pool_discard(pool, 0);
+		return;
+	}
+
+	pool->mp_block = keep->next_block;
+	mem_pool_discard(pool, 0);
+
+	keep->next_block = NULL;
+	keep->next_free = (char *)keep->space;
+	pool->mp_block = keep;
+	pool->pool_alloc = sizeof(struct mp_block) + keep_size;
+}
+
 void *mem_pool_alloc(struct mem_pool *pool, size_t len)
 {
 	struct mp_block *p = NULL;
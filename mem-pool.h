@@ -31,6 +31,12 @@ void mem_pool_init(struct mem_pool *pool, size_t initial_size);
  */
 void mem_pool_discard(struct mem_pool *pool, int invalidate_memory);
 
+/*
+ * Forget about everything allocated from the memory pool, but keep one
+ * of its blocks around for the allocations to come.
+ */
+void mem_pool_clear(struct mem_pool *pool);
+
 /*
  * Alloc memory from the mem_pool.
  */
@@ -1071,6 +1071,8 @@ static int write_midx_bitmap(char *midx_name, unsigned char *midx_hash,
 
 	if (flags & MIDX_WRITE_BITMAP_HASH_CACHE)
 		options |= BITMAP_OPT_HASH_CACHE;
+	if (flags & MIDX_WRITE_BITMAP_COMMIT_ATTRIBUTES)
+		options |= BITMAP_OPT_COMMIT_ATTRIBUTES;
 
 	prepare_midx_packing_data(&pdata, ctx);
 
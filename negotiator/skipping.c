@@ -2,6 +2,7 @@
 #include "skipping.h"
 #include "../commit.h"
 #include "../fetch-negotiator.h"
+#include "../pack-bitmap.h"
 #include "../prio-queue.h"
 #include "../refs.h"
 #include "../tag.h"
@@ -26,6 +27,12 @@
  */
 #define POPPED		(1U << 5)
 
+/*
+ * The largest number of commits to skip between two haves in the bitmap
+ * mode.
+ */
+#define MAX_SKIP	1023
+
 static int marked;
 
 /*
@@ -39,6 +46,12 @@ struct entry {
 	 */
 	uint16_t original_ttl;
 	uint16_t ttl;
+
+	/*
+	 * The commit is at the tip of a ref. In the bitmap mode, tips are
+	 * sent first, and even if the walk from another tip would skip them.
+	 */
+	unsigned tip : 1;
 };
 
 struct data {
@@ -48,6 +61,25 @@ struct data {
 	 * The number of non-COMMON commits in rev_list.
 	 */
 	int non_common_revs;
+
+	/*
+	 * Set for fetch.negotiationAlgorithm=bitmap, which differs from the
+	 * plain skipping negotiator in that:
+	 *
+	 *  - Commits are walked in generation number order when the
+	 *    commit-graph has them, so that clock skew cannot make us pop a
+	 *    commit before its descendants.
+	 *
+	 *  - The distance between the haves sent along a line of history
+	 *    doubles (up to MAX_SKIP) instead of growing by half, and the
+	 *    tips of refs are sent before anything else.
+	 *
+	 *  - When the server acknowledges a commit that has a stored bitmap
+	 *    in "bitmap_git", every queued commit that is reachable from it
+	 *    is marked as COMMON at once.
+	 */
+	unsigned bitmap : 1;
+	struct bitmap_index *bitmap_git;
 };
 
 static int compare(const void *a_, const void *b_, void *unused)
@@ -57,11 +89,25 @@ static int compare(const void *a_, const void *b_, void *unused)
 	return compare_commits_by_commit_date(a->commit, b->commit, NULL);
 }
 
+static int compare_bitmap(const void *a_, const void *b_, void *unused)
+{
+	const struct entry *a = a_;
+	const struct entry *b = b_;
+
+	if (a->tip != b->tip)
+		return a->tip ? -1 : 1;
+	return compare_commits_by_gen_then_commit_date(a->commit, b->commit, NULL);
+}
+
 static struct entry *rev_list_push(struct data *data, struct commit *commit, int mark)
 {
 	struct entry *entry;
 	commit->object.flags |= mark | SEEN;
 
+	/* the bitmap mode orders the queue by generation number */
+	if (data->bitmap)
+		parse_commit(commit);
+
 	CALLOC_ARRAY(entry, 1);
 	entry->commit = commit;
 	prio_queue_put(&data->rev_list, entry);
@@ -103,6 +149,65 @@ static void mark_common(struct data *data, struct commit *c)
 	}
 }
 
+/*
+ * Mark the queued commits that the stored bitmap of "c" says are
+ * reachable from it as COMMON.
+ */
+static void mark_common_from_bitmap(struct data *data, struct commit *c)
+{
+	struct commit **commits;
+	const struct object_id **oids;
+	unsigned char *reachable;
+	int i, nr = 0;
+
+	if (!data->bitmap_git || !data->non_common_revs)
+		return;
+
+	ALLOC_ARRAY(commits, data->rev_list.nr);
+	ALLOC_ARRAY(oids, data->rev_list.nr);
+	for (i = 0; i < data->rev_list.nr; i++) {
+		struct entry *entry = data->rev_list.array[i].data;
+
+		if (entry->commit->object.flags & COMMON)
+			continue;
+		commits[nr] = entry->commit;
+		oids[nr] = &entry->commit->object.oid;
+		nr++;
+	}
+	reachable = xmalloc(nr);
+
+	if (bitmap_commit_contains_many(data->bitmap_git, c, nr, oids,
+					reachable) > 0) {
+		int marked_common = 0;
+
+		for (i = 0; i < nr; i++) {
+			if (!reachable[i] || (commits[i]->object.flags & COMMON))
+				continue;
+			mark_common(data, commits[i]);
+			marked_common++;
+		}
+		trace2_data_intmax("negotiator", the_repository,
+				   "bitmap/marked-common", marked_common);
+	}
+
+	free(reachable);
+	free(oids);
+	free(commits);
+}
+
+/*
+ * The ttl that a parent of "entry" gets when "entry" was sent as a
+ * have, i.e. the number of commits to skip before sending the next one.
+ */
+static uint16_t next_original_ttl(struct data *data, struct entry *entry)
+{
+	if (!data->bitmap)
+		return entry->original_ttl * 3 / 2 + 1;
+	if (entry->original_ttl < MAX_SKIP / 2)
+		return entry->original_ttl * 2 + 1;
+	return MAX_SKIP;
+}
+
 /*
  * Ensure that the priority queue has an entry for to_push, and ensure that the
  * entry has the correct flags and ttl.
@@ -141,9 +246,9 @@ static int push_parent(struct data *data, struct entry *entry,
 
 	if (entry->commit->object.flags & (COMMON | ADVERTISED)) {
 		mark_common(data, to_push);
-	} else {
+	} else if (!parent_entry->tip) {
 		uint16_t new_original_ttl = entry->ttl
-			? entry->original_ttl : entry->original_ttl * 3 / 2 + 1;
+			? entry->original_ttl : next_original_ttl(data, entry);
 		uint16_t new_ttl = entry->ttl
 			? entry->ttl - 1 : new_original_ttl;
 		if (parent_entry->original_ttl < new_original_ttl) {
@@ -204,10 +309,12 @@ static void known_common(struct fetch_negotiator *n, struct commit *c)
 
 static void add_tip(struct fetch_negotiator *n, struct commit *c)
 {
+	struct data *data = n->data;
+
 	n->known_common = NULL;
 	if (c->object.flags & SEEN)
 		return;
-	rev_list_push(n->data, c, 0);
+	rev_list_push(data, c, 0)->tip = data->bitmap;
 }
 
 static const struct object_id *next(struct fetch_negotiator *n)
@@ -224,16 +331,21 @@ static int ack(struct fetch_negotiator *n, struct commit *c)
 		die("received ack for commit %s not sent as 'have'\n",
 		    oid_to_hex(&c->object.oid));
 	mark_common(n->data, c);
+	if (!known_to_be_common)
+		mark_common_from_bitmap(n->data, c);
 	return known_to_be_common;
 }
 
 static void release(struct fetch_negotiator *n)
 {
-	clear_prio_queue(&((struct data *)n->data)->rev_list);
+	struct data *data = n->data;
+
+	clear_prio_queue(&data->rev_list);
+	free_bitmap_index(data->bitmap_git);
 	FREE_AND_NULL(n->data);
 }
 
-void skipping_negotiator_init(struct fetch_negotiator *negotiator)
+static struct data *init(struct fetch_negotiator *negotiator)
 {
 	struct data *data;
 	negotiator->known_common = known_common;
@@ -242,9 +354,26 @@ void skipping_negotiator_init(struct fetch_negotiator *negotiator)
 	negotiator->ack = ack;
 	negotiator->release = release;
 	negotiator->data = CALLOC_ARRAY(data, 1);
-	data->rev_list.compare = compare;
 
 	if (marked)
 		for_each_ref(clear_marks, NULL);
 	marked = 1;
+	return data;
+}
+
+void skipping_negotiator_init(struct fetch_negotiator *negotiator)
+{
+	struct data *data = init(negotiator);
+
+	data->rev_list.compare = compare;
+}
+
+void bitmap_negotiator_init(struct repository *r,
+			    struct fetch_negotiator *negotiator)
+{
+	struct data *data = init(negotiator);
+
+	data->rev_list.compare = compare_bitmap;
+	data->bitmap = 1;
+	data->bitmap_git = prepare_bitmap_git(r);
 }
@@ -2,7 +2,16 @@
 #define NEGOTIATOR_SKIPPING_H
 
 struct fetch_negotiator;
+struct repository;
 
 void skipping_negotiator_init(struct fetch_negotiator *negotiator);
 
+/*
+ * Like skipping_negotiator_init(), but walk in generation number order,
+ * skip further and use the reachability bitmaps of "r" to find common
+ * commits (fetch.negotiationAlgorithm=bitmap).
+ */
+void bitmap_negotiator_init(struct repository *r,
+			    struct fetch_negotiator *negotiator);
+
 #endif
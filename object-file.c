@@ -1509,19 +1509,17 @@ pthread_mutex_t obj_read_mutex;
 
 void enable_obj_read_lock(void)
 {
-	if (obj_read_use_lock)
+	if (obj_read_use_lock++)
 		return;
 
-	obj_read_use_lock = 1;
 	init_recursive_mutex(&obj_read_mutex);
 }
 
 void disable_obj_read_lock(void)
 {
-	if (!obj_read_use_lock)
+	if (!obj_read_use_lock || --obj_read_use_lock)
 		return;
 
-	obj_read_use_lock = 0;
 	pthread_mutex_destroy(&obj_read_mutex);
 }
 
@@ -185,6 +185,12 @@ struct raw_object_store {
 	struct commit_graph *commit_graph;
 	unsigned commit_graph_attempted : 1; /* if loading has been attempted */
 
+	struct diffstat_index *diffstat_index;
+	unsigned diffstat_index_attempted : 1; /* if loading has been attempted */
+
+	struct grep_index *grep_index;
+	unsigned grep_index_attempted : 1; /* if loading has been attempted */
+
 	/*
 	 * private data
 	 *
@@ -367,6 +373,11 @@ void assert_oid_type(const struct object_id *oid, enum object_type expect);
  * reading functions. However, beware that in these cases zlib inflation won't
  * be performed in parallel, losing performance.
  *
+ * Enabling and disabling nest: the lock stays in use until every caller
+ * that enabled it has disabled it again, so that e.g. threads that are
+ * started while others are reading objects do not pull the lock out
+ * from under those.
+ *
  * TODO: oid_object_info_extended()'s call stack has a recursive behavior. If
  * any of its callees end up calling it, this recursive call won't benefit from
  * parallel inflation.
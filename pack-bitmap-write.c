@@ -683,6 +683,116 @@ static void write_hash_cache(struct hashfile *f,
 	}
 }
 
+/*
+ * The number of commit-date buckets written with the commit attributes.
+ * Each holds about the same number of commits.
+ */
+#define COMMIT_DATE_BUCKETS 32
+
+struct commit_attributes_entry {
+	uint32_t pos;
+	timestamp_t date;
+	unsigned merge:1;
+};
+
+static int commit_attributes_pos_cmp(const void *va, const void *vb)
+{
+	const struct commit_attributes_entry *a = va, *b = vb;
+	return a->pos < b->pos ? -1 : a->pos > b->pos;
+}
+
+static int timestamp_cmp(const void *va, const void *vb)
+{
+	timestamp_t a = *(const timestamp_t *)va, b = *(const timestamp_t *)vb;
+	return a < b ? -1 : a > b;
+}
+
+static void write_commit_attributes(struct hashfile *f,
+				    struct pack_idx_entry **index,
+				    uint32_t index_nr)
+{
+	struct bitmap *commits = ewah_to_bitmap(writer.commits);
+	struct commit_attributes_entry *entries;
+	struct ewah_bitmap *merges = ewah_new();
+	struct ewah_bitmap *buckets[COMMIT_DATE_BUCKETS];
+	timestamp_t starts[COMMIT_DATE_BUCKETS], ends[COMMIT_DATE_BUCKETS];
+	timestamp_t *dates;
+	uint32_t i, nr = 0, buckets_nr = 0;
+
+	ALLOC_ARRAY(entries, index_nr);
+	for (i = 0; i < index_nr; i++) {
+		struct object_entry *entry = (struct object_entry *)index[i];
+		uint32_t pos = oe_in_pack_pos(writer.to_pack, entry);
+		struct commit *c;
+
+		if (!bitmap_get(commits, pos))
+			continue;
+
+		c = lookup_commit(writer.to_pack->repo, &entry->idx.oid);
+		if (!c || repo_parse_commit(writer.to_pack->repo, c))
+			die(_("unable to parse commit %s"),
+			    oid_to_hex(&entry->idx.oid));
+
+		entries[nr].pos = pos;
+		entries[nr].date = c->date;
+		entries[nr].merge = c->parents && c->parents->next;
+		nr++;
+	}
+
+	/* EWAH bitmaps must be built in bit order */
+	QSORT(entries, nr, commit_attributes_pos_cmp);
+	for (i = 0; i < nr; i++)
+		if (entries[i].merge)
+			ewah_set(merges, entries[i].pos);
+
+	/* pick bucket boundaries at evenly spaced commit dates */
+	ALLOC_ARRAY(dates, nr);
+	for (i = 0; i < nr; i++)
+		dates[i] = entries[i].date;
+	QSORT(dates, nr, timestamp_cmp);
+	for (i = 0; i < COMMIT_DATE_BUCKETS && nr; i++) {
+		timestamp_t start = dates[(uint64_t)i * nr / COMMIT_DATE_BUCKETS];
+		if (!buckets_nr || start > starts[buckets_nr - 1])
+			starts[buckets_nr++] = start;
+	}
+	for (i = 0; i < buckets_nr; i++) {
+		buckets[i] = ewah_new();
+		ends[i] = starts[i];
+	}
+
+	for (i = 0; i < nr; i++) {
+		uint32_t lo = 0, hi = buckets_nr;
+
+		/* find the last bucket that starts at or before this date */
+		while (hi - lo > 1) {
+			uint32_t mi = lo + (hi - lo) / 2;
+			if (starts[mi] <= entries[i].date)
+				lo = mi;
+			else
+				hi = mi;
+		}
+		ewah_set(buckets[lo], entries[i].pos);
+		if (entries[i].date > ends[lo])
+			ends[lo] = entries[i].date;
+	}
+
+	hashwrite_be32(f, buckets_nr);
+	for (i = 0; i < buckets_nr; i++) {
+		hashwrite_be64(f, starts[i]);
+		hashwrite_be64(f, ends[i]);
+	}
+	dump_bitmap(f, merges);
+	for (i = 0; i < buckets_nr; i++) {
+		dump_bitmap(f, buckets[i]);
+		ewah_free(buckets[i]);
+	}
+
+	ewah_free(merges);
+	bitmap_free(commits);
+	free(entries);
+	free(dates);
+}
+
 void bitmap_writer_set_checksum(unsigned char *sha1)
 {
 	hashcpy(writer.pack_checksum, sha1);
@@ -717,6 +827,9 @@ void bitmap_writer_finish(struct pack_idx_entry **index,
 	dump_bitmap(f, writer.tags);
 	write_selected_commits_v1(f, index, index_nr);
 
+	if (options & BITMAP_OPT_COMMIT_ATTRIBUTES)
+		write_commit_attributes(f, index, index_nr);
+
 	if (options & BITMAP_OPT_HASH_CACHE)
 		write_hash_cache(f, index, index_nr);
 
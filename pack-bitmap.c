@@ -15,6 +15,7 @@
 #include "list-objects-filter-options.h"
 #include "midx.h"
 #include "config.h"
+#include "trace2.h"
 
 /*
  * An entry on the bitmap index, representing the bitmap for a given
@@ -79,6 +80,20 @@ struct bitmap_index {
 	/* If not NULL, this is a name-hash cache pointing into map. */
 	uint32_t *hashes;
 
+	/* The BITMAP_OPT_* flags of the bitmap index */
+	uint32_t options;
+
+	/*
+	 * Commit attributes (BITMAP_OPT_COMMIT_ATTRIBUTES), if the bitmap
+	 * has them: the commits with more than one parent, and the commits
+	 * grouped by commit date, with the oldest and newest date in each
+	 * group.
+	 */
+	struct ewah_bitmap *merges;
+	struct ewah_bitmap **date_buckets;
+	timestamp_t *date_bucket_min, *date_bucket_max;
+	uint32_t date_buckets_nr;
+
 	/* The checksum of the packfile or MIDX; points into map. */
 	const unsigned char *checksum;
 
@@ -187,6 +202,7 @@ static int load_bitmap_header(struct bitmap_index *index)
 		}
 	}
 
+	index->options = ntohs(header->options);
 	index->entry_count = ntohl(header->entry_count);
 	index->checksum = header->checksum;
 	index->map_pos += header_size;
@@ -290,6 +306,36 @@ static int load_bitmap_entries_v1(struct bitmap_index *index)
 	return 0;
 }
 
+static int load_commit_attributes(struct bitmap_index *index)
+{
+	uint32_t i, nr;
+
+	if (index->map_size - index->map_pos < 4)
+		return error(_("corrupt bitmap commit attributes: truncated header"));
+	nr = read_be32(index->map, &index->map_pos);
+	if ((index->map_size - index->map_pos) / 16 < nr)
+		return error(_("corrupt bitmap commit attributes: too many date buckets"));
+
+	ALLOC_ARRAY(index->date_bucket_min, nr);
+	ALLOC_ARRAY(index->date_bucket_max, nr);
+	CALLOC_ARRAY(index->date_buckets, nr);
+	for (i = 0; i < nr; i++) {
+		index->date_bucket_min[i] = get_be64(index->map + index->map_pos);
+		index->date_bucket_max[i] = get_be64(index->map + index->map_pos + 8);
+		index->map_pos += 16;
+	}
+	/* only count the bucket bitmaps read so far, for free_bitmap_index() */
+	if (!(index->merges = read_bitmap_1(index)))
+		return -1;
+	for (i = 0; i < nr; i++) {
+		if (!(index->date_buckets[i] = read_bitmap_1(index)))
+			return -1;
+		index->date_buckets_nr++;
+	}
+
+	return 0;
+}
+
 char *midx_bitmap_filename(struct multi_pack_index *midx)
 {
 	struct strbuf buf = STRBUF_INIT;
@@ -473,6 +519,10 @@ static int load_bitmap(struct bitmap_index *bitmap_git)
 	if (load_bitmap_entries_v1(bitmap_git) < 0)
 		goto failed;
 
+	if ((bitmap_git->options & BITMAP_OPT_COMMIT_ATTRIBUTES) &&
+	    load_commit_attributes(bitmap_git) < 0)
+		goto failed;
+
 	return 0;
 
 failed:
@@ -1231,8 +1281,43 @@ static int can_filter_bitmap(struct list_objects_filter_options *filter)
 	return !filter_bitmap(NULL, NULL, NULL, filter);
 }
 
-struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
-					 int filter_provided_objects)
+/*
+ * Whether the commits of the walk are all the commits reachable from the
+ * positive tips and not from the negative ones, as far as the options that
+ * the bitmap walks do not handle at all are concerned.
+ */
+static int can_select_commits(struct rev_info *revs)
+{
+	return !revs->exclude_first_parent_only &&
+		revs->max_age == -1 &&
+		!revs->ancestry_path &&
+		!revs->no_walk &&
+		!revs->reflog_info &&
+		!revs->simplify_by_decoration &&
+		!revs->boundary &&
+		!revs->line_level_traverse &&
+		revs->skip_count < 0 &&
+		!revs->left_only && !revs->right_only &&
+		!revs->cherry_pick &&
+		!revs->grep_filter.pattern_list &&
+		!revs->grep_filter.header_list;
+}
+
+/*
+ * Whether the walk limits the commits it shows in a way that only
+ * prepare_bitmap_commit_walk() knows how to handle.
+ */
+static int has_commit_limits(struct rev_info *revs)
+{
+	return revs->first_parent_only ||
+		revs->min_age != -1 ||
+		revs->max_age_as_filter != -1 ||
+		revs->min_parents ||
+		revs->max_parents >= 0;
+}
+
+static struct bitmap_index *prepare_bitmap_walk_1(struct rev_info *revs,
+						  int filter_provided_objects)
 {
 	unsigned int i;
 
@@ -1345,6 +1430,298 @@ struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
 	return NULL;
 }
 
+struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
+					 int filter_provided_objects)
+{
+	if (!can_select_commits(revs) || has_commit_limits(revs))
+		return NULL;
+	return prepare_bitmap_walk_1(revs, filter_provided_objects);
+}
+
+static struct commit *bitmap_commit_at(struct bitmap_index *bitmap_git,
+				       struct repository *r, uint32_t pos)
+{
+	struct object_id oid;
+
+	if (pos >= bitmap_num_objects(bitmap_git)) {
+		struct object *obj;
+
+		obj = bitmap_git->ext_index.objects[pos - bitmap_num_objects(bitmap_git)];
+		return obj->type == OBJ_COMMIT ? (struct commit *)obj : NULL;
+	}
+
+	if (bitmap_is_midx(bitmap_git))
+		nth_midxed_object_oid(&oid, bitmap_git->midx,
+				      pack_pos_to_midx(bitmap_git->midx, pos));
+	else
+		nth_bitmap_object_oid(bitmap_git, &oid,
+				      pack_pos_to_index(bitmap_git->pack, pos));
+	return lookup_commit(r, &oid);
+}
+
+/*
+ * Replace the result with the commits on the first-parent chains of
+ * "tips", stopping where a chain enters the commits we do not want.
+ */
+static void walk_first_parents(struct bitmap_index *bitmap_git,
+			       struct rev_info *revs,
+			       struct commit_list *tips)
+{
+	struct bitmap *result = bitmap_new();
+
+	for (; tips; tips = tips->next) {
+		struct commit *c = tips->item;
+
+		while (c) {
+			int pos = bitmap_position(bitmap_git, &c->object.oid);
+
+			if (pos < 0 || bitmap_get(result, pos) ||
+			    (bitmap_git->haves && bitmap_get(bitmap_git->haves, pos)))
+				break;
+			bitmap_set(result, pos);
+
+			if (repo_parse_commit(revs->repo, c))
+				die(_("unable to parse commit %s"),
+				    oid_to_hex(&c->object.oid));
+			c = c->parents ? c->parents->item : NULL;
+		}
+	}
+
+	bitmap_free(bitmap_git->result);
+	bitmap_git->result = result;
+}
+
+static int commit_passes_limits(struct rev_info *revs, struct commit *c)
+{
+	int n;
+
+	if (repo_parse_commit(revs->repo, c))
+		die(_("unable to parse commit %s"), oid_to_hex(&c->object.oid));
+
+	if (revs->min_age != -1 && c->date > revs->min_age)
+		return 0;
+	if (revs->max_age_as_filter != -1 && c->date < revs->max_age_as_filter)
+		return 0;
+
+	n = commit_list_count(c->parents);
+	return n >= revs->min_parents &&
+		(revs->max_parents < 0 || n <= revs->max_parents);
+}
+
+enum commit_selection {
+	SELECT_NONE,
+	SELECT_SOME,
+	SELECT_ALL,
+};
+
+static enum commit_selection select_by_parents(struct rev_info *revs,
+					       int merges)
+{
+	/* merges have 2 or more parents, the others 0 or 1 */
+	int lo = merges ? 2 : 0, hi = merges ? -1 : 1;
+
+	if ((revs->max_parents >= 0 && revs->max_parents < lo) ||
+	    (hi >= 0 && revs->min_parents > hi))
+		return SELECT_NONE;
+	if (revs->min_parents <= lo &&
+	    (revs->max_parents < 0 || (hi >= 0 && revs->max_parents >= hi)))
+		return SELECT_ALL;
+	return SELECT_SOME;
+}
+
+static enum commit_selection select_by_date(struct rev_info *revs,
+					    timestamp_t min, timestamp_t max)
+{
+	if ((revs->max_age_as_filter != -1 && max < revs->max_age_as_filter) ||
+	    (revs->min_age != -1 && min > revs->min_age))
+		return SELECT_NONE;
+	if ((revs->max_age_as_filter == -1 || min >= revs->max_age_as_filter) &&
+	    (revs->min_age == -1 || max <= revs->min_age))
+		return SELECT_ALL;
+	return SELECT_SOME;
+}
+
+static void add_selection(struct bitmap *drop, struct bitmap *check,
+			  struct bitmap *commits, enum commit_selection sel)
+{
+	if (sel == SELECT_NONE)
+		bitmap_or(drop, commits);
+	else if (sel == SELECT_SOME)
+		bitmap_or(check, commits);
+}
+
+/*
+ * Use the commit attributes of the bitmap to find which commits in the
+ * result are shown or not shown, and which we have to look at. Returns
+ * the latter, or NULL for all of them if there are no attributes.
+ */
+static struct bitmap *select_by_attributes(struct bitmap_index *bitmap_git,
+					   struct rev_info *revs)
+{
+	struct bitmap *merges, *drop, *check;
+	enum commit_selection sel_merges, sel_others;
+	uint32_t i;
+
+	if (!bitmap_git->date_buckets_nr)
+		return NULL;
+
+	merges = ewah_to_bitmap(bitmap_git->merges);
+	sel_merges = select_by_parents(revs, 1);
+	sel_others = select_by_parents(revs, 0);
+	drop = bitmap_new();
+	check = bitmap_new();
+
+	for (i = 0; i < bitmap_git->date_buckets_nr; i++) {
+		struct bitmap *bucket = ewah_to_bitmap(bitmap_git->date_buckets[i]);
+		struct bitmap *others, *bucket_merges;
+		enum commit_selection sel;
+
+		sel = select_by_date(revs, bitmap_git->date_bucket_min[i],
+				     bitmap_git->date_bucket_max[i]);
+		if (sel != SELECT_SOME && sel_merges == sel && sel_others == sel) {
+			add_selection(drop, check, bucket, sel);
+			bitmap_free(bucket);
+			continue;
+		}
+
+		others = bitmap_dup(bucket);
+		bitmap_and_not(others, merges);
+		bucket_merges = bucket;
+		bitmap_and_not(bucket_merges, others);
+
+		add_selection(drop, check, bucket_merges,
+			      sel == SELECT_NONE ? SELECT_NONE :
+			      sel == SELECT_ALL ? sel_merges :
+			      sel_merges == SELECT_NONE ? SELECT_NONE : SELECT_SOME);
+		add_selection(drop, check, others,
+			      sel == SELECT_NONE ? SELECT_NONE :
+			      sel == SELECT_ALL ? sel_others :
+			      sel_others == SELECT_NONE ? SELECT_NONE : SELECT_SOME);
+
+		bitmap_free(bucket_merges);
+		bitmap_free(others);
+	}
+
+	bitmap_and_not(bitmap_git->result, drop);
+
+	bitmap_free(drop);
+	bitmap_free(merges);
+	return check;
+}
+
+static void filter_commits_by_limits(struct bitmap_index *bitmap_git,
+				     struct rev_info *revs)
+{
+	struct bitmap *result = bitmap_git->result;
+	struct bitmap *check = select_by_attributes(bitmap_git, revs);
+	uint32_t num_objects = bitmap_num_objects(bitmap_git);
+	struct ewah_iterator it;
+	eword_t filter;
+	size_t i;
+	intmax_t checked = 0;
+
+	init_type_iterator(&it, bitmap_git, OBJ_COMMIT);
+	for (i = 0; i < result->word_alloc; i++) {
+		size_t base = i * BITS_IN_EWORD;
+		eword_t mask = 0, word;
+		unsigned offset;
+
+		if (ewah_iterator_next(&filter, &it))
+			mask = filter;
+		/* the extended index is not in the type bitmaps */
+		if (base + BITS_IN_EWORD > num_objects)
+			mask |= base >= num_objects ? ~(eword_t)0 :
+				~(eword_t)0 << (num_objects - base);
+
+		word = result->words[i] & mask;
+		if (!word)
+			continue;
+
+		for (offset = 0; offset < BITS_IN_EWORD; offset++) {
+			size_t pos;
+			struct commit *c;
+
+			if ((word >> offset) == 0)
+				break;
+			offset += ewah_bit_ctz64(word >> offset);
+			pos = base + offset;
+
+			/* nor in the commit attributes */
+			if (check && pos < num_objects && !bitmap_get(check, pos))
+				continue;
+
+			c = bitmap_commit_at(bitmap_git, revs->repo, pos);
+			if (!c)
+				continue;
+			checked++;
+			if (!commit_passes_limits(revs, c))
+				bitmap_unset(result, pos);
+		}
+	}
+
+	trace2_data_intmax("bitmap", revs->repo, "commit_limits/checked",
+			   checked);
+	bitmap_free(check);
+}
+
+struct bitmap_index *prepare_bitmap_commit_walk(struct rev_info *revs)
+{
+	struct bitmap_index *bitmap_git;
+	struct commit_list *tips = NULL;
+	unsigned int i;
+	unsigned first_parent_only = revs->first_parent_only;
+	timestamp_t min_age = revs->min_age;
+	timestamp_t max_age_as_filter = revs->max_age_as_filter;
+	int min_parents = revs->min_parents;
+	int max_parents = revs->max_parents;
+
+	if (!can_select_commits(revs) ||
+	    revs->tree_objects || revs->blob_objects || revs->tag_objects ||
+	    revs->filter.choice)
+		return NULL;
+
+	if (revs->first_parent_only) {
+		for (i = 0; i < revs->pending.nr; i++) {
+			struct object *obj = revs->pending.objects[i].item;
+			struct commit *c;
+
+			if (obj->flags & UNINTERESTING)
+				continue;
+			c = lookup_commit_reference_gently(revs->repo, &obj->oid, 1);
+			if (c)
+				commit_list_insert(c, &tips);
+		}
+	}
+
+	/*
+	 * find_objects() walks the parts of history that the bitmaps do
+	 * not cover, and that walk must see all of the commits.
+	 */
+	revs->first_parent_only = 0;
+	revs->min_age = revs->max_age_as_filter = -1;
+	revs->min_parents = 0;
+	revs->max_parents = -1;
+
+	bitmap_git = prepare_bitmap_walk_1(revs, 0);
+
+	revs->first_parent_only = first_parent_only;
+	revs->min_age = min_age;
+	revs->max_age_as_filter = max_age_as_filter;
+	revs->min_parents = min_parents;
+	revs->max_parents = max_parents;
+
+	if (bitmap_git) {
+		if (revs->first_parent_only)
+			walk_first_parents(bitmap_git, revs, tips);
+		if (revs->min_age != -1 || revs->max_age_as_filter != -1 ||
+		    revs->min_parents || revs->max_parents >= 0)
+			filter_commits_by_limits(bitmap_git, revs);
+	}
+
+	free_commit_list(tips);
+	return bitmap_git;
+}
+
 /*
  * -1 means "stop trying further objects"; 0 means we may or may not have
  * reused, but you can keep feeding bits.
@@ -1543,6 +1920,108 @@ int bitmap_walk_contains(struct bitmap_index *bitmap_git,
 	return idx >= 0 && bitmap_get(bitmap, idx);
 }
 
+struct bitmap *bitmap_reachable_commits(struct repository *r,
+					struct bitmap_index *bitmap_git,
+					struct commit_list *tips)
+{
+	struct rev_info revs;
+	struct object_list *roots = NULL;
+	struct bitmap *result;
+	struct commit_list *p;
+
+	repo_init_revisions(r, &revs, NULL);
+	revs.tag_objects = 0;
+	revs.tree_objects = 0;
+	revs.blob_objects = 0;
+
+	for (p = tips; p; p = p->next)
+		object_list_insert(&p->item->object, &roots);
+
+	result = find_objects(bitmap_git, &revs, roots, NULL);
+	if (!result)
+		result = bitmap_new();
+
+	for (p = tips; p; p = p->next)
+		clear_commit_marks(p->item, ALL_REV_FLAGS);
+
+	object_list_free(&roots);
+	release_revisions(&revs);
+	return result;
+}
+
+int bitmap_has_commits(struct bitmap_index *bitmap_git,
+		       struct commit_list *commits)
+{
+	for (; commits; commits = commits->next) {
+		int pos = bitmap_position(bitmap_git, &commits->item->object.oid);
+
+		if (pos < 0 || (uint32_t)pos >= bitmap_num_objects(bitmap_git))
+			return 0;
+	}
+	return 1;
+}
+
+struct contains_many_entry {
+	uint32_t pos;
+	size_t index;
+};
+
+static int contains_many_entry_cmp(const void *va, const void *vb)
+{
+	const struct contains_many_entry *a = va, *b = vb;
+
+	if (a->pos < b->pos)
+		return -1;
+	return a->pos > b->pos;
+}
+
+int bitmap_commit_contains_many(struct bitmap_index *bitmap_git,
+				struct commit *commit, size_t nr,
+				const struct object_id **oids,
+				unsigned char *reachable)
+{
+	struct ewah_bitmap *ewah;
+	struct contains_many_entry *entries;
+	struct ewah_iterator it;
+	size_t i, entries_nr = 0, block = 0;
+	eword_t word;
+	int count = 0;
+
+	ewah = bitmap_for_commit(bitmap_git, commit);
+	if (!ewah)
+		return -1;
+
+	memset(reachable, 0, nr);
+	ALLOC_ARRAY(entries, nr);
+	for (i = 0; i < nr; i++) {
+		int pos = bitmap_position(bitmap_git, oids[i]);
+
+		/* everything reachable from a bitmapped commit is in the pack */
+		if (pos < 0 || (uint32_t)pos >= bitmap_num_objects(bitmap_git))
+			continue;
+		entries[entries_nr].pos = pos;
+		entries[entries_nr].index = i;
+		entries_nr++;
+	}
+	QSORT(entries, entries_nr, contains_many_entry_cmp);
+
+	i = 0;
+	ewah_iterator_init(&it, ewah);
+	while (i < entries_nr && ewah_iterator_next(&word, &it)) {
+		for (; i < entries_nr &&
+		       entries[i].pos / BITS_IN_EWORD == block; i++) {
+			if (word & ((eword_t)1 << (entries[i].pos % BITS_IN_EWORD))) {
+				reachable[entries[i].index] = 1;
+				count++;
+			}
+		}
+		block++;
+	}
+
+	free(entries);
+	return count;
+}
+
 void traverse_bitmap_commit_list(struct bitmap_index *bitmap_git,
 				 struct rev_info *revs,
 				 show_reachable_fn show_reachable)
@@ -1866,6 +2345,8 @@ uint32_t *create_bitmap_mapping(struct bitmap_index *bitmap_git,
 
 void free_bitmap_index(struct bitmap_index *b)
 {
+	uint32_t i;
+
 	if (!b)
 		return;
 
@@ -1875,6 +2356,12 @@ void free_bitmap_index(struct bitmap_index *b)
 	ewah_pool_free(b->trees);
 	ewah_pool_free(b->blobs);
 	ewah_pool_free(b->tags);
+	ewah_pool_free(b->merges);
+	for (i = 0; i < b->date_buckets_nr; i++)
+		ewah_pool_free(b->date_buckets[i]);
+	free(b->date_buckets);
+	free(b->date_bucket_min);
+	free(b->date_bucket_max);
 	if (b->bitmaps) {
 		struct stored_bitmap *sb;
 		kh_foreach_value(b->bitmaps, sb, {
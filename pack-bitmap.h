@@ -26,6 +26,7 @@ struct bitmap_disk_header {
 enum pack_bitmap_opts {
 	BITMAP_OPT_FULL_DAG = 1,
 	BITMAP_OPT_HASH_CACHE = 4,
+	BITMAP_OPT_COMMIT_ATTRIBUTES = 8,
 };
 
 enum pack_bitmap_flags {
@@ -54,6 +55,16 @@ int test_bitmap_commits(struct repository *r);
 int test_bitmap_hashes(struct repository *r);
 struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
 					 int filter_provided_objects);
+
+/*
+ * Like prepare_bitmap_walk(), for walks that only list commits (no
+ * "--objects"), but may limit them with --first-parent, --merges,
+ * --no-merges and other parent counts, --until or --since-as-filter.
+ * The commit attributes of the bitmap are used where it has them, and
+ * only the commits they cannot decide on are looked at one by one.
+ * Returns NULL if the bitmaps cannot give the commits of this walk.
+ */
+struct bitmap_index *prepare_bitmap_commit_walk(struct rev_info *revs);
 uint32_t midx_preferred_pack(struct bitmap_index *bitmap_git);
 int reuse_partial_packfile_from_bitmap(struct bitmap_index *,
 				       struct packed_git **packfile,
@@ -65,6 +76,37 @@ void free_bitmap_index(struct bitmap_index *);
 int bitmap_walk_contains(struct bitmap_index *,
 			 struct bitmap *bitmap, const struct object_id *oid);
 
+/*
+ * Return a bitmap of the commits reachable from "tips", combining the
+ * stored bitmaps of the nearest bitmapped commits with a walk over the
+ * commits that have none. Commits outside the bitmapped pack are given
+ * positions in the extended index, so the result can be queried with
+ * bitmap_walk_contains() for any commit. The caller frees the result
+ * with bitmap_free().
+ */
+struct bitmap *bitmap_reachable_commits(struct repository *r,
+					struct bitmap_index *bitmap_git,
+					struct commit_list *tips);
+
+/*
+ * Return 1 if every commit in "commits" is part of the bitmapped pack.
+ */
+int bitmap_has_commits(struct bitmap_index *bitmap_git,
+		       struct commit_list *commits);
+
+/*
+ * Answer whether each of the "nr" objects "oids" is reachable from
+ * "commit" using the bitmap stored for "commit", reading it only once:
+ * set "reachable[i]" to 1 if "oids[i]" is reachable from "commit", and
+ * to 0 otherwise. Objects outside of the bitmapped pack are never
+ * reachable from a bitmapped commit. Returns the number of reachable
+ * objects, or -1 if there is no stored bitmap for "commit".
+ */
+int bitmap_commit_contains_many(struct bitmap_index *bitmap_git,
+				struct commit *commit, size_t nr,
+				const struct object_id **oids,
+				unsigned char *reachable);
+
 /*
  * After a traversal has been performed by prepare_bitmap_walk(), this can be
  * queried to see if a particular object was reachable from any of the
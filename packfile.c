@@ -16,6 +16,8 @@
 #include "object-store.h"
 #include "midx.h"
 #include "commit-graph.h"
+#include "diffstat-index.h"
+#include "grep-index.h"
 #include "promisor-remote.h"
 
 char *odb_pack_name(struct strbuf *buf,
@@ -369,6 +371,8 @@ void close_object_store(struct raw_object_store *o)
 	}
 
 	close_commit_graph(o);
+	close_diffstat_index(o);
+	close_grep_index(o);
 }
 
 void unlink_pack_path(const char *pack_name, int force_delete)
@@ -1,6 +1,7 @@
 #include "cache.h"
 #include "config.h"
 #include "entry.h"
+#include "object-store.h"
 #include "parallel-checkout.h"
 #include "pkt-line.h"
 #include "progress.h"
@@ -58,6 +59,19 @@ void get_parallel_checkout_configs(int *num_workers, int *threshold)
 		*threshold = DEFAULT_THRESHOLD_FOR_PARALLELISM;
 }
 
+static int use_worker_threads(void)
+{
+	const char *type;
+
+	if (git_config_get_string_tmp("checkout.workertype", &type) ||
+	    !strcmp(type, "process"))
+		return 0;
+	if (strcmp(type, "thread"))
+		die(_("invalid value for '%s': '%s'"),
+		    "checkout.workerType", type);
+	return HAVE_THREADS;
+}
+
 void init_parallel_checkout(void)
 {
 	if (parallel_checkout.status != PC_UNINITIALIZED)
@@ -268,8 +282,30 @@ static int write_pc_item_to_fd(struct parallel_checkout_item *pc_item, int fd,
 	assert(is_eligible_for_parallel_checkout(pc_item->ce, &pc_item->ca));
 
 	filter = get_stream_filter_ca(&pc_item->ca, &pc_item->ce->oid);
+	if (filter && obj_read_use_lock) {
+		unsigned long size;
+
+		/*
+		 * The streaming interface does not take obj_read_lock, so
+		 * worker threads must hold it for the whole stream, which
+		 * serializes them. Only do that for blobs that are too big
+		 * to be read into memory, and convert the rest in-core.
+		 */
+		if (oid_object_info(the_repository, &pc_item->ce->oid,
+				    &size) != OBJ_BLOB ||
+		    size <= big_file_threshold) {
+			free_stream_filter(filter);
+			filter = NULL;
+		}
+	}
 	if (filter) {
-		if (stream_blob_to_fd(fd, &pc_item->ce->oid, filter, 1)) {
+		int err;
+
+		obj_read_lock();
+		err = stream_blob_to_fd(fd, &pc_item->ce->oid, filter, 1);
+		obj_read_unlock();
+
+		if (err) {
 			/* On error, reset fd to try writing without streaming */
 			if (reset_fd(fd, path))
 				return -1;
@@ -319,11 +355,11 @@ static int close_and_clear(int *fd)
 	return ret;
 }
 
-void write_pc_item(struct parallel_checkout_item *pc_item,
-		   struct checkout *state)
+static void write_pc_item_1(struct parallel_checkout_item *pc_item,
+			    struct checkout *state, struct cache_def *cache)
 {
 	unsigned int mode = (pc_item->ce->ce_mode & 0100) ? 0777 : 0666;
-	int fd = -1, fstat_done = 0;
+	int fd = -1, fstat_done = 0, dirs_only = 1;
 	struct strbuf path = STRBUF_INIT;
 	const char *dir_sep;
 
@@ -338,8 +374,18 @@ void write_pc_item(struct parallel_checkout_item *pc_item,
 	 * a symlink (checked out after we enqueued this entry for parallel
 	 * checkout). Thus, we must check the leading dirs again.
 	 */
-	if (dir_sep && !has_dirs_only_path(path.buf, dir_sep - path.buf,
-					   state->base_dir_len)) {
+	if (dir_sep) {
+		int len = dir_sep - path.buf;
+
+		/* Worker threads keep their own lstat cache. */
+		if (cache)
+			dirs_only = threaded_has_dirs_only_path(cache, path.buf, len,
+								state->base_dir_len);
+		else
+			dirs_only = has_dirs_only_path(path.buf, len,
+						       state->base_dir_len);
+	}
+	if (!dirs_only) {
 		pc_item->status = PC_ITEM_COLLIDED;
 		trace2_data_string("pcheckout", NULL, "collision/dirname", path.buf);
 		goto out;
@@ -394,6 +440,12 @@ void write_pc_item(struct parallel_checkout_item *pc_item,
 	strbuf_release(&path);
 }
 
+void write_pc_item(struct parallel_checkout_item *pc_item,
+		   struct checkout *state)
+{
+	write_pc_item_1(pc_item, state, NULL);
+}
+
 static void send_one_item(int fd, struct parallel_checkout_item *pc_item)
 {
 	size_t len_data;
@@ -629,6 +681,75 @@ static void gather_results_from_workers(struct pc_worker *workers,
 	free(pfds);
 }
 
+struct pc_thread_pool {
+	pthread_mutex_t mutex;
+	struct checkout *state;
+	size_t next_item;
+};
+
+static struct parallel_checkout_item *next_item_for_thread(struct pc_thread_pool *pool,
+							   struct parallel_checkout_item *done)
+{
+	struct parallel_checkout_item *pc_item = NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (done && done->status != PC_ITEM_COLLIDED)
+		advance_progress_meter();
+	if (pool->next_item < parallel_checkout.nr)
+		pc_item = &parallel_checkout.items[pool->next_item++];
+	pthread_mutex_unlock(&pool->mutex);
+
+	return pc_item;
+}
+
+static void *pc_thread_proc(void *data)
+{
+	struct pc_thread_pool *pool = data;
+	struct cache_def cache = CACHE_DEF_INIT;
+	struct parallel_checkout_item *pc_item = NULL;
+
+	trace2_thread_start("pcheckout");
+
+	while ((pc_item = next_item_for_thread(pool, pc_item)))
+		write_pc_item_1(pc_item, pool->state, &cache);
+
+	cache_def_clear(&cache);
+	trace2_thread_exit();
+	return NULL;
+}
+
+/*
+ * Write the queued items using threads of the current process instead of
+ * checkout--worker processes. This saves the cost of spawning the workers
+ * and sending the items and results through pipes, and lets the threads
+ * share our object store (guarded by obj_read_lock) and write the results
+ * directly into the items.
+ */
+static void write_items_in_threads(struct checkout *state, int num_threads)
+{
+	struct pc_thread_pool pool = { .state = state };
+	pthread_t *threads;
+	int i, err;
+
+	ALLOC_ARRAY(threads, num_threads);
+	pthread_mutex_init(&pool.mutex, NULL);
+	enable_obj_read_lock();
+
+	for (i = 0; i < num_threads; i++) {
+		err = pthread_create(&threads[i], NULL, pc_thread_proc, &pool);
+		if (err)
+			die(_("unable to create checkout thread: %s"),
+			    strerror(err));
+	}
+	for (i = 0; i < num_threads; i++)
+		if (pthread_join(threads[i], NULL))
+			die("unable to join checkout thread");
+
+	disable_obj_read_lock();
+	pthread_mutex_destroy(&pool.mutex);
+	free(threads);
+}
+
 static void write_items_sequentially(struct checkout *state)
 {
 	size_t i;
@@ -658,6 +779,8 @@ int run_parallel_checkout(struct checkout *state, int num_workers, int threshold
 
 	if (num_workers <= 1 || parallel_checkout.nr < threshold) {
 		write_items_sequentially(state);
+	} else if (use_worker_threads()) {
+		write_items_in_threads(state, num_workers);
 	} else {
 		struct pc_worker *workers = setup_workers(state, num_workers);
 		gather_results_from_workers(workers, num_workers);
@@ -171,4 +171,20 @@ int match_pathspec_attrs(struct index_state *istate,
 			 const char *name, int namelen,
 			 const struct pathspec_item *item);
 
+/*
+ * Returns 1 if the pathspec may match entries that are hidden inside of a
+ * sparse directory of a sparse index, so that the index must be expanded to
+ * find all of them. Returns 0 if the in-cone entries and the sparse
+ * directory entries themselves are enough to match it.
+ */
+int pathspec_needs_expanded_index(struct index_state *istate,
+				  const struct pathspec *pathspec);
+
+/*
+ * Returns 1 if the pathspec matches any sparse directory entry of the
+ * sparse index, e.g. because it names a whole out-of-cone directory.
+ */
+int pathspec_matches_sparse_dir(struct index_state *istate,
+				const struct pathspec *pathspec);
+
 #endif /* PATHSPEC_H */
@@ -30,6 +30,7 @@ struct thread_data {
 	struct index_state *index;
 	struct pathspec pathspec;
 	struct progress_data *progress;
+	unsigned int match_flags;
 	int offset, nr;
 	int t2_nr_lstat;
 };
@@ -77,7 +78,7 @@ static void *preload_thread(void *_data)
 		p->t2_nr_lstat++;
 		if (lstat(ce->name, &st))
 			continue;
-		if (ie_match_stat(index, ce, &st, CE_MATCH_RACY_IS_DIRTY|CE_MATCH_IGNORE_FSMONITOR))
+		if (ie_match_stat(index, ce, &st, p->match_flags))
 			continue;
 		ce_mark_uptodate(ce);
 		mark_fsmonitor_valid(index, ce);
@@ -100,11 +101,19 @@ void preload_index(struct index_state *index,
 	int threads, i, work, offset;
 	struct thread_data data[MAX_PARALLEL];
 	struct progress_data pd;
+	unsigned int match_flags = CE_MATCH_RACY_IS_DIRTY | CE_MATCH_IGNORE_FSMONITOR;
 	int t2_sum_lstat = 0;
 
 	if (!HAVE_THREADS || !core_preload_index)
 		return;
 
+	/*
+	 * The threads would skip every entry anyway, don't bother
+	 * starting them.
+	 */
+	if (is_fsmonitor_all_valid(index))
+		return;
+
 	threads = index->cache_nr / THREAD_COST;
 	if ((index->cache_nr > 1) && (threads < 2) && git_env_bool("GIT_TEST_PRELOAD_INDEX", 0))
 		threads = 2;
@@ -116,6 +125,8 @@ void preload_index(struct index_state *index,
 	trace_performance_enter();
 	if (threads > MAX_PARALLEL)
 		threads = MAX_PARALLEL;
+	if (refresh_flags & REFRESH_REALLY)
+		match_flags |= CE_MATCH_IGNORE_VALID;
 	offset = 0;
 	work = DIV_ROUND_UP(index->cache_nr, threads);
 	memset(&data, 0, sizeof(data));
@@ -131,6 +142,7 @@ void preload_index(struct index_state *index,
 		int err;
 
 		p->index = index;
+		p->match_flags = match_flags;
 		if (pathspec)
 			copy_pathspec(&p->pathspec, pathspec);
 		p->offset = offset;
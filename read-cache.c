@@ -754,7 +754,9 @@ void set_object_name_for_intent_to_add_entry(struct cache_entry *ce)
 	oidcpy(&ce->oid, &oid);
 }
 
-int add_to_index(struct index_state *istate, const char *path, struct stat *st, int flags)
+static int add_to_index_1(struct index_state *istate, const char *path,
+			  struct stat *st, const struct object_id *hashed,
+			  int flags)
 {
 	int namelen, was_same;
 	mode_t st_mode = st->st_mode;
@@ -827,7 +829,9 @@ int add_to_index(struct index_state *istate, const char *path, struct stat *st,
 		}
 	}
 	if (!intent_only) {
-		if (index_path(istate, &ce->oid, path, st, hash_flags)) {
+		if (hashed)
+			oidcpy(&ce->oid, hashed);
+		else if (index_path(istate, &ce->oid, path, st, hash_flags)) {
 			discard_cache_entry(ce);
 			return error(_("unable to index file '%s'"), path);
 		}
@@ -855,6 +859,20 @@ int add_to_index(struct index_state *istate, const char *path, struct stat *st,
 	return 0;
 }
 
+int add_to_index(struct index_state *istate, const char *path, struct stat *st, int flags)
+{
+	return add_to_index_1(istate, path, st, NULL, flags);
+}
+
+int add_to_index_hashed(struct index_state *istate, const char *path,
+			struct stat *st, const struct object_id *oid, int flags)
+{
+	if (!S_ISREG(st->st_mode))
+		BUG("add_to_index_hashed() called for '%s', which is not a regular file",
+		    path);
+	return add_to_index_1(istate, path, st, oid, flags);
+}
+
 int add_file_to_index(struct index_state *istate, const char *path, int flags)
 {
 	struct stat st;
@@ -1633,6 +1651,17 @@ int refresh_index(struct index_state *istate, unsigned int flags,
 	preload_index(istate, pathspec, 0);
 	trace2_region_enter("index", "refresh", NULL);
 
+	/*
+	 * If fsmonitor vouches for every entry, there is nothing to
+	 * refresh and nothing to report. We still have to walk the
+	 * index when the caller wants to know which pathspec items
+	 * matched.
+	 */
+	if (!seen && is_fsmonitor_all_valid(istate)) {
+		trace2_data_intmax("index", NULL, "refresh/fsmonitor_all_valid", 1);
+		goto done;
+	}
+
 	for (i = 0; i < istate->cache_nr; i++) {
 		struct cache_entry *ce, *new_entry;
 		int cache_errno = 0;
@@ -1713,6 +1742,7 @@ int refresh_index(struct index_state *istate, unsigned int flags,
 
 		replace_index_entry(istate, i, new_entry);
 	}
+done:
 	trace2_data_intmax("index", NULL, "refresh/sum_lstat", t2_sum_lstat);
 	trace2_data_intmax("index", NULL, "refresh/sum_scan", t2_sum_scan);
 	trace2_region_leave("index", "refresh", NULL);
@@ -2521,6 +2551,7 @@ int discard_index(struct index_state *istate)
 	cache_tree_free(&(istate->cache_tree));
 	istate->initialized = 0;
 	istate->fsmonitor_has_run_once = 0;
+	istate->fsmonitor_all_valid = 0;
 	FREE_AND_NULL(istate->fsmonitor_last_update);
 	FREE_AND_NULL(istate->cache);
 	istate->cache_alloc = 0;
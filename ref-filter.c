@@ -23,6 +23,7 @@
 #include "worktree.h"
 #include "hashmap.h"
 #include "strvec.h"
+#include "pack-bitmap.h"
 
 static struct ref_msg {
 	const char *gone;
@@ -158,6 +159,7 @@ enum atom_type {
 	ATOM_THEN,
 	ATOM_ELSE,
 	ATOM_REST,
+	ATOM_AHEADBEHIND,
 };
 
 /*
@@ -210,10 +212,17 @@ static struct used_atom {
 		} email_option;
 		struct refname_atom refname;
 		char *head;
+		size_t ahead_behind_base;
 	} u;
 } *used_atom;
 static int used_atom_cnt, need_tagged, need_symref;
 
+/*
+ * The commits named by %(ahead-behind:<base>) atoms; each item's util
+ * is the base commit.
+ */
+static struct string_list ahead_behind_bases = STRING_LIST_INIT_DUP;
+
 /*
  * Expand string, append it to strbuf *sb, then return error code ret.
  * Allow to save few lines of code.
@@ -570,6 +579,25 @@ static int rest_atom_parser(struct ref_format *format, struct used_atom *atom,
 	return 0;
 }
 
+static int ahead_behind_atom_parser(struct ref_format *format, struct used_atom *atom,
+				    const char *arg, struct strbuf *err)
+{
+	struct string_list_item *item;
+	struct commit *base;
+
+	if (!arg)
+		return strbuf_addf_ret(err, -1, _("expected format: %%(ahead-behind:<committish>)"));
+
+	base = lookup_commit_reference_by_name(arg);
+	if (!base)
+		return strbuf_addf_ret(err, -1, _("failed to find '%s'"), arg);
+
+	atom->u.ahead_behind_base = ahead_behind_bases.nr;
+	item = string_list_append(&ahead_behind_bases, arg);
+	item->util = base;
+	return 0;
+}
+
 static int head_atom_parser(struct ref_format *format, struct used_atom *atom,
 			    const char *arg, struct strbuf *unused_err)
 {
@@ -627,6 +655,7 @@ static struct {
 	[ATOM_THEN] = { "then", SOURCE_NONE },
 	[ATOM_ELSE] = { "else", SOURCE_NONE },
 	[ATOM_REST] = { "rest", SOURCE_NONE, FIELD_STR, rest_atom_parser },
+	[ATOM_AHEADBEHIND] = { "ahead-behind", SOURCE_NONE, FIELD_STR, ahead_behind_atom_parser },
 	/*
 	 * Please update $__git_ref_fieldlist in git-completion.bash
 	 * when you add new atoms
@@ -1957,6 +1986,16 @@ static int populate_value(struct ref_array_item *ref, struct strbuf *err)
 			else
 				v->s = xstrdup("");
 			continue;
+		} else if (atom_type == ATOM_AHEADBEHIND) {
+			if (ref->counts) {
+				const struct ahead_behind_count *count;
+				count = ref->counts[atom->u.ahead_behind_base];
+				v->s = xstrfmt("%u %u", count->ahead, count->behind);
+			} else {
+				/* Not a commit, or the counts were not computed. */
+				v->s = xstrdup("");
+			}
+			continue;
 		} else
 			continue;
 
@@ -2228,8 +2267,56 @@ struct ref_filter_cbdata {
 	struct ref_filter *filter;
 	struct contains_cache contains_cache;
 	struct contains_cache no_contains_cache;
+	struct bitmap_index *bitmap_git;
+	unsigned int contains_bitmap : 1;
 };
 
+/*
+ * Open the reachability bitmaps, if there are any and a filter can make
+ * use of them. The --merged and --no-merged filters can always use them.
+ * For --contains and --no-contains, every commit that is asked about
+ * must be covered by the bitmaps, or they could only give "yes" answers.
+ */
+static void prepare_filter_bitmap(struct ref_filter_cbdata *ref_cbdata)
+{
+	struct ref_filter *filter = ref_cbdata->filter;
+	int want_contains = filter->with_commit || filter->no_commit;
+	int want_merged = filter->reachable_from || filter->unreachable_from;
+
+	ref_cbdata->bitmap_git = NULL;
+	ref_cbdata->contains_bitmap = 0;
+
+	if (!want_contains && !want_merged)
+		return;
+
+	ref_cbdata->bitmap_git = prepare_bitmap_git(the_repository);
+	if (!ref_cbdata->bitmap_git)
+		return;
+
+	if (want_contains &&
+	    bitmap_has_commits(ref_cbdata->bitmap_git, filter->with_commit) &&
+	    bitmap_has_commits(ref_cbdata->bitmap_git, filter->no_commit)) {
+		ref_cbdata->contains_bitmap = 1;
+		trace2_data_intmax("ref-filter", the_repository,
+				   "contains_bitmap", 1);
+	}
+
+	if (!ref_cbdata->contains_bitmap && !want_merged) {
+		free_bitmap_index(ref_cbdata->bitmap_git);
+		ref_cbdata->bitmap_git = NULL;
+	}
+}
+
+static int filter_contains(struct ref_filter_cbdata *ref_cbdata,
+			   struct commit *commit, struct commit_list *list,
+			   struct contains_cache *cache)
+{
+	if (ref_cbdata->contains_bitmap)
+		return commit_contains_bitmap(ref_cbdata->bitmap_git, commit,
+					      list, cache);
+	return commit_contains(ref_cbdata->filter, commit, list, cache);
+}
+
 /*
  * A call-back given to for_each_ref().  Filter refs and keep them for
  * later object processing.
@@ -2275,11 +2362,11 @@ static int ref_filter_handler(const char *refname, const struct object_id *oid,
 			return 0;
 		/* We perform the filtering for the '--contains' option... */
 		if (filter->with_commit &&
-		    !commit_contains(filter, commit, filter->with_commit, &ref_cbdata->contains_cache))
+		    !filter_contains(ref_cbdata, commit, filter->with_commit, &ref_cbdata->contains_cache))
 			return 0;
 		/* ...or for the `--no-contains' option */
 		if (filter->no_commit &&
-		    commit_contains(filter, commit, filter->no_commit, &ref_cbdata->no_contains_cache))
+		    filter_contains(ref_cbdata, commit, filter->no_commit, &ref_cbdata->no_contains_cache))
 			return 0;
 	}
 
@@ -2306,6 +2393,7 @@ static void free_array_item(struct ref_array_item *item)
 			free((char *)item->value[i].s);
 		free(item->value);
 	}
+	free(item->counts);
 	free(item);
 }
 
@@ -2318,6 +2406,8 @@ void ref_array_clear(struct ref_array *array)
 		free_array_item(array->items[i]);
 	FREE_AND_NULL(array->items);
 	array->nr = array->alloc = 0;
+	FREE_AND_NULL(array->counts);
+	array->counts_nr = 0;
 
 	for (i = 0; i < used_atom_cnt; i++) {
 		struct used_atom *atom = &used_atom[i];
@@ -2327,6 +2417,7 @@ void ref_array_clear(struct ref_array *array)
 	}
 	FREE_AND_NULL(used_atom);
 	used_atom_cnt = 0;
+	string_list_clear(&ahead_behind_bases, 0);
 
 	if (ref_to_worktree_map.worktrees) {
 		hashmap_clear_and_free(&(ref_to_worktree_map.map),
@@ -2338,7 +2429,43 @@ void ref_array_clear(struct ref_array *array)
 
 #define EXCLUDE_REACHED 0
 #define INCLUDE_REACHED 1
-static void reach_filter(struct ref_array *array,
+/*
+ * Like reach_filter(), but answer from the reachability bitmaps: a single
+ * bitmap of everything reachable from "check_reachable" is built from
+ * the nearest bitmapped commits, and each ref is then a bit test.
+ */
+static void reach_filter_bitmap(struct bitmap_index *bitmap_git,
+				struct ref_array *array,
+				struct commit_list *check_reachable,
+				int include_reached)
+{
+	struct bitmap *reachable;
+	int i, old_nr;
+
+	trace2_region_enter("ref-filter", "reach_filter_bitmap", the_repository);
+	reachable = bitmap_reachable_commits(the_repository, bitmap_git,
+					     check_reachable);
+
+	old_nr = array->nr;
+	array->nr = 0;
+
+	for (i = 0; i < old_nr; i++) {
+		struct ref_array_item *item = array->items[i];
+		int is_merged = bitmap_walk_contains(bitmap_git, reachable,
+						     &item->commit->object.oid);
+
+		if (is_merged == include_reached)
+			array->items[array->nr++] = array->items[i];
+		else
+			free_array_item(item);
+	}
+
+	bitmap_free(reachable);
+	trace2_region_leave("ref-filter", "reach_filter_bitmap", the_repository);
+}
+
+static void reach_filter(struct bitmap_index *bitmap_git,
+			 struct ref_array *array,
 			 struct commit_list *check_reachable,
 			 int include_reached)
 {
@@ -2350,6 +2477,12 @@ static void reach_filter(struct ref_array *array,
 	if (!check_reachable)
 		return;
 
+	if (bitmap_git) {
+		reach_filter_bitmap(bitmap_git, array, check_reachable,
+				    include_reached);
+		return;
+	}
+
 	CALLOC_ARRAY(to_clear, array->nr);
 
 	repo_init_revisions(the_repository, &revs, NULL);
@@ -2414,6 +2547,7 @@ int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int
 
 	init_contains_cache(&ref_cbdata.contains_cache);
 	init_contains_cache(&ref_cbdata.no_contains_cache);
+	prepare_filter_bitmap(&ref_cbdata);
 
 	/*  Simple per-ref filtering */
 	if (!filter->kind)
@@ -2441,8 +2575,12 @@ int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int
 	clear_contains_cache(&ref_cbdata.no_contains_cache);
 
 	/*  Filters that need revision walking */
-	reach_filter(array, filter->reachable_from, INCLUDE_REACHED);
-	reach_filter(array, filter->unreachable_from, EXCLUDE_REACHED);
+	reach_filter(ref_cbdata.bitmap_git, array,
+		     filter->reachable_from, INCLUDE_REACHED);
+	reach_filter(ref_cbdata.bitmap_git, array,
+		     filter->unreachable_from, EXCLUDE_REACHED);
+
+	free_bitmap_index(ref_cbdata.bitmap_git);
 
 	return ret;
 }
@@ -2562,6 +2700,48 @@ void ref_sorting_set_sort_flags_all(struct ref_sorting *sorting,
 	}
 }
 
+void filter_ahead_behind(struct repository *r, struct ref_array *array)
+{
+	struct commit **commits;
+	size_t bases_nr = ahead_behind_bases.nr;
+	size_t commits_nr;
+	size_t i, j;
+
+	if (!bases_nr || !array->nr)
+		return;
+
+	ALLOC_ARRAY(commits, st_add(bases_nr, array->nr));
+	for (i = 0; i < bases_nr; i++)
+		commits[i] = ahead_behind_bases.items[i].util;
+
+	ALLOC_ARRAY(array->counts, st_mult(bases_nr, array->nr));
+	array->counts_nr = 0;
+	commits_nr = bases_nr;
+
+	for (i = 0; i < array->nr; i++) {
+		struct ref_array_item *item = array->items[i];
+		struct commit *c = lookup_commit_reference_gently(r, &item->objectname, 1);
+
+		if (!c)
+			continue;
+
+		commits[commits_nr] = c;
+		CALLOC_ARRAY(item->counts, bases_nr);
+		for (j = 0; j < bases_nr; j++) {
+			struct ahead_behind_count *count;
+
+			count = &array->counts[array->counts_nr++];
+			count->tip_index = commits_nr;
+			count->base_index = j;
+			item->counts[j] = count;
+		}
+		commits_nr++;
+	}
+
+	ahead_behind(r, commits, commits_nr, array->counts, array->counts_nr);
+	free(commits);
+}
+
 void ref_array_sort(struct ref_sorting *sorting, struct ref_array *array)
 {
 	QSORT_S(array->items, array->nr, compare_refs, sorting);
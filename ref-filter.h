@@ -40,6 +40,7 @@ struct ref_array_item {
 	const char *symref;
 	struct commit *commit;
 	struct atom_value *value;
+	struct ahead_behind_count **counts;
 	char refname[FLEX_ARRAY];
 };
 
@@ -47,6 +48,9 @@ struct ref_array {
 	int nr, alloc;
 	struct ref_array_item **items;
 	struct rev_info *revs;
+
+	struct ahead_behind_count *counts;
+	size_t counts_nr;
 };
 
 struct ref_filter {
@@ -108,6 +112,12 @@ int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int
 void ref_array_clear(struct ref_array *array);
 /*  Used to verify if the given format is correct and to parse out the used atoms */
 int verify_ref_format(struct ref_format *format);
+/*
+ * Compute the counts for any %(ahead-behind:<base>) atoms in the format
+ * verified last, for all refs in the array, in a single commit walk.
+ * Call this after filter_refs() and before sorting or formatting.
+ */
+void filter_ahead_behind(struct repository *r, struct ref_array *array);
 /*  Sort the given ref_array as per the ref_sorting provided */
 void ref_array_sort(struct ref_sorting *sort, struct ref_array *array);
 /*  Set REF_SORTING_* sort_flags for all elements of a sorting list */
@@ -24,6 +24,7 @@ enum fetch_negotiation_setting {
 	FETCH_NEGOTIATION_CONSECUTIVE,
 	FETCH_NEGOTIATION_SKIPPING,
 	FETCH_NEGOTIATION_NOOP,
+	FETCH_NEGOTIATION_BITMAP,
 };
 
 struct repo_settings {
@@ -31,6 +32,8 @@ struct repo_settings {
 
 	int core_commit_graph;
 	int commit_graph_read_changed_paths;
+	int commit_graph_read_reachability_index;
+	int commit_graph_use_topo_order;
 	int gc_write_commit_graph;
 	int fetch_write_commit_graph;
 	int command_requires_full_index;
@@ -660,27 +660,49 @@ static void trace2_bloom_filter_statistics_atexit(void)
 	jw_release(&jw);
 }
 
+/*
+ * Find the part of a pathspec item that every matching path must have
+ * as a leading path, and that is thus in the Bloom filter of every
+ * commit that changes a matching path: the item itself if it is literal,
+ * or the leading directories before its first wildcard. Returns 0 if
+ * there is no such part.
+ */
+static size_t bloom_filter_prefix_len(const struct pathspec_item *pi)
+{
+	size_t len = pi->len;
+
+	if (pi->magic & ~(PATHSPEC_LITERAL | PATHSPEC_GLOB))
+		return 0;
+
+	if (pi->nowildcard_len < pi->len) {
+		len = pi->nowildcard_len;
+		while (len && pi->match[len - 1] != '/')
+			len--;
+	}
+
+	/* remove single trailing slash from path, if needed */
+	if (len && pi->match[len - 1] == '/')
+		len--;
+	return len;
+}
+
 static int forbid_bloom_filters(struct pathspec *spec)
 {
-	if (spec->has_wildcard)
-		return 1;
-	if (spec->nr > 1)
-		return 1;
-	if (spec->magic & ~PATHSPEC_LITERAL)
-		return 1;
-	if (spec->nr && (spec->items[0].magic & ~PATHSPEC_LITERAL))
+	int i;
+
+	if (spec->magic & ~(PATHSPEC_LITERAL | PATHSPEC_GLOB))
 		return 1;
 
+	for (i = 0; i < spec->nr; i++)
+		if (!bloom_filter_prefix_len(&spec->items[i]))
+			return 1;
+
 	return 0;
 }
 
 static void prepare_to_use_bloom_filter(struct rev_info *revs)
 {
-	struct pathspec_item *pi;
-	char *path_alloc = NULL;
-	const char *path, *p;
-	size_t len;
-	int path_component_nr = 1;
+	int i;
 
 	if (!revs->commits)
 		return;
@@ -697,81 +719,73 @@ static void prepare_to_use_bloom_filter(struct rev_info *revs)
 	if (!revs->pruning.pathspec.nr)
 		return;
 
-	pi = &revs->pruning.pathspec.items[0];
-
-	/* remove single trailing slash from path, if needed */
-	if (pi->len > 0 && pi->match[pi->len - 1] == '/') {
-		path_alloc = xmemdupz(pi->match, pi->len - 1);
-		path = path_alloc;
-	} else
-		path = pi->match;
-
-	len = strlen(path);
-	if (!len) {
+	if (forbid_bloom_filters(&revs->pruning.pathspec)) {
 		revs->bloom_filter_settings = NULL;
-		free(path_alloc);
 		return;
 	}
 
-	p = path;
-	while (*p) {
-		/*
-		 * At this point, the path is normalized to use Unix-style
-		 * path separators. This is required due to how the
-		 * changed-path Bloom filters store the paths.
-		 */
-		if (*p == '/')
-			path_component_nr++;
-		p++;
-	}
-
-	revs->bloom_keys_nr = path_component_nr;
-	ALLOC_ARRAY(revs->bloom_keys, revs->bloom_keys_nr);
-
-	fill_bloom_key(path, len, &revs->bloom_keys[0],
-		       revs->bloom_filter_settings);
-	path_component_nr = 1;
+	revs->bloom_keyvecs_nr = revs->pruning.pathspec.nr;
+	CALLOC_ARRAY(revs->bloom_keyvecs, revs->bloom_keyvecs_nr);
+	for (i = 0; i < revs->pruning.pathspec.nr; i++) {
+		struct pathspec_item *pi = &revs->pruning.pathspec.items[i];
 
-	p = path + len - 1;
-	while (p > path) {
-		if (*p == '/')
-			fill_bloom_key(path, p - path,
-				       &revs->bloom_keys[path_component_nr++],
-				       revs->bloom_filter_settings);
-		p--;
+		revs->bloom_keyvecs[i] =
+			bloom_keyvec_new(pi->match, bloom_filter_prefix_len(pi),
+					 revs->bloom_filter_settings);
 	}
 
 	if (trace2_is_enabled() && !bloom_filter_atexit_registered) {
 		atexit(trace2_bloom_filter_statistics_atexit);
 		bloom_filter_atexit_registered = 1;
 	}
+}
 
-	free(path_alloc);
+static void release_bloom_keys(struct rev_info *revs)
+{
+	int i;
+
+	for (i = 0; i < revs->bloom_keyvecs_nr; i++)
+		bloom_keyvec_free(revs->bloom_keyvecs[i]);
+	FREE_AND_NULL(revs->bloom_keyvecs);
+	revs->bloom_keyvecs_nr = 0;
+	if (revs->bloom_path_keys) {
+		bloom_keyvec_cache_clear(revs->bloom_path_keys);
+		FREE_AND_NULL(revs->bloom_path_keys);
+	}
 }
 
-static int check_maybe_different_in_bloom_filter(struct rev_info *revs,
-						 struct commit *commit)
+static struct bloom_filter *get_usable_bloom_filter(struct rev_info *revs,
+						    struct commit *commit)
 {
 	struct bloom_filter *filter;
-	int result = 1, j;
 
 	if (!revs->repo->objects->commit_graph)
-		return -1;
+		return NULL;
 
 	if (commit_graph_generation(commit) == GENERATION_NUMBER_INFINITY)
-		return -1;
+		return NULL;
 
 	filter = get_bloom_filter(revs->repo, commit);
 
-	if (!filter) {
+	if (!filter)
 		count_bloom_filter_not_present++;
+	return filter;
+}
+
+static int check_maybe_different_in_bloom_filter(struct rev_info *revs,
+						 struct commit *commit)
+{
+	struct bloom_filter *filter;
+	int result = 0, j;
+
+	filter = get_usable_bloom_filter(revs, commit);
+	if (!filter)
 		return -1;
-	}
 
-	for (j = 0; result && j < revs->bloom_keys_nr; j++) {
-		result = bloom_filter_contains(filter,
-					       &revs->bloom_keys[j],
-					       revs->bloom_filter_settings);
+	for (j = 0; !result && j < revs->bloom_keyvecs_nr; j++) {
+		result = bloom_filter_contains_vec(filter,
+						   revs->bloom_keyvecs[j],
+						   revs->bloom_filter_settings);
 	}
 
 	if (result)
@@ -782,6 +796,65 @@ static int check_maybe_different_in_bloom_filter(struct rev_info *revs,
 	return result;
 }
 
+int check_path_in_bloom_filter(struct rev_info *revs,
+			       struct commit *commit, const char *path)
+{
+	struct bloom_filter *filter;
+	int result;
+
+	if (!revs->bloom_filter_settings || !*path || !commit->parents)
+		return -1;
+
+	if (!revs->bloom_path_keys) {
+		CALLOC_ARRAY(revs->bloom_path_keys, 1);
+		bloom_keyvec_cache_init(revs->bloom_path_keys,
+					revs->bloom_filter_settings);
+		if (trace2_is_enabled() && !bloom_filter_atexit_registered) {
+			atexit(trace2_bloom_filter_statistics_atexit);
+			bloom_filter_atexit_registered = 1;
+		}
+	}
+
+	filter = get_usable_bloom_filter(revs, commit);
+	if (!filter)
+		return -1;
+
+	result = bloom_filter_contains_vec(filter,
+					   bloom_keyvec_cache_get(revs->bloom_path_keys, path),
+					   revs->bloom_filter_settings);
+	if (result)
+		count_bloom_filter_maybe++;
+	else
+		count_bloom_filter_definitely_not++;
+	return result;
+}
+
+void diff_tree_follow(struct rev_info *revs,
+		      struct commit *parent, struct commit *commit)
+{
+	struct pathspec *ps = &revs->diffopt.pathspec;
+	int bloom_ret = -1;
+
+	/*
+	 * The filter of a commit is for the diff to its first parent.
+	 * Ask it about whichever path we are following at this point of
+	 * the history; that changes every time a rename is found.
+	 */
+	if (ps->nr == 1 && ps->items[0].nowildcard_len == ps->items[0].len &&
+	    commit->parents && commit->parents->item == parent) {
+		bloom_ret = check_path_in_bloom_filter(revs, commit,
+						       ps->items[0].match);
+		if (!bloom_ret)
+			return;
+	}
+
+	diff_tree_oid(get_commit_tree_oid(parent),
+		      get_commit_tree_oid(commit), "", &revs->diffopt);
+
+	if (bloom_ret > 0 && !diff_queued_diff.nr)
+		count_bloom_filter_false_positive++;
+}
+
 static int rev_compare_tree(struct rev_info *revs,
 			    struct commit *parent, struct commit *commit, int nth_parent)
 {
@@ -812,7 +885,7 @@ static int rev_compare_tree(struct rev_info *revs,
 			return REV_TREE_SAME;
 	}
 
-	if (revs->bloom_keys_nr && !nth_parent) {
+	if (revs->bloom_keyvecs_nr && !nth_parent) {
 		bloom_ret = check_maybe_different_in_bloom_filter(revs, commit);
 
 		if (bloom_ret == 0)
@@ -2967,6 +3040,7 @@ void release_revisions(struct rev_info *revs)
 	diff_free(&revs->pruning);
 	reflog_walk_info_release(revs->reflog_info);
 	release_revisions_topo_walk_info(revs->topo_walk_info);
+	release_bloom_keys(revs);
 }
 
 static void add_child(struct rev_info *revs, struct commit *parent, struct commit *child)
@@ -3355,6 +3429,7 @@ static int mark_uninteresting(const struct object_id *oid,
 
 define_commit_slab(indegree_slab, int);
 define_commit_slab(author_date_slab, timestamp_t);
+define_commit_slab(topo_position_slab, uint32_t);
 
 struct topo_walk_info {
 	timestamp_t min_generation;
@@ -3363,6 +3438,13 @@ struct topo_walk_info {
 	struct prio_queue topo_queue;
 	struct indegree_slab indegree;
 	struct author_date_slab author_date;
+
+	/*
+	 * Set when the commits are listed in the topological order that
+	 * is stored in the commit-graph, see init_graph_topo_walk().
+	 */
+	int graph_order;
+	struct topo_position_slab position;
 };
 
 static int topo_walk_atexit_registered;
@@ -3488,6 +3570,7 @@ static void release_revisions_topo_walk_info(struct topo_walk_info *info)
 	clear_prio_queue(&info->topo_queue);
 	clear_indegree_slab(&info->indegree);
 	clear_author_date_slab(&info->author_date);
+	clear_topo_position_slab(&info->position);
 	free(info);
 }
 
@@ -3497,6 +3580,121 @@ static void reset_topo_walk(struct rev_info *revs)
 	revs->topo_walk_info = NULL;
 }
 
+static int compare_commits_by_topo_position(const void *a_, const void *b_,
+					    void *cb_data)
+{
+	struct topo_position_slab *slab = cb_data;
+	uint32_t a = *topo_position_slab_at(slab, (struct commit *)a_);
+	uint32_t b = *topo_position_slab_at(slab, (struct commit *)b_);
+
+	/* children have larger positions than their parents */
+	if (a > b)
+		return -1;
+	if (a < b)
+		return 1;
+	return 0;
+}
+
+static int insert_by_topo_position(struct rev_info *revs, struct commit *c)
+{
+	struct topo_walk_info *info = revs->topo_walk_info;
+
+	if (c->object.flags & TOPO_WALK_EXPLORED)
+		return 0;
+	if (!commit_graph_topo_position(revs->repo, c,
+					topo_position_slab_at(&info->position, c)))
+		return -1;
+
+	c->object.flags |= TOPO_WALK_EXPLORED;
+	prio_queue_put(&info->topo_queue, c);
+	return 0;
+}
+
+/*
+ * If all starting commits are in a commit-graph that stores a
+ * topological order, list the commits in that order: every commit
+ * is shown once all of its children that we walk have been, which
+ * does not need the indegrees, nor the exploration walk they take.
+ * Uninteresting commits are walked in the same order, so that they
+ * are marked before any of their ancestors is reached.
+ */
+static int init_graph_topo_walk(struct rev_info *revs)
+{
+	struct topo_walk_info *info = revs->topo_walk_info;
+	struct commit_list *list;
+
+	prepare_repo_settings(revs->repo);
+	if (!revs->repo->settings.commit_graph_use_topo_order ||
+	    revs->sort_order == REV_SORT_BY_AUTHOR_DATE ||
+	    !commit_graph_has_topo_order(revs->repo))
+		return 0;
+
+	for (list = revs->commits; list; list = list->next) {
+		uint32_t pos;
+
+		if (repo_parse_commit_gently(revs->repo, list->item, 1) ||
+		    !commit_graph_topo_position(revs->repo, list->item, &pos))
+			return 0;
+	}
+
+	init_topo_position_slab(&info->position);
+	info->topo_queue.compare = compare_commits_by_topo_position;
+	info->topo_queue.cb_data = &info->position;
+	info->graph_order = 1;
+
+	for (list = revs->commits; list; list = list->next)
+		insert_by_topo_position(revs, list->item);
+	return 1;
+}
+
+static int topo_queue_has_interesting(struct prio_queue *queue)
+{
+	int i;
+
+	for (i = 0; i < queue->nr; i++) {
+		struct commit *c = queue->array[i].data;
+		if (!(c->object.flags & UNINTERESTING))
+			return 1;
+	}
+	return 0;
+}
+
+static void expand_graph_topo_walk(struct rev_info *revs, struct commit *commit)
+{
+	struct commit_list *p;
+
+	for (p = commit->parents; p; p = p->next) {
+		if (repo_parse_commit_gently(revs->repo, p->item, 1) < 0)
+			continue;
+		if (insert_by_topo_position(revs, p->item) < 0)
+			BUG("parent %s of a commit-graph commit is not in the commit-graph",
+			    oid_to_hex(&p->item->object.oid));
+
+		if ((commit->object.flags & UNINTERESTING) ?
+		    revs->exclude_first_parent_only : revs->first_parent_only)
+			break;
+	}
+}
+
+static struct commit *next_graph_topo_commit(struct rev_info *revs)
+{
+	struct topo_walk_info *info = revs->topo_walk_info;
+	struct commit *c;
+
+	while ((c = prio_queue_get(&info->topo_queue))) {
+		if (!(c->object.flags & UNINTERESTING))
+			return c;
+
+		count_topo_walked++;
+		process_parents(revs, c, NULL, NULL);
+		expand_graph_topo_walk(revs, c);
+
+		if (!topo_queue_has_interesting(&info->topo_queue))
+			break;
+	}
+	return NULL;
+}
+
 static void init_topo_walk(struct rev_info *revs)
 {
 	struct topo_walk_info *info;
@@ -3508,6 +3706,14 @@ static void init_topo_walk(struct rev_info *revs)
 	info = revs->topo_walk_info;
 	memset(info, 0, sizeof(struct topo_walk_info));
 
+	if (trace2_is_enabled() && !topo_walk_atexit_registered) {
+		atexit(trace2_topo_walk_statistics_atexit);
+		topo_walk_atexit_registered = 1;
+	}
+
+	if (init_graph_topo_walk(revs))
+		return;
+
 	init_indegree_slab(&info->indegree);
 	memset(&info->explore_queue, 0, sizeof(info->explore_queue));
 	memset(&info->indegree_queue, 0, sizeof(info->indegree_queue));
@@ -3565,11 +3771,6 @@ static void init_topo_walk(struct rev_info *revs)
 	 */
 	if (revs->sort_order == REV_SORT_IN_GRAPH_ORDER)
 		prio_queue_reverse(&info->topo_queue);
-
-	if (trace2_is_enabled() && !topo_walk_atexit_registered) {
-		atexit(trace2_topo_walk_statistics_atexit);
-		topo_walk_atexit_registered = 1;
-	}
 }
 
 static struct commit *next_topo_commit(struct rev_info *revs)
@@ -3577,6 +3778,9 @@ static struct commit *next_topo_commit(struct rev_info *revs)
 	struct commit *c;
 	struct topo_walk_info *info = revs->topo_walk_info;
 
+	if (info->graph_order)
+		return next_graph_topo_commit(revs);
+
 	/* pop next off of topo_queue */
 	c = prio_queue_get(&info->topo_queue);
 
@@ -3598,6 +3802,11 @@ static void expand_topo_walk(struct rev_info *revs, struct commit *commit)
 
 	count_topo_walked++;
 
+	if (info->graph_order) {
+		expand_graph_topo_walk(revs, commit);
+		return;
+	}
+
 	for (p = commit->parents; p; p = p->next) {
 		struct commit *parent = p->item;
 		int *pi;
@@ -60,6 +60,7 @@ struct string_list;
 struct saved_parents;
 struct bloom_key;
 struct bloom_filter_settings;
+struct diff_prefetch;
 define_shared_commit_slab(revision_sources, char *);
 
 struct rev_cmdline_info {
@@ -313,9 +314,19 @@ struct rev_info {
 	struct topo_walk_info *topo_walk_info;
 
 	/* Commit graph bloom filter fields */
-	/* The bloom filter key(s) for the pathspec */
-	struct bloom_key *bloom_keys;
-	int bloom_keys_nr;
+	/*
+	 * The bloom filter keys for the pathspec, one vector for each
+	 * pathspec item: a commit may have changed the pathspec if its
+	 * filter contains all keys of any of the vectors.
+	 */
+	struct bloom_keyvec **bloom_keyvecs;
+	int bloom_keyvecs_nr;
+
+	/*
+	 * The keys for single paths that --follow and -L look up as
+	 * they go, see check_path_in_bloom_filter().
+	 */
+	struct bloom_keyvec_cache *bloom_path_keys;
 
 	/*
 	 * The bloom filter settings used to generate the key.
@@ -328,6 +339,9 @@ struct rev_info {
 
 	/* Location where temporary objects for remerge-diff are written. */
 	struct tmp_objdir *remerge_objdir;
+
+	/* Tree diffs computed ahead of log_tree_commit(), if any. */
+	struct diff_prefetch *diff_prefetch;
 };
 
 /**
@@ -490,6 +504,24 @@ int rewrite_parents(struct rev_info *revs,
  */
 struct commit_list *get_saved_parents(struct rev_info *revs, const struct commit *commit);
 
+/*
+ * Ask the changed-path Bloom filter of "commit" whether "path" may be
+ * different between "commit" and its first parent. Returns 0 if it is
+ * definitely the same, 1 if it may differ, and -1 if there is no filter
+ * to ask.
+ */
+int check_path_in_bloom_filter(struct rev_info *revs,
+			       struct commit *commit, const char *path);
+
+/*
+ * Diff "commit" against "parent" into revs->diffopt for --follow. When
+ * "parent" is the first parent, the changed-path Bloom filter of
+ * "commit" is checked for the path being followed first, and the tree
+ * diff is skipped if that path did not change.
+ */
+void diff_tree_follow(struct rev_info *revs,
+		      struct commit *parent, struct commit *commit);
+
 /**
  * Global for the (undocumented) "--early-output" flag for "git log".
  */
@@ -0,0 +1,205 @@
+#include "cache.h"
+#include "chunk-format.h"
+#include "csum-file.h"
+#include "hash-lookup.h"
+#include "lockfile.h"
+#include "object-store.h"
+#include "side-index.h"
+
+#define SIDE_INDEX_HEADER_SIZE 8
+#define SIDE_INDEX_FANOUT_SIZE (4 * 256)
+
+#define SIDE_INDEX_CHUNKID_OIDFANOUT 0x4f494446 /* "OIDF" */
+#define SIDE_INDEX_CHUNKID_OIDLOOKUP 0x4f49444c /* "OIDL" */
+
+static char *get_side_index_filename(struct repository *r,
+				     const struct side_index_format *fmt)
+{
+	return xstrfmt("%s/info/%s", r->objects->odb->path, fmt->name);
+}
+
+static int read_oid_lookup(const unsigned char *chunk_start,
+			   size_t chunk_size, void *data)
+{
+	struct side_index *si = data;
+	si->chunk_oid_lookup = chunk_start;
+	si->num_objects = chunk_size / the_hash_algo->rawsz;
+	return 0;
+}
+
+static int parse_side_index(const struct side_index_format *fmt,
+			    struct side_index *si,
+			    int (*read_chunks)(struct chunkfile *cf, void *data),
+			    void *data)
+{
+	const unsigned char *p = si->data;
+	struct chunkfile *cf;
+	int ret = -1;
+
+	if (get_be32(p) != fmt->signature) {
+		error(_("%s signature %X does not match signature %X"),
+		      fmt->name, get_be32(p), fmt->signature);
+		return -1;
+	}
+	if (p[4] != fmt->version) {
+		error(_("%s version %X does not match version %X"),
+		      fmt->name, p[4], fmt->version);
+		return -1;
+	}
+	if (p[5] != oid_version(the_hash_algo)) {
+		error(_("%s hash version %X does not match version %X"),
+		      fmt->name, p[5], oid_version(the_hash_algo));
+		return -1;
+	}
+
+	cf = init_chunkfile(NULL);
+	if (read_table_of_contents(cf, si->data, si->data_len,
+				   SIDE_INDEX_HEADER_SIZE, p[6]))
+		goto out;
+
+	pair_chunk(cf, SIDE_INDEX_CHUNKID_OIDFANOUT,
+		   (const unsigned char **)&si->chunk_oid_fanout);
+	read_chunk(cf, SIDE_INDEX_CHUNKID_OIDLOOKUP, read_oid_lookup, si);
+
+	if (!si->chunk_oid_fanout || !si->chunk_oid_lookup ||
+	    read_chunks(cf, data) < 0) {
+		error(_("%s is missing a required chunk"), fmt->name);
+		goto out;
+	}
+	if (ntohl(si->chunk_oid_fanout[255]) != si->num_objects) {
+		error(_("%s has a bad fanout"), fmt->name);
+		goto out;
+	}
+	ret = 0;
+
+out:
+	free_chunkfile(cf);
+	return ret;
+}
+
+int load_side_index(struct repository *r, const struct side_index_format *fmt,
+		    struct side_index *si,
+		    int (*read_chunks)(struct chunkfile *cf, void *data),
+		    void *data)
+{
+	char *filename = get_side_index_filename(r, fmt);
+	struct stat st;
+	size_t len;
+	int fd;
+
+	memset(si, 0, sizeof(*si));
+	fd = git_open(filename);
+	free(filename);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+
+	len = xsize_t(st.st_size);
+	if (len < SIDE_INDEX_HEADER_SIZE + the_hash_algo->rawsz) {
+		close(fd);
+		return error(_("%s file is too small"), fmt->name);
+	}
+	si->data = xmmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	si->data_len = len;
+	close(fd);
+
+	if (parse_side_index(fmt, si, read_chunks, data) < 0) {
+		release_side_index(si);
+		return -1;
+	}
+	return 0;
+}
+
+void release_side_index(struct side_index *si)
+{
+	if (!si->data)
+		return;
+	munmap((void *)si->data, si->data_len);
+	memset(si, 0, sizeof(*si));
+}
+
+int side_index_lookup(const struct side_index *si,
+		      const struct object_id *oid, uint32_t *pos)
+{
+	return bsearch_hash(oid->hash, si->chunk_oid_fanout,
+			    si->chunk_oid_lookup, the_hash_algo->rawsz, pos);
+}
+
+void side_index_nth_oid(const struct side_index *si, uint32_t pos,
+			struct object_id *oid)
+{
+	oidread(oid, si->chunk_oid_lookup + the_hash_algo->rawsz * (size_t)pos);
+}
+
+static int write_oid_fanout(struct hashfile *f, void *data)
+{
+	struct side_index_writer *w = data;
+	size_t i = 0;
+	int b;
+
+	for (b = 0; b < 256; b++) {
+		while (i < w->nr && w->oids[i].hash[0] <= b)
+			i++;
+		hashwrite_be32(f, i);
+	}
+	return 0;
+}
+
+static int write_oid_lookup(struct hashfile *f, void *data)
+{
+	struct side_index_writer *w = data;
+	size_t i;
+
+	for (i = 0; i < w->nr; i++)
+		hashwrite(f, w->oids[i].hash, the_hash_algo->rawsz);
+	return 0;
+}
+
+void write_side_index(struct repository *r,
+		      const struct side_index_format *fmt,
+		      struct side_index_writer *w,
+		      void (*add_chunks)(struct chunkfile *cf,
+					 struct side_index_writer *w),
+		      struct side_index *old)
+{
+	char *filename = get_side_index_filename(r, fmt);
+	struct lock_file lk = LOCK_INIT;
+	struct chunkfile *cf;
+	struct hashfile *f;
+
+	if (safe_create_leading_directories(filename))
+		die_errno(_("unable to create leading directories of %s"),
+			  filename);
+	hold_lock_file_for_update_mode(&lk, filename, LOCK_DIE_ON_ERROR, 0444);
+	f = hashfd(get_lock_file_fd(&lk), get_lock_file_path(&lk));
+
+	cf = init_chunkfile(f);
+	add_chunk(cf, SIDE_INDEX_CHUNKID_OIDFANOUT, SIDE_INDEX_FANOUT_SIZE,
+		  write_oid_fanout);
+	add_chunk(cf, SIDE_INDEX_CHUNKID_OIDLOOKUP,
+		  st_mult(w->nr, the_hash_algo->rawsz), write_oid_lookup);
+	add_chunks(cf, w);
+
+	hashwrite_be32(f, fmt->signature);
+	hashwrite_u8(f, fmt->version);
+	hashwrite_u8(f, oid_version(the_hash_algo));
+	hashwrite_u8(f, get_num_chunks(cf));
+	hashwrite_u8(f, 0);
+
+	write_chunkfile(cf, w);
+	finalize_hashfile(f, NULL, FSYNC_COMPONENT_COMMIT_GRAPH,
+			  CSUM_HASH_IN_STREAM | CSUM_FSYNC);
+	free_chunkfile(cf);
+
+	/* let go of the old file before replacing it */
+	fmt->close(r->objects);
+	if (old)
+		release_side_index(old);
+
+	if (commit_lock_file(&lk) < 0)
+		die_errno(_("unable to write %s"), filename);
+	free(filename);
+}
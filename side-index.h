@@ -0,0 +1,96 @@
+#ifndef SIDE_INDEX_H
+#define SIDE_INDEX_H
+
+struct chunkfile;
+struct object_id;
+struct raw_object_store;
+struct repository;
+
+/*
+ * A side index is a file in $GIT_DIR/objects/info that remembers
+ * something about each of a set of objects, like the diffstat index
+ * and the grep index do. It is a chunk file (see
+ * Documentation/technical/chunk-format.txt) starting with an 8-byte
+ * header: a 4-byte signature, a 1-byte version, the 1-byte hash version,
+ * the 1-byte number of chunks and a zero byte. Its OID Fanout ("OIDF")
+ * and OID Lookup ("OIDL") chunks list the objects in sorted order, and
+ * the position of an object in them is what the other chunks, which are
+ * up to each index, refer to.
+ */
+struct side_index_format {
+	/* the name of the file in objects/info, also used in messages */
+	const char *name;
+	uint32_t signature;
+	unsigned char version;
+
+	/* forget the index loaded for the object store "o", if any */
+	void (*close)(struct raw_object_store *o);
+};
+
+struct side_index {
+	const unsigned char *data;
+	size_t data_len;
+
+	uint32_t num_objects;
+	const uint32_t *chunk_oid_fanout;
+	const unsigned char *chunk_oid_lookup;
+};
+
+/*
+ * Map the side index "fmt" of "r" into "si" and check its header and
+ * OID chunks. "read_chunks" is then called to find the other chunks in
+ * "cf", and returns -1 if one is missing.
+ *
+ * Returns 0 on success, and -1 if there is no usable file, after
+ * reporting why if it is corrupt.
+ */
+int load_side_index(struct repository *r, const struct side_index_format *fmt,
+		    struct side_index *si,
+		    int (*read_chunks)(struct chunkfile *cf, void *data),
+		    void *data);
+
+/*
+ * Unmap the file of "si". Doing so again does nothing.
+ */
+void release_side_index(struct side_index *si);
+
+/*
+ * Find the position of "oid" in "si". Returns 0 if it is not there.
+ */
+int side_index_lookup(const struct side_index *si,
+		      const struct object_id *oid, uint32_t *pos);
+
+/*
+ * Read the name of the object at position "pos" of "si" into "oid".
+ */
+void side_index_nth_oid(const struct side_index *si, uint32_t pos,
+			struct object_id *oid);
+
+struct side_index_writer {
+	/* the objects of the new file, sorted */
+	const struct object_id *oids;
+	size_t nr;
+
+	/* for the chunk_write_fn added by the caller */
+	void *data;
+};
+
+/*
+ * Write the side index "fmt" of "r", with the OID chunks for the
+ * objects of "w" and the chunks "add_chunks" adds to "cf". The
+ * chunk_write_fn of these are given "w".
+ *
+ * "old", if not NULL, is the index being replaced, which the chunks
+ * may be copied from; it is released, along with the one "r" has
+ * loaded, before the new file takes its place.
+ */
+void write_side_index(struct repository *r,
+		      const struct side_index_format *fmt,
+		      struct side_index_writer *w,
+		      void (*add_chunks)(struct chunkfile *cf,
+					 struct side_index_writer *w),
+		      struct side_index *old);
+
+#define SIDE_INDEX_WRITE_PROGRESS (1 << 0)
+
+#endif /* SIDE_INDEX_H */
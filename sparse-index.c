@@ -289,7 +289,7 @@ static int add_path_to_index(const struct object_id *oid,
 
 void expand_index(struct index_state *istate, struct pattern_list *pl)
 {
-	int i;
+	int i, nr_expanded = 0;
 	struct index_state *full;
 	struct strbuf base = STRBUF_INIT;
 	const char *tr_region;
@@ -398,6 +398,7 @@ void expand_index(struct index_state *istate, struct pattern_list *pl)
 
 		/* free directory entries. full entries are re-used */
 		discard_cache_entry(ce);
+		nr_expanded++;
 	}
 
 	/* Copy back into original index. */
@@ -419,6 +420,14 @@ void expand_index(struct index_state *istate, struct pattern_list *pl)
 	cache_tree_free(&istate->cache_tree);
 	cache_tree_update(istate, 0);
 
+	/*
+	 * Report how much work the expansion did, so that callers that
+	 * expand unnecessarily are easy to spot in traces.
+	 */
+	trace2_data_intmax("index", istate->repo, "sparse_dirs_expanded",
+			   nr_expanded);
+	trace2_data_intmax("index", istate->repo, "cache_nr", istate->cache_nr);
+
 	trace2_region_leave("index", tr_region, istate->repo);
 }
 
@@ -164,6 +164,45 @@ int cmd__reach(int ac, const char **av)
 			die(_("too many commits marked reachable"));
 
 		print_sorted_commit_ids(list);
+	} else if (!strcmp(av[1], "ahead_behind")) {
+		struct commit **commits;
+		struct ahead_behind_count *counts;
+		size_t i, j, nr = 0;
+
+		ALLOC_ARRAY(commits, st_add(X_nr, Y_nr));
+		COPY_ARRAY(commits, X_array, X_nr);
+		COPY_ARRAY(commits + X_nr, Y_array, Y_nr);
+		CALLOC_ARRAY(counts, st_mult(X_nr, Y_nr));
+
+		for (i = 0; i < X_nr; i++) {
+			for (j = 0; j < Y_nr; j++) {
+				counts[nr].tip_index = i;
+				counts[nr].base_index = X_nr + j;
+				nr++;
+			}
+		}
+
+		ahead_behind(r, commits, st_add(X_nr, Y_nr), counts, nr);
+
+		printf("ahead_behind(X,Y):\n");
+		for (i = 0; i < nr; i++)
+			printf("%u %u\n", counts[i].ahead, counts[i].behind);
+
+		free(commits);
+		free(counts);
+	} else if (!strcmp(av[1], "in_merge_bases_matrix")) {
+		int i, j;
+
+		/*
+		 * Answer in_merge_bases() for every pair, to compare the
+		 * reachability index of the commit-graph with walks.
+		 */
+		printf("in_merge_bases_matrix(X,Y):\n");
+		for (i = 0; i < X_nr; i++) {
+			for (j = 0; j < Y_nr; j++)
+				putchar('0' + repo_in_merge_bases(r, Y_array[j], X_array[i]));
+			putchar('\n');
+		}
 	}
 
 	return 0;
@@ -44,6 +44,8 @@ int cmd__read_graph(int argc, const char **argv)
 		printf(" bloom_indexes");
 	if (graph->chunk_bloom_data)
 		printf(" bloom_data");
+	if (graph->chunk_reachability)
+		printf(" reachability_index");
 	printf("\n");
 
 	printf("options:");
@@ -151,6 +151,31 @@ rev_list_tests_head () {
 		test_cmp expect actual
 	'
 
+	test_expect_success "counting commits with commit limits ($state, $branch)" '
+		mid=$(git log -1 --format=%ct $branch~50) &&
+		for limit in --first-parent --no-merges --merges \
+			--min-parents=1 --max-parents=0 --until=$mid \
+			--since-as-filter=$mid "--first-parent --no-merges"
+		do
+			git rev-list --count $limit $branch >expect &&
+			git rev-list --use-bitmap-index --count $limit $branch >actual &&
+			test_cmp expect actual &&
+			git rev-list --count $limit other...second >expect &&
+			git rev-list --use-bitmap-index --count $limit other...second >actual &&
+			test_cmp expect actual &&
+			git rev-list --disk-usage $limit $branch >expect &&
+			git rev-list --use-bitmap-index --disk-usage $limit $branch >actual &&
+			test_cmp expect actual || return 1
+		done
+	'
+
+	test_expect_success "counting commits with --max-age ($state, $branch)" '
+		mid=$(git log -1 --format=%ct $branch~50) &&
+		git rev-list --count --max-age=$mid $branch >expect &&
+		git rev-list --use-bitmap-index --count --max-age=$mid $branch >actual &&
+		test_cmp expect actual
+	'
+
 	test_expect_success "counting objects via bitmap ($state, $branch)" '
 		git rev-list --count --objects $branch >expect &&
 		git rev-list --use-bitmap-index --count --objects $branch >actual &&
@@ -51,6 +51,14 @@ test_full_bitmap () {
 	test_perf 'simulated partial clone' '
 		git pack-objects --stdout --all --filter=blob:none </dev/null >/dev/null
 	'
+
+	test_perf 'for-each-ref --contains' '
+		git for-each-ref --contains HEAD~100 >/dev/null
+	'
+
+	test_perf 'for-each-ref --merged' '
+		git for-each-ref --merged HEAD >/dev/null
+	'
 }
 
 test_partial_bitmap () {
@@ -64,4 +64,19 @@ test_perf "switch between aliases ($nr_files)" '
 	git checkout -q br_ballast
 '
 
+test_perf "reset --hard between br_base br_ballast ($nr_files)" '
+	git reset -q --hard br_base &&
+	git reset -q --hard br_ballast
+'
+
+test_perf "reset --hard between br_base br_ballast, no preload ($nr_files)" '
+	git -c core.preloadIndex=false reset -q --hard br_base &&
+	git -c core.preloadIndex=false reset -q --hard br_ballast
+'
+
+test_perf "reset --keep between br_ballast br_ballast_plus_1 ($nr_files)" '
+	git reset -q --keep br_ballast_plus_1 &&
+	git reset -q --keep br_ballast
+'
+
 test_done
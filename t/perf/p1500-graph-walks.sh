@@ -0,0 +1,53 @@
+#!/bin/sh
+
+test_description='Commit walk performance tests'
+. ./perf-lib.sh
+
+test_perf_large_repo
+
+test_expect_success 'setup' '
+	git rev-list --all >commits &&
+	# Point a few thousand branches at commits spread over the history.
+	awk "NR % 3 == 1 { print \"create refs/heads/ab-\" NR \" \" \$1 }" commits |
+		head -n 5000 >ab-refs &&
+	git update-ref --stdin <ab-refs &&
+	git for-each-ref --format="%(refname)" "refs/heads/ab-*" >branches &&
+	head -n 100 branches >branches-100 &&
+	git commit-graph write --reachable
+'
+
+test_perf 'ahead-behind counts: for-each-ref, all branches' '
+	git for-each-ref --format="%(ahead-behind:HEAD)" "refs/heads/ab-*"
+'
+
+test_perf 'ahead-behind counts: rev-list --left-right, 100 branches' '
+	for ref in $(cat branches-100)
+	do
+		git rev-list --count --left-right HEAD...$ref || return 1
+	done
+'
+
+test_perf 'ahead-behind counts: for-each-ref, 100 branches' '
+	git for-each-ref --format="%(ahead-behind:HEAD)" $(cat branches-100)
+'
+
+test_expect_success 'setup reachability index' '
+	sed "s/^/X:/" branches-100 >reach-input &&
+	sed -n "s/^/Y:/;1~7p" commits | head -n 100 >>reach-input &&
+	git commit-graph write --reachable --reachability-index
+'
+
+for read in false true
+do
+	test_perf "in_merge_bases, 100x100 pairs (readReachabilityIndex=$read)" "
+		git config commitGraph.readReachabilityIndex $read &&
+		test-tool reach in_merge_bases_matrix <reach-input
+	"
+
+	test_perf "branch --contains (readReachabilityIndex=$read)" "
+		git -c commitGraph.readReachabilityIndex=$read \
+			branch --contains HEAD~50 --list 'ab-*'
+	"
+done
+
+test_done
@@ -0,0 +1,27 @@
+#!/bin/sh
+
+test_description="Tests performance of parallel checkout worker types"
+
+. ./perf-lib.sh
+
+test_perf_default_repo
+test_checkout_worktree
+
+test_expect_success 'setup' '
+	nr_files=$(git ls-files | wc -l)
+'
+
+for workers in 1 2 8
+do
+	for type in process thread
+	do
+		test_perf "checkout all files, $workers $type workers ($nr_files)" \
+			--setup 'git ls-files -z | xargs -0 rm -f' "
+			git -c checkout.workers=$workers \
+			    -c checkout.thresholdForParallelism=0 \
+			    -c checkout.workerType=$type checkout -f -- .
+		"
+	done
+done
+
+test_done
@@ -0,0 +1,34 @@
+#!/bin/sh
+
+test_description='Tests performance of adding many new files'
+. ./perf-lib.sh
+
+test_perf_fresh_repo
+
+test_expect_success 'setup many new files' '
+	git init repo &&
+	mkdir new-files &&
+	for i in $(test_seq 50)
+	do
+		mkdir new-files/dir$i &&
+		for j in $(test_seq 100)
+		do
+			test_seq $i $((i + j * 10)) >new-files/dir$i/file$j ||
+			return 1
+		done || return 1
+	done
+'
+
+for threads in 1 0 4
+do
+	test_perf "add new files (add.threads=$threads)" \
+		--setup "
+			rm -rf repo &&
+			git init -q repo &&
+			cp -R new-files/. repo/
+		" "
+		git -C repo -c add.threads=$threads add .
+	"
+done
+
+test_done
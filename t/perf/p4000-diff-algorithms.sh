@@ -14,6 +14,28 @@ test_perf 'log --raw -3000 (tree-only)' '
 	git log --raw -3000 >/dev/null
 '
 
+# Two commits that change every one of many paths, so that the diff is
+# all about queueing and freeing filepairs.
+test_expect_success 'setup many changed paths' '
+	git init many-paths &&
+	awk "BEGIN {
+		print \"blob\"; print \"mark :1\"; print \"data 2\"; print \"a\"
+		print \"blob\"; print \"mark :2\"; print \"data 2\"; print \"b\"
+		for (c = 1; c <= 2; c++) {
+			print \"commit refs/heads/main\"
+			print \"committer A <a@example.com> 0 +0000\"
+			print \"data 0\"
+			for (i = 0; i < 200000; i++)
+				printf \"M 100644 :%d d%d/e%d/f%d\\n\", c, i % 100, i % 97, i
+			print \"\"
+		}
+	}" | git -C many-paths fast-import --quiet
+'
+
+test_perf 'diff-tree -r many changed paths' '
+	git -C many-paths diff-tree -r main~ main >/dev/null
+'
+
 test_perf 'log -p -3000 (Myers)' '
 	git log -p -3000 >/dev/null
 '
@@ -26,4 +48,65 @@ test_perf 'log -p -3000 --patience' '
 	git log -p -3000 --patience >/dev/null
 '
 
+test_expect_success 'setup large files' '
+	awk "BEGIN {
+		for (i = 0; i < 1000000; i++)
+			printf \"%d,item-%d,%d.%02d\\n\", i, i * 7 % 1000, i % 997, i % 100
+	}" >large-a.csv &&
+	awk "NR % 1000 == 0 { print \$0 \",changed\"; next } { print }" \
+		large-a.csv >large-b.csv
+'
+
+test_perf 'diff --no-index large file (Myers)' '
+	git diff --no-index large-a.csv large-b.csv >/dev/null ||
+	test $? = 1
+'
+
+test_perf 'diff --no-index large file --histogram' '
+	git diff --no-index --histogram large-a.csv large-b.csv >/dev/null ||
+	test $? = 1
+'
+
+test_perf 'diff --no-index large file --ignore-cr-at-eol' '
+	git diff --no-index --ignore-cr-at-eol large-a.csv large-b.csv >/dev/null ||
+	test $? = 1
+'
+
+test_perf 'diff --no-index large file -w' '
+	git diff --no-index -w large-a.csv large-b.csv >/dev/null ||
+	test $? = 1
+'
+
+test_perf 'diff --no-index large file --diff-algorithm=bounded' '
+	git diff --no-index --diff-algorithm=bounded \
+		large-a.csv large-b.csv >/dev/null ||
+	test $? = 1
+'
+
+# A lock file made of few distinct lines, a third of which change, so
+# that there are hardly any unique lines to anchor on.
+test_expect_success 'setup lock files' '
+	awk "BEGIN {
+		srand(1)
+		for (i = 0; i < 200000; i++) {
+			r = int(rand() * 8)
+			if (r < 3) print \"  }\"
+			else if (r < 5) print \"  dependencies:\"
+			else if (r < 7) print \"\"
+			else print \"    version \" int(rand() * 50)
+		}
+	}" >lock-a &&
+	awk "BEGIN { srand(2) }
+		rand() < 0.3 { print \"    version \" int(rand() * 50); next }
+		{ print }" lock-a >lock-b
+'
+
+for algo in myers histogram bounded
+do
+	test_perf "diff --no-index lock file churn ($algo)" "
+		git diff --no-index --diff-algorithm=$algo lock-a lock-b >/dev/null 2>&1 ||
+		test \$? = 1
+	"
+done
+
 test_done
@@ -39,6 +39,14 @@ test_perf 'diff --color-moved-ws=allow-indentation-change large change' '
 		$rev_a $rev_b
 '
 
+for threads in 1 0
+do
+	test_perf "diff --color-moved large change (diff.threads=$threads)" "
+		git -c diff.threads=$threads diff --color-moved=zebra \
+			--no-color-moved-ws \$rev_a \$rev_b
+	"
+done
+
 test_perf 'log --no-color-moved --no-color-moved-ws' '
 	git log --no-color-moved --no-color-moved-ws --no-merges --patch \
 		-n1000 $rev_b
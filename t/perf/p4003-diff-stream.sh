@@ -0,0 +1,65 @@
+#!/bin/sh
+
+test_description='diff of large files with and without diff.streamThreshold'
+. ./perf-lib.sh
+
+test_perf_fresh_repo
+
+# The number of lines of the larger file can be set with
+# GIT_PERF_DIFF_STREAM_LINES; the smaller one has a quarter of them.
+lines=${GIT_PERF_DIFF_STREAM_LINES:-4000000}
+
+# Packed blobs are only streamed when they are larger than
+# core.bigFileThreshold, and the packs are mapped a window at a time.
+stream="-c diff.streamThreshold=1m -c core.bigFileThreshold=1m"
+stream="$stream -c core.packedGitWindowSize=1m -c core.packedGitLimit=4m"
+
+if test -x /usr/bin/time && /usr/bin/time -f %M true >/dev/null 2>&1
+then
+	test_set_prereq MAXRSS
+fi
+
+test_expect_success 'setup' '
+	for n in $((lines / 4)) $lines
+	do
+		awk -v n=$n "BEGIN {
+			for (i = 1; i <= n; i++)
+				print \"log entry number\", i
+		}" >file-$n &&
+		awk "NR % 100000 == 0 { print \"changed\", NR; next } { print }" \
+			file-$n >file-$n.new || return 1
+	done &&
+	git add file-* &&
+	git commit -q -m before &&
+	for n in $((lines / 4)) $lines
+	do
+		mv file-$n.new file-$n || return 1
+	done &&
+	git add file-* &&
+	git commit -q -m after &&
+	git repack -q -adf --window=0
+'
+
+for n in $((lines / 4)) $lines
+do
+	test_perf "diff of $n lines" "
+		git diff HEAD~ HEAD -- file-$n >/dev/null
+	"
+
+	test_perf "diff of $n lines, streamed" "
+		git $stream diff HEAD~ HEAD -- file-$n >/dev/null
+	"
+
+	test_size "peak RSS in kB, diff of $n lines" --prereq MAXRSS "
+		/usr/bin/time -f %M -o rss git diff HEAD~ HEAD -- file-$n >/dev/null &&
+		cat rss
+	"
+
+	test_size "peak RSS in kB, diff of $n lines, streamed" --prereq MAXRSS "
+		/usr/bin/time -f %M -o rss \
+			git $stream diff HEAD~ HEAD -- file-$n >/dev/null &&
+		cat rss
+	"
+done
+
+test_done
@@ -0,0 +1,19 @@
+#!/bin/sh
+
+test_description='Tests the performance of log with diffs'
+
+. ./perf-lib.sh
+
+test_perf_default_repo
+
+for threads in 1 0
+do
+	for args in "-p" "--stat" "--raw"
+	do
+		test_perf "log $args -1000 (log.threads=$threads)" "
+			git -c log.threads=$threads log $args -1000 >/dev/null
+		"
+	done
+done
+
+test_done
@@ -67,4 +67,32 @@ do
 	done
 done
 
+# A diff that changes many files, whose filepairs are searched by threads
+# unless diff.threads is 1.
+for threads in 1 0
+do
+	for opts in \
+		"-S'int main'" \
+		"-G'(int|void|null)'"
+	do
+		test_perf "git diff $opts$from_rev_desc (diff.threads=$threads)" "
+			git -c diff.threads=$threads diff --name-only $opts$from_rev
+		"
+	done
+done
+
+# With diff.pickaxeCache, the blobs that the first search read are not
+# read again.
+for opts in \
+	"-S'int main'" \
+	"-G'(int|void|null)'"
+do
+	test_expect_success "fill the pickaxe cache for $opts" "
+		git -c diff.pickaxeCache=true log --pretty=format:%H $opts$from_rev
+	"
+	test_perf "git log $opts$from_rev_desc (diff.pickaxeCache)" "
+		git -c diff.pickaxeCache=true log --pretty=format:%H $opts$from_rev
+	"
+done
+
 test_done
@@ -12,8 +12,20 @@ test_expect_success 'select a file' '
 	sort -k 3 | head -1 | cut -f 2 >filelist
 '
 
+test_expect_success 'select a second file and a directory' '
+	git ls-tree HEAD | grep ^100644 |
+	sort -k 3 | sed -n 2p | cut -f 2 >filelist2 &&
+	git ls-tree -d HEAD | sort -k 3 | head -1 | cut -f 2 >dirlist
+'
+
 file=$(cat filelist)
-export file
+file2=$(cat filelist2)
+dir=$(cat dirlist)
+export file file2 dir
+
+test_expect_success 'write commit-graph with changed-path Bloom filters' '
+	git commit-graph write --reachable --changed-paths
+'
 
 test_perf 'git rev-list --topo-order (baseline)' '
 	git rev-list --topo-order HEAD >/dev/null
@@ -23,6 +35,18 @@ test_perf 'git log --follow (baseline for -M)' '
 	git log --oneline --follow -- "$file" >/dev/null
 '
 
+test_perf 'git log --follow (with Bloom filters)' '
+	git log --oneline --follow -- "$file" >/dev/null
+'
+
+test_perf 'git log -- <two paths> (with Bloom filters)' '
+	git log --oneline -- "$file" "$file2" >/dev/null
+'
+
+test_perf 'git log -- <dir>/* (with Bloom filters)' '
+	git log --oneline -- "$dir/*" >/dev/null
+'
+
 test_perf 'git log -L (renames off)' '
 	git log --no-renames -L 1:"$file" >/dev/null
 '
@@ -31,6 +55,18 @@ test_perf 'git log -L (renames on)' '
 	git log -M -L 1:"$file" >/dev/null
 '
 
+test_perf 'git log -L (without Bloom filters)' '
+	git -c commitGraph.readChangedPaths=false log -M -L 1:"$file" >/dev/null
+'
+
+test_perf 'git blame (with Bloom filters)' '
+	git blame "$file" >/dev/null
+'
+
+test_perf 'git blame (without Bloom filters)' '
+	git -c commitGraph.readChangedPaths=false blame "$file" >/dev/null
+'
+
 test_perf 'git log --oneline --raw --parents' '
 	git log --oneline --raw --parents >/dev/null
 '
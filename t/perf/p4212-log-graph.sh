@@ -0,0 +1,29 @@
+#!/bin/sh
+
+test_description='Tests the performance of log --graph, one page at a time'
+
+. ./perf-lib.sh
+
+test_perf_default_repo
+
+test_expect_success 'write commit-graph with a reachability index' '
+	git commit-graph write --reachable --reachability-index
+'
+
+for order in false true
+do
+	for skip in 0 200 1000
+	do
+		test_perf "log --graph --topo-order --skip=$skip -200 (commitGraph.useTopoOrder=$order)" "
+			git -c commitGraph.useTopoOrder=$order \
+				log --graph --topo-order --oneline --skip=$skip -200 >/dev/null
+		"
+	done
+
+	test_perf "log --graph --topo-order --all -200 (commitGraph.useTopoOrder=$order)" "
+		git -c commitGraph.useTopoOrder=$order \
+			log --graph --topo-order --oneline --all -200 >/dev/null
+	"
+done
+
+test_done
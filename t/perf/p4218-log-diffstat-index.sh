@@ -0,0 +1,24 @@
+#!/bin/sh
+
+test_description='Tests log --stat performance with the diffstat index'
+. ./perf-lib.sh
+
+test_perf_default_repo
+
+test_perf 'write diffstat index' '
+	rm -f .git/objects/info/diffstat-index &&
+	git maintenance run --task=diffstat-index
+'
+
+for opts in --stat --numstat --raw
+do
+	test_perf "git log $opts -1000 (without diffstat index)" "
+		git -c core.diffstatIndex=false log $opts -1000 >/dev/null
+	"
+
+	test_perf "git log $opts -1000 (with diffstat index)" "
+		git log $opts -1000 >/dev/null
+	"
+done
+
+test_done
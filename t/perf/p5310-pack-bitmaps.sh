@@ -28,6 +28,30 @@ test_perf 'repack to disk' '
 
 test_full_bitmap
 
+test_perf 'rev-list count --first-parent' '
+	git rev-list --use-bitmap-index --count --first-parent HEAD~100..HEAD >/dev/null
+'
+
+test_perf 'rev-list count --no-merges (no commit attributes)' '
+	git rev-list --use-bitmap-index --count --no-merges --all >/dev/null
+'
+
+test_expect_success 'repack with commit attributes' '
+	git -c pack.writeBitmapCommitAttributes=true repack -ad
+'
+
+test_perf 'rev-list count --no-merges' '
+	git rev-list --use-bitmap-index --count --no-merges --all >/dev/null
+'
+
+test_perf 'rev-list count --until' '
+	git rev-list --use-bitmap-index --count --until=1.year.ago --all >/dev/null
+'
+
+test_perf 'rev-list disk-usage --no-merges' '
+	git rev-list --use-bitmap-index --disk-usage --no-merges --all >/dev/null
+'
+
 test_expect_success 'create partial bitmap state' '
 	# pick a commit to represent the repo tip in the past
 	cutoff=$(git rev-list HEAD~100 -1) &&
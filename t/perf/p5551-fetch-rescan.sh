@@ -52,4 +52,74 @@ test_perf 'fetch' '
 	)
 '
 
+# fast-import input for commits <first> to <last> on branch <prefix><i>
+# for each of 100 branches, continuing from what the branch has if
+# <continue> is given
+make_commits () {
+	for i in $(test_seq 100)
+	do
+		for j in $(test_seq $2 $3)
+		do
+			cat <<-EOF &&
+			commit refs/heads/$1$i
+			committer C O Mitter <committer@example.com> $((1000000000 + 1000 * j + i)) +0000
+			data <<EOM
+			$1$i.c$j
+			EOM
+			EOF
+			if test $j = $2 && test -n "$4"
+			then
+				echo "from refs/heads/$4$i^0"
+			fi &&
+			cat <<-EOF || return 1
+			M 644 inline $1$i.t
+			data <<EOM
+			$j
+			EOM
+
+			EOF
+		done
+	done
+}
+
+# A stale clone of a repository with many refs: the server has moved on by
+# a few commits on each of its branches, and the clone has a lot of local
+# work on top of what it fetched last, but no longer has refs for what
+# it fetched, so that negotiation needs to find it by walking.
+test_expect_success 'create a server with many branches and a stale clone' '
+	git init server &&
+	make_commits b 1 50 >input &&
+	git -C server fast-import <input &&
+	git clone --bare --no-local server stale &&
+	make_commits b 51 70 b >input &&
+	git -C server fast-import <input &&
+	git -C server repack -adb &&
+	git -C server commit-graph write --reachable &&
+	make_commits local 51 250 b >input &&
+	git -C stale fast-import <input &&
+	git -C stale for-each-ref --format="delete %(refname)" "refs/heads/b*" |
+	git -C stale update-ref --stdin &&
+	git -C stale repack -adb &&
+	git -C stale commit-graph write --reachable
+'
+
+for algo in consecutive skipping bitmap
+do
+	test_perf "fetch from a stale clone ($algo)" \
+		--setup "rm -rf client && cp -R stale client" "
+		git -C client -c fetch.negotiationAlgorithm=$algo \
+			fetch ../server refs/heads/b*:refs/remotes/origin/b*
+	"
+
+	test_size "round-trips from a stale clone ($algo)" \
+		--setup "rm -rf client && cp -R stale client" "
+		GIT_TRACE_PACKET=\"\$(pwd)/trace\" \
+		git -C client -c fetch.negotiationAlgorithm=$algo \
+			fetch --upload-pack 'unset GIT_TRACE_PACKET; git-upload-pack' \
+			../server refs/heads/b*:refs/remotes/origin/b* &&
+		grep -c 'fetch> command=fetch' trace &&
+		rm -f trace
+	"
+done
+
 test_done
@@ -20,4 +20,24 @@ test_perf 'grep --cached, expensive regex' '
 	git grep --cached "^.* *some_nonexistent_string$" || :
 '
 
+test_perf 'write grep index' '
+	rm -f .git/objects/info/grep-index &&
+	git maintenance run --task=grep-index
+'
+
+for pattern in some_nonexistent_string 'some_.*_string'
+do
+	test_perf "grep HEAD '$pattern' (without grep index)" "
+		git -c core.grepIndex=false grep '$pattern' HEAD || :
+	"
+	test_perf "grep HEAD '$pattern' (with grep index)" "
+		git grep '$pattern' HEAD || :
+	"
+done
+
+test_perf 'grep in the last 50 commits' '
+	git -c core.grepIndex=false grep some_nonexistent_string \
+		$(git rev-list -50 HEAD) || :
+'
+
 test_done
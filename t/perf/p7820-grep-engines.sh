@@ -87,4 +87,16 @@ do
 	fi
 done
 
+# Several patterns, some of which match rarely or not at all, and
+# expressions that can only match where one of their patterns does.
+for args in \
+	"-e int -e 'v.ry rare' -e 'no.such.th[i]ng'" \
+	"-e int --and -e return" \
+	"--all-match -e int -e 'v.ry rare'"
+do
+	test_perf "grep$GIT_PERF_7820_GREP_OPTS $args" "
+		git grep$GIT_PERF_7820_GREP_OPTS $args >out.many || :
+	"
+done
+
 test_done
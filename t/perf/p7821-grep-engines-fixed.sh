@@ -71,4 +71,23 @@ do
 	fi
 done
 
+# Many literal patterns at once, as a scanner for leaked secrets would
+# use. Only a few of them occur in the tree.
+for nr in 10 100 1000 5000
+do
+	test_expect_success "setup $nr fixed patterns" "
+		awk 'BEGIN {
+			srand($nr)
+			for (i = 0; i < $nr - 2; i++)
+				printf \"secret_%08x%08x\\n\", rand() * 4294967295, rand() * 4294967295
+			print \"uncommon\"
+			print \"int\"
+		}' >patterns.$nr
+	"
+
+	test_perf "fixed grep$GIT_PERF_7821_GREP_OPTS -f <$nr patterns>" "
+		git grep -F$GIT_PERF_7821_GREP_OPTS -f patterns.$nr >out.many.$nr || :
+	"
+done
+
 test_done
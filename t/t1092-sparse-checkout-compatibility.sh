@@ -457,6 +457,25 @@ test_expect_success 'status/add: outside sparse cone' '
 	test_all_match git rev-parse HEAD^{tree}
 '
 
+test_expect_success 'add --sparse with threads and line endings' '
+	init_repos &&
+
+	run_on_sparse mkdir folder1 &&
+	printf "one\r\ntwo\r\n" >crlf &&
+	for i in $(test_seq 1 20)
+	do
+		run_on_sparse cp ../crlf folder1/new-$i || return 1
+	done &&
+
+	test_sparse_match git -c core.autocrlf=true -c add.threads=4 \
+		add --sparse folder1 &&
+	test_sparse_match git -c core.autocrlf=true status --porcelain=v2 &&
+	test_sparse_match git ls-files -s folder1 &&
+	printf "one\ntwo\n" >expect &&
+	git -C sparse-index cat-file -p :folder1/new-1 >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success 'checkout and reset --hard' '
 	init_repos &&
 
@@ -1853,4 +1872,143 @@ test_expect_success 'mv directory from out-of-cone to in-cone' '
 	grep -e "H deep/0/1" actual
 '
 
+test_expect_success 'grep with and without --cached' '
+	init_repos &&
+
+	test_all_match git grep --cached a &&
+	test_all_match git grep --cached a -- deep &&
+	test_all_match git grep --cached a -- folder1 &&
+	test_all_match git grep --cached a -- "folder1/*" &&
+	test_all_match git grep --cached a -- "*/a" &&
+	test_sparse_match git grep a &&
+	test_all_match git grep a -- deep
+'
+
+test_expect_success 'sparse-index is not expanded: grep' '
+	init_repos &&
+
+	ensure_not_expanded grep a &&
+	ensure_not_expanded grep a -- deep &&
+	ensure_not_expanded grep --cached a &&
+	ensure_not_expanded grep --cached a -- deep &&
+	ensure_not_expanded grep --cached a -- folder1 &&
+	ensure_not_expanded grep --cached a -- "folder1/*"
+'
+
+test_expect_success 'rm pathspec inside sparse definition' '
+	init_repos &&
+
+	test_all_match git rm deep/a &&
+	test_all_match git status --porcelain=v2 &&
+
+	test_all_match git reset --hard &&
+	test_all_match git rm -r deep &&
+	test_all_match git status --porcelain=v2 &&
+
+	test_all_match git reset --hard &&
+	test_all_match git rm --cached -r "deep/*" &&
+	test_all_match git status --porcelain=v2
+'
+
+test_expect_success 'rm pathspec outside sparse definition' '
+	init_repos &&
+
+	for file in folder1/a folder1/0/1
+	do
+		test_sparse_match test_must_fail git rm $file &&
+		test_sparse_match test_must_fail git rm --cached $file &&
+		test_sparse_match git rm --sparse $file &&
+		test_sparse_match git status --porcelain=v2 || return 1
+	done &&
+
+	test_sparse_match git reset --hard &&
+	test_sparse_match git rm --sparse -r folder2 &&
+	test_sparse_match git status --porcelain=v2
+'
+
+test_expect_success 'sparse-index is not expanded: rm' '
+	init_repos &&
+
+	ensure_not_expanded rm deep/a &&
+	ensure_not_expanded reset --hard &&
+	ensure_not_expanded rm -r deep &&
+	ensure_not_expanded reset --hard &&
+	ensure_not_expanded rm --cached -r "deep/*" &&
+	ensure_not_expanded reset --hard &&
+	ensure_not_expanded ! rm -r folder1
+'
+
+test_expect_success 'mv within sparse definition' '
+	init_repos &&
+
+	test_all_match git mv deep/a deep/moved &&
+	test_all_match git status --porcelain=v2 &&
+
+	test_all_match git reset --hard &&
+	test_all_match git mv deep/deeper1 deep/deeper3 &&
+	test_all_match git status --porcelain=v2
+'
+
+test_expect_success 'sparse-index is not expanded: mv' '
+	init_repos &&
+
+	ensure_not_expanded mv deep/a deep/moved &&
+	ensure_not_expanded reset --hard &&
+	ensure_not_expanded mv deep/deeper1 deep/deeper3 &&
+	ensure_not_expanded reset --hard
+'
+
+test_expect_success 'describe --dirty' '
+	init_repos &&
+
+	test_all_match git describe --always --dirty &&
+	run_on_all ../edit-contents deep/a &&
+	test_all_match git describe --always --dirty
+'
+
+test_expect_success 'sparse-index is not expanded: describe --dirty' '
+	init_repos &&
+
+	ensure_not_expanded describe --always --dirty &&
+	echo >>sparse-index/deep/a &&
+	ensure_not_expanded describe --always --dirty
+'
+
+test_expect_success 'ls-files with pathspec' '
+	init_repos &&
+
+	test_all_match git ls-files -- deep &&
+	test_all_match git ls-files -- "deep/*" &&
+	test_all_match git ls-files -- folder1 &&
+	test_all_match git ls-files -- "folder1/*" &&
+	test_all_match git ls-files -- "*/a"
+'
+
+test_expect_success 'sparse-index is not expanded: ls-files with pathspec' '
+	init_repos &&
+
+	ensure_not_expanded ls-files -- deep &&
+	ensure_not_expanded ls-files -- "deep/*" &&
+	ensure_not_expanded ls-files --stage -- deep/deeper1
+'
+
+test_expect_success 'sparse-index is not expanded: stash with pathspec' '
+	init_repos &&
+
+	echo >>sparse-index/deep/a &&
+	echo >>sparse-index/a &&
+	rm -f trace2.txt &&
+	GIT_TRACE2_EVENT="$(pwd)/trace2.txt" \
+		git -C sparse-index stash push -- deep/a &&
+	git -C sparse-index diff --quiet -- deep/a &&
+	test_must_fail git -C sparse-index diff --quiet -- a &&
+
+	# Only check the stash process itself; the helpers it spawns to
+	# apply the stash to the worktree are not all sparse-aware yet.
+	grep -v "\"sid\":\"[^\"]*/" trace2.txt >stash-trace2.txt &&
+	test_region ! index ensure_full_index stash-trace2.txt &&
+
+	ensure_not_expanded stash pop
+'
+
 test_done
@@ -148,6 +148,27 @@ do
 	'
 done
 
+test_expect_success 'threaded checkout' '
+	repo=various_threads &&
+	cp -R -P various $repo &&
+	git -C $repo submodule foreach "git update-index --refresh" &&
+
+	set_checkout_config 2 0 &&
+	test_config_global checkout.workerType thread &&
+	test_checkout_worker_threads 2 \
+		git -C $repo checkout --recurse-submodules B2 &&
+	verify_checkout $repo
+'
+
+test_expect_success 'threaded checkout on clone' '
+	repo=various_threads_clone &&
+	set_checkout_config 2 0 &&
+	test_config_global checkout.workerType thread &&
+	test_checkout_worker_threads 2 \
+		git clone --recurse-submodules --branch B2 various $repo &&
+	verify_checkout $repo
+'
+
 # Just to be paranoid, actually compare the working trees' contents directly.
 test_expect_success 'compare the working trees' '
 	rm -rf various_*/.git &&
@@ -160,7 +181,9 @@ test_expect_success 'compare the working trees' '
 	git diff --no-index various_sequential various_parallel &&
 	git diff --no-index various_sequential various_parallel_clone &&
 	git diff --no-index various_sequential various_sequential-fallback &&
-	git diff --no-index various_sequential various_sequential-fallback_clone
+	git diff --no-index various_sequential various_sequential-fallback_clone &&
+	git diff --no-index various_sequential various_threads &&
+	git diff --no-index various_sequential various_threads_clone
 '
 
 # Currently, each submodule is checked out in a separated child process, but
@@ -226,4 +249,32 @@ test_expect_success SYMLINKS 'parallel checkout checks for symlinks in leading d
 	)
 '
 
+test_expect_success 'worker threads stream big blobs' '
+	set_checkout_config 2 0 &&
+	test_config_global checkout.workerType thread &&
+	git init big &&
+	(
+		cd big &&
+		test_commit A &&
+		test_commit B &&
+		rm A.t B.t &&
+		test_checkout_worker_threads 2 \
+			git -c core.bigFileThreshold=1 checkout -- . &&
+		grep A A.t &&
+		grep B B.t
+	)
+'
+
+test_expect_success 'invalid checkout.workerType' '
+	set_checkout_config 2 0 &&
+	test_config_global checkout.workerType fibers &&
+	test_when_finished "rm -rf fibers" &&
+	git init fibers &&
+	test_commit -C fibers A &&
+	test_commit -C fibers B &&
+	rm fibers/A.t fibers/B.t &&
+	test_must_fail git -C fibers checkout -- . 2>err &&
+	grep "invalid value for .checkout.workerType.: .fibers." err
+'
+
 test_done
@@ -491,6 +491,72 @@ test_expect_success 'all statuses changed in folder if . is given' '
 	)
 '
 
+test_expect_success 'setup many new files' '
+	git init many &&
+	(
+		cd many &&
+		for d in a b c d
+		do
+			mkdir $d &&
+			test_seq 1 50 | sed "s,^,$d/," >$d/list &&
+			for f in $(cat $d/list)
+			do
+				echo "content of $f" >$f || return 1
+			done || return 1
+		done &&
+		echo same >a/dup1 &&
+		echo same >a/dup2 &&
+		printf "one\r\ntwo\r\n" >a/crlf.txt &&
+		echo "unfiltered" >b/rot.r &&
+		cat >.gitattributes <<-\EOF &&
+		*.txt text
+		*.r filter=upcase
+		EOF
+		git config filter.upcase.clean "tr a-z A-Z"
+	)
+'
+
+test_expect_success 'add with threads writes new blobs into a pack' '
+	test_when_finished "rm -rf threaded unthreaded" &&
+	cp -R many threaded &&
+	cp -R many unthreaded &&
+	GIT_TRACE2_EVENT="$(pwd)/trace2.txt" \
+		git -C threaded -c add.threads=4 add . &&
+	test_region add write_blobs trace2.txt &&
+	grep "\"key\":\"write_blobs/reused\",\"value\":\"[1-9]" trace2.txt &&
+	git -C unthreaded -c add.threads=1 add . &&
+
+	git -C threaded ls-files -s >expect &&
+	git -C unthreaded ls-files -s >actual &&
+	test_cmp expect actual &&
+
+	git -C threaded count-objects -v >counts &&
+	grep "^packs: 1" counts &&
+	git -C threaded fsck &&
+
+	git -C threaded cat-file blob :a/crlf.txt >crlf &&
+	printf "one\ntwo\n" >expect &&
+	test_cmp expect crlf &&
+	git -C threaded cat-file blob :b/rot.r >rot &&
+	echo UNFILTERED >expect &&
+	test_cmp expect rot
+'
+
+test_expect_success 'add --dry-run and -N with threads write no objects' '
+	test_when_finished "rm -rf threaded" &&
+	cp -R many threaded &&
+	git -C threaded -c add.threads=4 add --dry-run . &&
+	git -C threaded -c add.threads=4 add -N . &&
+	git -C threaded count-objects -v >counts &&
+	grep "^in-pack: 0" counts &&
+	grep "^packs: 0" counts
+'
+
+test_expect_success 'invalid add.threads' '
+	test_must_fail git -c add.threads=-1 add . 2>err &&
+	test_i18ngrep "invalid number of threads" err
+'
+
 test_expect_success CASE_INSENSITIVE_FS 'path is case-insensitive' '
 	path="$(pwd)/BLUB" &&
 	touch "$path" &&
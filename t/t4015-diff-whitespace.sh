@@ -2299,6 +2299,33 @@ test_expect_success 'compare mixed whitespace delta across moved blocks' '
 	test_cmp expected actual
 '
 
+test_expect_success 'move detection in a large diff with threads' '
+	mkdir moved-a moved-b &&
+	for i in $(test_seq 10)
+	do
+		j=$(($i % 10 + 1)) &&
+		test_seq 100 | sed "s/.*/first half of file $i, line &/" >first &&
+		test_seq 100 | sed "s/.*/second half of file $i, line &/" >second &&
+		test_seq 100 | sed -e "s/.*/second half of file $j, line &/" \
+			-e "/5\$/d" -e "/3\$/s/^/	/" >moved &&
+		cat first second >moved-a/file$i &&
+		cat first moved >moved-b/file$i || return 1
+	done &&
+	for opts in --color-moved=zebra --color-moved=dimmed-zebra \
+		"--color-moved=blocks --color-moved-ws=ignore-all-space" \
+		"--color-moved=zebra --color-moved-ws=allow-indentation-change"
+	do
+		test_expect_code 1 git -c diff.threads=1 diff --no-index \
+			--color $opts moved-a moved-b >expect &&
+		rm -f trace.event &&
+		test_expect_code 1 env GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+			git -c diff.threads=4 diff --no-index \
+			--color $opts moved-a moved-b >actual &&
+		test_cmp expect actual &&
+		grep "\"thread\":\"th[0-9]*:color-moved\"" trace.event || return 1
+	done
+'
+
 test_expect_success 'combine --ignore-blank-lines with --function-context' '
 	test_write_lines 1 "" 2 3 4 5 >a &&
 	test_write_lines 1    2 3 4   >b &&
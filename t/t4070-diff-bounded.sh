@@ -0,0 +1,74 @@
+#!/bin/sh
+
+test_description='bounded diff algorithm'
+
+TEST_PASSES_SANITIZE_LEAK=true
+. ./test-lib.sh
+. "$TEST_DIRECTORY"/lib-diff-alternative.sh
+
+test_diff_frobnitz "diff-algorithm=bounded"
+
+test_diff_unique "diff-algorithm=bounded"
+
+# Lines that all occur more than once, so that there are no unique
+# lines to anchor on.
+repeated_lines () {
+	awk -v n="$1" -v pattern="$2" "BEGIN {
+		len = length(pattern)
+		for (i = 0; i < n; i++)
+			print substr(pattern, i % len + 1, 1)
+	}"
+}
+
+test_expect_success 'ranges without unique lines go to Myers' '
+	repeated_lines 40 ab >small1 &&
+	repeated_lines 40 aab >small2 &&
+	test_expect_code 1 git diff --no-index --diff-algorithm=myers \
+		small1 small2 >expect &&
+	test_expect_code 1 git diff --no-index --diff-algorithm=bounded \
+		small1 small2 >actual 2>err &&
+	test_cmp expect actual &&
+	test_must_be_empty err
+'
+
+test_expect_success 'expensive ranges are coarsened with a warning' '
+	repeated_lines 3000 ab >large1 &&
+	repeated_lines 3000 aab >large2 &&
+	test_expect_code 1 git diff --no-index --diff-algorithm=bounded \
+		large1 large2 >output 2>err &&
+	grep "bounded diff algorithm ran out of budget for .large2." err &&
+	grep "^@@ -1,3000 +1,3000 @@" output &&
+	cp large2 expect &&
+	cp large1 large2 &&
+	git apply output &&
+	test_cmp expect large2
+'
+
+test_expect_success 'unique lines still anchor around expensive ranges' '
+	{
+		echo first && repeated_lines 3000 ab && echo middle &&
+		repeated_lines 10 ab && echo last
+	} >anchored1 &&
+	{
+		echo first && repeated_lines 3000 aab && echo middle &&
+		repeated_lines 10 ba && echo last
+	} >anchored2 &&
+	test_expect_code 1 git diff --no-index --diff-algorithm=bounded \
+		anchored1 anchored2 >output 2>err &&
+	grep "ran out of budget" err &&
+	grep "^ middle$" output
+'
+
+test_expect_success 'diff.algorithm=bounded' '
+	git init repo &&
+	repeated_lines 3000 ab >repo/file &&
+	git -C repo add file &&
+	git -C repo commit -m initial &&
+	repeated_lines 3000 aab >repo/file &&
+	git -C repo -c diff.algorithm=bounded diff >output 2>err &&
+	grep "ran out of budget for .file." err &&
+	git -C repo diff --histogram >output 2>err &&
+	test_must_be_empty err
+'
+
+test_done
@@ -0,0 +1,125 @@
+#!/bin/sh
+
+test_description='diff of large files with diff.streamThreshold'
+
+. ./test-lib.sh
+
+# numbered <count>: numbered lines, every 50th of which starts a "function"
+numbered () {
+	awk -v n="$1" "BEGIN {
+		for (i = 1; i <= n; i++)
+			if (i % 50 == 1)
+				print \"section\", i
+			else
+				print \"    line\", i
+	}"
+}
+
+test_expect_success 'setup' '
+	numbered 2000 >file &&
+	numbered 1000 >gone &&
+	git add file gone &&
+	git commit -m initial &&
+	awk "
+		NR % 97 == 0 { print \"    changed\", NR; next }
+		NR % 131 == 0 { next }
+		NR % 211 == 0 { print \"    inserted before\", NR }
+		{ print }
+	" file >file.new &&
+	mv file.new file &&
+	printf "no newline at the end" >>file &&
+	git rm -q gone &&
+	numbered 800 >added &&
+	git add file added &&
+	git commit -m changed
+'
+
+# Streaming reads files larger than 4k in windows of about 4k, which
+# hold all of the hunks above.
+for args in "" "-U0" "-U7" "--inter-hunk-context=5" "-w" "--histogram" \
+	"-R" "--color" "--stat -p"
+do
+	test_expect_success "streamed diff is the same ($args)" "
+		git diff $args HEAD~ HEAD >expect &&
+		git -c diff.streamThreshold=4k diff $args HEAD~ HEAD >actual &&
+		test_cmp expect actual
+	"
+done
+
+test_expect_success 'files that would be binary are streamed as text' '
+	git -c core.bigFileThreshold=100 diff HEAD~ HEAD -- file >binary &&
+	grep "^Binary files a/file and b/file differ" binary &&
+	git diff HEAD~ HEAD -- file >expect &&
+	git -c core.bigFileThreshold=100 -c diff.streamThreshold=4k \
+		diff HEAD~ HEAD -- file >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'working tree files are streamed' '
+	git checkout HEAD~ -- file &&
+	git reset -q &&
+	git diff >expect &&
+	git -c core.bigFileThreshold=100 -c diff.streamThreshold=4k \
+		diff >actual &&
+	test_cmp expect actual &&
+	git checkout HEAD -- file
+'
+
+test_expect_success 'changes larger than the window are split, but apply' '
+	numbered 500 >split1 &&
+	numbered 500 | sed "200,300s/line/replaced/" >split2 &&
+	test_expect_code 1 git diff --no-index split1 split2 >normal &&
+	test_expect_code 1 git -c diff.streamThreshold=1k \
+		diff --no-index split1 split2 >patch &&
+	test $(grep -c "^@@" normal) = 1 &&
+	test $(grep -c "^@@" patch) -gt 1 &&
+	sed -e "s|/split2|/split1|g" patch >patch.fixed &&
+	git apply --unidiff-zero patch.fixed &&
+	test_cmp split2 split1
+'
+
+test_expect_success 'lines longer than the window' '
+	{
+		numbered 100 &&
+		printf "%04000d\n" 1 &&
+		numbered 100
+	} >long1 &&
+	{
+		numbered 100 &&
+		printf "%04000d\n" 2 &&
+		numbered 100
+	} >long2 &&
+	test_expect_code 1 git diff --no-index long1 long2 >expect &&
+	test_expect_code 1 git -c diff.streamThreshold=1k \
+		diff --no-index long1 long2 >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'binary files are detected in the first window' '
+	{
+		printf "bin\0ary\n" &&
+		numbered 1000
+	} >binary &&
+	git add binary &&
+	git commit -m binary &&
+	numbered 10 >>binary &&
+	git -c diff.streamThreshold=4k diff >actual &&
+	grep "^Binary files a/binary and b/binary differ" actual &&
+	git -c diff.streamThreshold=4k diff --text >actual &&
+	grep "^+    line 10$" actual &&
+	git checkout binary
+'
+
+test_expect_success 'log -p streams packed blobs while diffs are prefetched' '
+	git repack -q -adf --window=0 &&
+	git -c log.threads=1 -c core.bigFileThreshold=1k \
+		-c diff.streamThreshold=4k log -p >expect &&
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git -c log.threads=4 -c core.bigFileThreshold=1k \
+		-c diff.streamThreshold=4k log -p >actual &&
+	test_cmp expect actual &&
+	grep "\"key\":\"prefetch/threads\"" trace.event
+'
+
+test_done
@@ -2218,4 +2218,50 @@ test_expect_success 'log --invert-grep --grep --author' '
 	test_cmp expect actual
 '
 
+test_expect_success 'log.threads: diffs computed ahead match serial output' '
+	git checkout --orphan threads &&
+	git rm -rf . &&
+	for i in 1 2 3 4 5 6 7 8
+	do
+		mkdir -p dir$i &&
+		test_seq $i 20 >dir$i/file &&
+		test_seq 1 $i >top &&
+		git add dir$i top &&
+		test_tick &&
+		git commit -m "threads $i" || return 1
+	done &&
+	git mv dir1/file moved &&
+	test_tick &&
+	git commit -m "rename" &&
+	git checkout -b threads-side HEAD~3 &&
+	test_commit threads-side-file &&
+	git checkout threads &&
+	test_tick &&
+	git merge -m merge threads-side &&
+
+	for args in "-p" "--stat" "--raw -M" "-p -R" "-p -2" "-p --reverse" \
+		    "-p --relative=dir2" "-p -m --first-parent" "-p -- top" \
+		    "--name-status --no-merges" "-p --skip=2 -3"
+	do
+		git -c log.threads=1 log $args threads >expect &&
+		git -c log.threads=3 log $args threads >actual &&
+		test_cmp expect actual || return 1
+	done
+'
+
+test_expect_success 'log.threads: only used where diffs can be computed ahead' '
+	GIT_TRACE2_EVENT="$(pwd)/trace-p" git -c log.threads=3 log -p threads &&
+	grep "\"key\":\"prefetch/threads\",\"value\":\"2\"" trace-p &&
+	GIT_TRACE2_EVENT="$(pwd)/trace-graph" \
+		git -c log.threads=3 log -p --graph threads &&
+	! grep prefetch/threads trace-graph &&
+	GIT_TRACE2_EVENT="$(pwd)/trace-serial" \
+		git -c log.threads=1 log -p threads &&
+	! grep prefetch/threads trace-serial &&
+	GIT_TRACE2_EVENT="$(pwd)/trace-default" git log -p threads &&
+	! grep prefetch/threads trace-default &&
+	test_must_fail git -c log.threads=-1 log -1 2>err &&
+	test_i18ngrep "invalid number of threads" err
+'
+
 test_done
@@ -223,4 +223,153 @@ test_expect_success 'log -S --pickaxe-regex looks into binary files' '
 	test_cmp log full-log
 '
 
+test_expect_success 'setup commits with many files' '
+	git init GS-many &&
+	(
+		cd GS-many &&
+		for i in $(test_seq 80)
+		do
+			test_write_lines "file $i" >file$i || return 1
+		done &&
+		printf "needle\0" >binary &&
+		test_write_lines needle >attr &&
+		echo "attr -diff" >.gitattributes &&
+		git add . &&
+		git commit -m initial &&
+		for i in $(test_seq 20)
+		do
+			test_write_lines "file $i" "needle $i" >file$i || return 1
+		done &&
+		printf "more needle\0" >binary &&
+		test_write_lines more needle >attr &&
+		git commit -a -m second
+	)
+'
+
+test_expect_success 'log -G and -S search many files with threads' '
+	for opts in -Sneedle -Gneedle "-a -Gneedle" "--pickaxe-regex -Sne.dle" \
+		"--pickaxe-all -Sneedle"
+	do
+		git -C GS-many -c diff.threads=1 log --root \
+			--format=%s --name-only $opts >expect &&
+		rm -f trace.event &&
+		GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+			git -C GS-many -c diff.threads=4 log --root \
+			--format=%s --name-only $opts >actual &&
+		test_cmp expect actual &&
+		grep "\"thread\":\"th[0-9]*:pickaxe\"" trace.event || return 1
+	done
+'
+
+test_expect_success 'log -S searches with threads while diffs are prefetched' '
+	git init GS-prefetch &&
+	(
+		cd GS-prefetch &&
+		for c in $(test_seq 6)
+		do
+			for i in $(test_seq 40)
+			do
+				test_write_lines "file $i" "commit $c" >file$i &&
+				if test $((i % 7)) = $c
+				then
+					echo "needle $c" >>file$i
+				fi || return 1
+			done &&
+			git add . &&
+			git commit -q -m "commit $c" || return 1
+		done
+	) &&
+	for opts in -Sneedle -Gneedle
+	do
+		git -C GS-prefetch -c log.threads=1 -c diff.threads=1 log \
+			--format=%s --name-only $opts >expect &&
+		rm -f trace.event &&
+		GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+			git -C GS-prefetch -c log.threads=4 -c diff.threads=4 \
+			log --format=%s --name-only $opts >actual &&
+		test_cmp expect actual &&
+		grep "\"thread\":\"th[0-9]*:pickaxe\"" trace.event &&
+		grep "\"key\":\"prefetch/threads\"" trace.event || return 1
+	done
+'
+
+test_expect_success 'setup a file that changes in every commit' '
+	git init GS-linear &&
+	for i in $(test_seq 10)
+	do
+		test_write_lines "line $i" "needle" >GS-linear/file &&
+		test_write_lines "$i" >GS-linear/other &&
+		git -C GS-linear add . &&
+		git -C GS-linear commit -q -m "commit $i" || return 1
+	done &&
+	test_write_lines needle needle >GS-linear/file &&
+	git -C GS-linear commit -q -a -m "two needles"
+'
+
+test_expect_success 'log -S and -G search each blob once' '
+	for opts in -Sneedle -Gneedle "--pickaxe-regex -Sne.dle" -Gother
+	do
+		rm -f trace.event &&
+		GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+			git -C GS-linear log --format=%s $opts >actual &&
+		grep "\"key\":\"cache/searched\",\"value\":\"21\"" \
+			trace.event &&
+		grep "\"key\":\"cache/hits\",\"value\":\"19\"" \
+			trace.event || return 1
+	done &&
+	test_write_lines "two needles" "commit 1" >expect &&
+	git -C GS-linear log --format=%s -Sneedle >actual &&
+	test_cmp expect actual &&
+	git -C GS-linear log --format=%s -Gneedle >actual &&
+	test_cmp expect actual &&
+	git -C GS-linear log --format=%s -Gother >actual &&
+	test_must_be_empty actual
+'
+
+test_expect_success 'copies of the diff options share the cache' '
+	git init GS-merges &&
+	test_commit -C GS-merges base &&
+	for i in 1 2 3
+	do
+		git -C GS-merges checkout -q -b side$i base &&
+		test_write_lines "side $i" needle >GS-merges/side$i &&
+		git -C GS-merges add side$i &&
+		git -C GS-merges commit -q -m "side $i" &&
+		git -C GS-merges checkout -q - &&
+		test_write_lines "main $i" needle >GS-merges/main$i &&
+		git -C GS-merges add main$i &&
+		git -C GS-merges commit -q -m "main $i" &&
+		git -C GS-merges merge -q -m "merge $i" side$i || return 1
+	done &&
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git -C GS-merges log -c -p --format=%s -Sneedle >actual &&
+	grep "^side 3$" actual &&
+	grep "\"key\":\"cache/searched\"" trace.event >searched &&
+	test_line_count = 1 searched &&
+	git -C GS-merges diff -Sneedle HEAD base side1 -- >actual &&
+	grep "^diff --cc main1" actual &&
+	git -C GS-merges format-patch --stdout --cover-letter \
+		-Sneedle base..side3 >actual &&
+	grep "^Subject: \[PATCH 1/1\] side 3" actual
+'
+
+test_expect_success 'diff.pickaxeCache remembers what was searched' '
+	git -C GS-linear -c diff.pickaxeCache=true log --format=%s \
+		-Sneedle >expect &&
+	git -C GS-linear for-each-ref refs/notes/pickaxe >refs &&
+	test_line_count = 1 refs &&
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git -C GS-linear -c diff.pickaxeCache=true log --format=%s \
+		-Sneedle >actual &&
+	test_cmp expect actual &&
+	grep "\"key\":\"cache/searched\",\"value\":\"0\"" trace.event &&
+	git -C GS-linear -c diff.pickaxeCache=true log --format=%s \
+		-Gneedle >actual &&
+	test_cmp expect actual &&
+	git -C GS-linear for-each-ref refs/notes/pickaxe >refs &&
+	test_line_count = 2 refs
+'
+
 test_done
@@ -121,8 +121,10 @@ test_expect_success 'git log with --walk-reflogs does not use Bloom filters' '
 	test_bloom_filters_not_used "--walk-reflogs -- A"
 '
 
-test_expect_success 'git log -- multiple path specs does not use Bloom filters' '
-	test_bloom_filters_not_used "-- file4 A/file1"
+test_expect_success 'git log -- multiple path specs uses Bloom filters' '
+	test_bloom_filters_used "-- file4 A/file1" &&
+	test_bloom_filters_used "-- A/B/C A/file1 file_to_be_deleted" &&
+	test_bloom_filters_used "--full-history -- file4 A/B"
 '
 
 test_expect_success 'git log -- "." pathspec at root does not use Bloom filters' '
@@ -134,9 +136,90 @@ test_expect_success 'git log with wildcard that resolves to a single path uses B
 	test_bloom_filters_used "-- *renamed"
 '
 
-test_expect_success 'git log with wildcard that resolves to a multiple paths does not uses Bloom filters' '
-	test_bloom_filters_not_used "-- *" &&
-	test_bloom_filters_not_used "-- file*"
+test_expect_success 'git log with wildcard that resolves to a multiple paths uses Bloom filters' '
+	test_bloom_filters_used "-- *" &&
+	test_bloom_filters_used "-- file*"
+'
+
+test_expect_success 'git log with a glob under a directory uses Bloom filters' '
+	test_bloom_filters_used "-- A/*" &&
+	test_bloom_filters_used "-- :(glob)A/B/file*" &&
+	test_bloom_filters_used "-- A/B/C/*3 file4" &&
+	test_bloom_filters_used "-- :(glob)A/**/file3"
+'
+
+test_expect_success 'git log with a glob at the top level does not use Bloom filters' '
+	test_bloom_filters_not_used "-- :(glob)*" &&
+	test_bloom_filters_not_used "-- :(glob)file*" &&
+	test_bloom_filters_not_used "-- A :(glob)*4"
+'
+
+test_expect_success 'git log with an icase pathspec does not use Bloom filters' '
+	test_bloom_filters_not_used "-- :(icase)a/file1"
+'
+
+test_expect_success 'git log --follow uses Bloom filters to skip tree diffs' '
+	setup "--follow -- file5_renamed" &&
+	grep "statistics:{\"filter_not_present\":0,\"maybe\":[0-9]*,\"definitely_not\":[1-9]" \
+		"$TRASH_DIRECTORY/trace.perf" &&
+	test_cmp log_wo_bloom log_w_bloom &&
+	setup "--follow --name-status -- file5_renamed" &&
+	test_cmp log_wo_bloom log_w_bloom &&
+	setup "--follow -p -- A/B/C/file3" &&
+	test_cmp log_wo_bloom log_w_bloom
+'
+
+test_expect_success 'git log -L uses Bloom filters' '
+	setup "-L1,1:A/B/C/file3" &&
+	grep "statistics:{\"filter_not_present\":0,\"maybe\":[0-9]*,\"definitely_not\":[1-9]" \
+		"$TRASH_DIRECTORY/trace.perf" &&
+	test_cmp log_wo_bloom log_w_bloom &&
+	setup "-L1,1:A/file1 -L1,1:file4" &&
+	test_cmp log_wo_bloom log_w_bloom
+'
+
+test_expect_success 'setup - repo with a renamed file' '
+	git init -b main renames &&
+	(
+		cd renames &&
+		mkdir dir &&
+		test_write_lines 1 2 3 4 5 6 7 8 9 >dir/old &&
+		test_commit other-1 other &&
+		git add dir/old &&
+		git commit -m "add old" &&
+		test_commit other-2 other &&
+		git mv dir/old new &&
+		git commit -m "rename old to new" &&
+		test_commit other-3 other &&
+		test_write_lines 1 2 3 4 5 6 7 8 9 10 >new &&
+		git commit -a -m "change new" &&
+		test_commit other-4 other &&
+		git commit-graph write --reachable --changed-paths
+	)
+'
+
+test_expect_success 'git log -L follows renames with Bloom filters' '
+	(
+		cd renames &&
+		git -c core.commitGraph=false log --format=%s -L1,10:new >../log_wo_bloom &&
+		GIT_TRACE2_PERF="$TRASH_DIRECTORY/trace-renames.perf" \
+			git -c core.commitGraph=true log --format=%s -L1,10:new >../log_w_bloom
+	) &&
+	test_cmp log_wo_bloom log_w_bloom &&
+	grep "^add old" log_w_bloom &&
+	grep "statistics:{\"filter_not_present\":0,\"maybe\":3,\"definitely_not\":3" \
+		"$TRASH_DIRECTORY/trace-renames.perf"
+'
+
+test_expect_success 'git blame follows renames with Bloom filters' '
+	(
+		cd renames &&
+		git -c core.commitGraph=false blame new >../blame_wo_bloom &&
+		GIT_TRACE2_PERF="$TRASH_DIRECTORY/trace-blame.perf" \
+			git -c core.commitGraph=true blame new >../blame_w_bloom
+	) &&
+	test_cmp blame_wo_bloom blame_w_bloom &&
+	grep "bloom/response-no:3" "$TRASH_DIRECTORY/trace-blame.perf"
 '
 
 test_expect_success 'setup - add commit-graph to the chain without Bloom filters' '
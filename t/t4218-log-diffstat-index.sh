@@ -0,0 +1,112 @@
+#!/bin/sh
+
+test_description='git log with the diffstat index'
+GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME=main
+export GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME
+
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	mkdir A A/B &&
+	test_commit c1 A/file1 &&
+	test_commit c2 A/B/file2 &&
+	test_seq 1 20 >A/file1 &&
+	git add A/file1 &&
+	git commit -m "grow file1" &&
+	test_commit c3 A/file1 &&
+	printf "\0binary" >bin &&
+	git add bin &&
+	git commit -m "binary" &&
+	test_ln_s_add A/file1 link &&
+	git commit -m "symlink" &&
+	git checkout -b side HEAD~2 &&
+	test_commit side-1 file4 &&
+	git checkout main &&
+	git merge side &&
+	git mv A/B/file2 A/file2 &&
+	git commit -m "rename" &&
+	git rm file4 &&
+	test_seq 1 30 >A/file3 &&
+	git add A/file3 &&
+	git commit -m "delete and add" &&
+	chmod +x A/file3 &&
+	git add A/file3 &&
+	git commit -m "mode change" &&
+	git commit --allow-empty -m "empty" &&
+	git maintenance run --task=diffstat-index &&
+	test_path_is_file .git/objects/info/diffstat-index
+'
+
+log_with_and_without_index () {
+	git log "$@" >actual &&
+	git -c core.diffstatIndex=false log "$@" >expect &&
+	test_cmp expect actual
+}
+
+for opts in "--stat" "--numstat" "--shortstat" "--raw" "--name-only" \
+	    "--name-status" "--stat --summary" "--numstat -R" "--raw --root" \
+	    "--stat --no-renames" "--stat -M" "--stat -C" "--numstat -w" \
+	    "--stat --first-parent -m" "--numstat --relative=A" \
+	    "--stat -p" "--dirstat"
+do
+	test_expect_success "log $opts" '
+		log_with_and_without_index $opts
+	'
+done
+
+test_expect_success 'log with pathspecs' '
+	log_with_and_without_index --stat -- A &&
+	log_with_and_without_index --numstat -- "A/*2" &&
+	log_with_and_without_index --stat -M -- A/file3 file4 &&
+	log_with_and_without_index --stat --full-diff -- bin
+'
+
+test_expect_success 'show and diff-tree' '
+	git show --stat HEAD~2 >actual &&
+	git -c core.diffstatIndex=false show --stat HEAD~2 >expect &&
+	test_cmp expect actual &&
+	git rev-list HEAD | git diff-tree --stdin --numstat >actual &&
+	git rev-list HEAD |
+		git -c core.diffstatIndex=false diff-tree --stdin --numstat >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'line counts come from the index' '
+	test_when_finished "rm -f .git/info/attributes" &&
+	mkdir -p .git/info &&
+	echo "file1 binary" >.git/info/attributes &&
+	git log --numstat -1 c3 >with &&
+	git -c core.diffstatIndex=false log --numstat -1 c3 >without &&
+	grep "^1	20	A/file1" with &&
+	grep "^-	-	A/file1" without
+'
+
+test_expect_success 'commits not in the index are diffed' '
+	test_commit c4 A/file1 &&
+	log_with_and_without_index --stat &&
+	git log --numstat -1 -- A/file1 >actual &&
+	grep "^1	1	A/file1" actual
+'
+
+test_expect_success 'the index is extended incrementally' '
+	git maintenance run --task=diffstat-index &&
+	log_with_and_without_index --stat &&
+	log_with_and_without_index --raw --numstat
+'
+
+test_expect_success 'a different parent ignores the index' '
+	test_when_finished "git replace -d HEAD" &&
+	git replace --graft HEAD HEAD~3 &&
+	log_with_and_without_index --numstat -2
+'
+
+test_expect_success 'a different tree ignores the index' '
+	test_when_finished "git replace -d HEAD~1" &&
+	tree=$(git rev-parse HEAD~3^{tree}) &&
+	replacement=$(git commit-tree -p HEAD~2 -m replaced $tree) &&
+	git replace HEAD~1 $replacement &&
+	log_with_and_without_index --stat -2 &&
+	log_with_and_without_index --raw -2
+'
+
+test_done
@@ -277,6 +277,35 @@ test_expect_success 'truncated bitmap fails gracefully (cache)' '
 	test_i18ngrep corrupted.bitmap.index stderr
 '
 
+test_expect_success 'repack writes commit attributes' '
+	git config pack.writeBitmapCommitAttributes true &&
+	git repack -ad &&
+	blob=$(git rev-parse tagged-blob)
+'
+
+rev_list_tests 'bitmap with commit attributes'
+
+test_expect_success 'commit attributes decide on merges' '
+	git rev-list --count --no-merges --all >expect &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git rev-list --use-bitmap-index --count --no-merges --all >actual &&
+	test_cmp expect actual &&
+	grep "\"key\":\"commit_limits/checked\",\"value\":\"0\"" trace
+'
+
+test_expect_success 'commit attributes narrow down dates' '
+	rm -f trace &&
+	mid=$(git log -1 --format=%ct second~50) &&
+	git rev-list --count --until=$mid --all >expect &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git rev-list --use-bitmap-index --count --until=$mid --all >actual &&
+	test_cmp expect actual &&
+	sed -n "s/.*\"key\":\"commit_limits\/checked\",\"value\":\"\([0-9]*\)\".*/\1/p" \
+		trace >checked &&
+	test $(cat checked) -lt $(git rev-list --count --all) &&
+	git config --unset pack.writeBitmapCommitAttributes
+'
+
 # Create a state of history with these properties:
 #
 #  - refs that allow a client to fetch some new history, while sharing some old
@@ -0,0 +1,144 @@
+#!/bin/sh
+
+test_description='test bitmap fetch negotiator'
+GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME=main
+export GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME
+
+. ./test-lib.sh
+
+. "$TEST_DIRECTORY"/lib-fetch-negotiator.sh
+
+test_expect_success 'skip distance doubles' '
+	git init server &&
+	test_commit -C server to_fetch &&
+
+	git init client &&
+	for i in $(test_seq 16)
+	do
+		test_commit -C client c$i || return 1
+	done &&
+
+	# We send: "c16" (skip 1) "c14" (skip 3) "c10" (skip 7) "c2". "c1"
+	# has no parent, so it is sent even though it would be skipped.
+	# Restrict the tips to the branch, as tips are never skipped.
+	test_config -C client fetch.negotiationalgorithm bitmap &&
+	trace_fetch client "$(pwd)/server" --negotiation-tip=main &&
+	have_sent c16 c14 c10 c2 c1 &&
+	have_not_sent c15 c13 c12 c11 c9 c8 c7 c6 c5 c4 c3
+'
+
+test_expect_success 'walk in generation order' '
+	rm -rf server client trace &&
+	git init server &&
+	test_commit -C server to_fetch &&
+
+	git init client &&
+
+	# 2 regular commits
+	test_tick=2000000000 &&
+	test_commit -C client c1 &&
+	test_commit -C client c2 &&
+
+	# 4 old commits
+	test_tick=1000000000 &&
+	git -C client checkout c1 &&
+	test_commit -C client old1 &&
+	test_commit -C client old2 &&
+	test_commit -C client old3 &&
+	test_commit -C client old4 &&
+	git -C client commit-graph write --reachable &&
+
+	# Unlike the skipping negotiator, we do not pop "c1" before the old
+	# commits, so "old1" is skipped as usual and "c1" is sent only
+	# because it has no parent.
+	test_config -C client fetch.negotiationalgorithm bitmap &&
+	trace_fetch client "$(pwd)/server" \
+		--negotiation-tip=main --negotiation-tip=HEAD &&
+	have_sent c2 old4 old2 c1 &&
+	have_not_sent old3 old1
+'
+
+test_expect_success 'mark commits reachable from ACKed commits as common with bitmaps' '
+	rm -rf server client trace &&
+	git init server &&
+	test_commit -C server to_fetch &&
+
+	git init client &&
+	for i in $(test_seq 8)
+	do
+		echo "reset refs/heads/b$i" &&
+		for j in $(test_seq 0 99)
+		do
+			cat <<-EOF || return 1
+			commit refs/heads/b$i
+			committer C O Mitter <committer@example.com> $((1000000000 + 100 * j + i)) +0000
+			data <<EOM
+			b$i.c$j
+			EOM
+			M 644 inline b$i.t
+			data <<EOM
+			$j
+			EOM
+
+			EOF
+		done
+	done >input &&
+	git -C client fast-import <input &&
+
+	# A merge that is popped early and queues "b1~90" long before the
+	# walk down "b1" gets there.
+	git -C client checkout -b merge b2 &&
+	git -C client merge --allow-unrelated-histories -m merge b1~90 &&
+	git -C client repack -adb &&
+	git -C client commit-graph write --reachable &&
+
+	git -C server fetch --no-tags "$(pwd)/client" b1:refs/heads/b1 &&
+	git -C server checkout b1 &&
+	test_commit -C server commit-on-b1 &&
+
+	test_config -C client fetch.negotiationalgorithm bitmap &&
+	(
+		GIT_TEST_PROTOCOL_VERSION=0 &&
+		export GIT_TEST_PROTOCOL_VERSION &&
+		GIT_TRACE2_EVENT="$(pwd)/trace2" &&
+		export GIT_TRACE2_EVENT &&
+		trace_fetch client "$(pwd)/server" to_fetch
+	) &&
+	grep "fetch< ACK $(git -C client rev-parse b1) common" trace &&
+	grep "\"key\":\"bitmap/marked-common\",\"value\":\"[1-9]" trace2 &&
+	have_not_sent b1~90 b1~91 b1~99
+'
+
+test_expect_success 'server answers whether to give up with bitmaps' '
+	rm -rf server client trace trace2 &&
+	git init server &&
+	for i in $(test_seq 5)
+	do
+		test_commit -C server c$i || return 1
+	done &&
+	git clone server client &&
+	test_commit -C server new &&
+	git -C server repack -adb &&
+
+	GIT_TRACE2_EVENT="$(pwd)/trace2" git -C client fetch origin &&
+	grep "\"key\":\"bitmap/wants-answered\",\"value\":\"1\"" trace2 &&
+	git -C client rev-parse origin/main >actual &&
+	git -C server rev-parse main >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'server does not use bitmaps with pack.useBitmaps=false' '
+	rm -rf client trace2 &&
+	git clone server client &&
+	git -C client reset --hard HEAD~2 &&
+	git -C client update-ref -d refs/remotes/origin/main &&
+	test_config -C server pack.useBitmaps false &&
+
+	GIT_TRACE2_EVENT="$(pwd)/trace2" git -C client fetch origin &&
+	! grep "bitmap/wants-answered" trace2 &&
+	git -C client rev-parse origin/main >actual &&
+	git -C server rev-parse main >expect &&
+	test_cmp expect actual
+'
+
+test_done
@@ -442,7 +442,51 @@ l0
 root
 EOF
 
-#
-#
+test_expect_success 'write a commit-graph with a reachability index' '
+	git commit-graph write --reachable --reachability-index
+'
+
+# Check that with commitGraph.useTopoOrder, "git rev-list $*" lists the
+# same commits as without it, each before all of its parents, and that
+# the walk needed no indegrees to do so.
+test_graph_topo_order () {
+	git rev-list "$@" | sort >expect &&
+	rm -f trace.perf &&
+	GIT_TRACE2_PERF="$(pwd)/trace.perf" git -c commitGraph.useTopoOrder=true \
+		rev-list --parents "$@" >actual.parents &&
+	grep "statistics:{\"count_explore_walked\":0,\"count_indegree_walked\":0," trace.perf &&
+	awk "{ seen[\$1] = 1; for (i = 2; i <= NF; i++) if (seen[\$i]) print }" \
+		actual.parents >out-of-order &&
+	test_must_be_empty out-of-order &&
+	cut -d" " -f1 actual.parents | sort >actual &&
+	test_cmp expect actual
+}
+
+for args in "l5" "a4 l3" "--all" "l5 ^a4" "a3 ^b3" "m2 ^m1" \
+	    "--first-parent m2" "--date-order --all" "--boundary l5 ^c2"
+do
+	test_expect_success "commitGraph.useTopoOrder: rev-list --topo-order $args" "
+		test_graph_topo_order --topo-order $args
+	"
+done
+
+test_expect_success 'commitGraph.useTopoOrder lists newer commits first' '
+	git -c commitGraph.useTopoOrder=true rev-list --topo-order m1 m2 >actual &&
+	test_write_lines $(git rev-parse m2 m1) >expect &&
+	head -n 2 actual >actual.head &&
+	test_cmp expect actual.head
+'
+
+test_expect_success 'commitGraph.useTopoOrder needs all tips in the commit-graph' '
+	test_when_finished "git update-ref -d refs/heads/not-in-graph" &&
+	git update-ref refs/heads/not-in-graph \
+		$(git commit-tree -p l5 -m not-in-graph $(git rev-parse l5^{tree})) &&
+	git rev-list --topo-order not-in-graph >expect &&
+	rm -f trace.perf &&
+	GIT_TRACE2_PERF="$(pwd)/trace.perf" git -c commitGraph.useTopoOrder=true \
+		rev-list --topo-order not-in-graph >actual &&
+	! grep "statistics:{\"count_explore_walked\":0," trace.perf &&
+	test_cmp expect actual
+'
 
 test_done
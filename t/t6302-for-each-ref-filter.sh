@@ -474,4 +474,71 @@ test_expect_success 'validate worktree atom' '
 	test_cmp expect actual
 '
 
+
+test_expect_success 'setup history for reachability bitmaps' '
+	git init -b main bitmaps &&
+	(
+		cd bitmaps &&
+		test_commit_bulk --id=base 40 &&
+		for b in $(test_seq 1 8)
+		do
+			git checkout -b branch-$b main~$((b * 4)) &&
+			test_commit_bulk --id=b$b 3 &&
+			git tag tag-$b || return 1
+		done &&
+		git checkout main &&
+		git merge -m merge branch-2 &&
+		git repack -adb &&
+		ls .git/objects/pack/*.bitmap >bitmap &&
+		test_line_count = 1 bitmap &&
+
+		# history that is not covered by the bitmaps
+		git checkout -b unbitmapped branch-5 &&
+		test_commit_bulk --id=loose 3 &&
+		git checkout -b unbitmapped-merged main~10 &&
+		git merge -m merge-loose unbitmapped
+	)
+'
+
+for filter in \
+	"--contains main~5" \
+	"--contains branch-3~1" \
+	"--contains main~10 --no-contains branch-2" \
+	"--no-contains tag-7" \
+	"--contains unbitmapped~1" \
+	"--merged main" \
+	"--merged unbitmapped-merged" \
+	"--no-merged branch-4" \
+	"--merged main --no-merged tag-1" \
+	"--contains main~20 --merged unbitmapped-merged"
+do
+	test_expect_success "filter with bitmaps: $filter" "
+		(
+			cd bitmaps &&
+			mv \$(cat bitmap) saved.bitmap &&
+			git for-each-ref --format='%(refname)' $filter >expect &&
+			mv saved.bitmap \$(cat bitmap) &&
+			git for-each-ref --format='%(refname)' $filter >actual &&
+			test_cmp expect actual
+		)
+	"
+done
+
+test_expect_success 'bitmaps are used for --contains and --merged' '
+	(
+		cd bitmaps &&
+		GIT_TRACE2_EVENT="$(pwd)/contains.trace" \
+			git branch --contains main~5 >/dev/null &&
+		grep "\"key\":\"contains_bitmap\"" contains.trace &&
+		GIT_TRACE2_EVENT="$(pwd)/merged.trace" \
+			git tag --merged main >/dev/null &&
+		grep "\"region_enter\".*\"reach_filter_bitmap\"" merged.trace &&
+
+		# a commit outside of the bitmapped pack cannot use them
+		GIT_TRACE2_EVENT="$(pwd)/loose.trace" \
+			git branch --contains unbitmapped~1 >/dev/null &&
+		! grep "\"key\":\"contains_bitmap\"" loose.trace
+	)
+'
+
 test_done
@@ -58,11 +58,20 @@ test_expect_success 'setup' '
 	git -c commitGraph.generationVersion=1 commit-graph write --reachable &&
 	mv .git/objects/info/commit-graph commit-graph-no-gdat &&
 	chmod u+w commit-graph-no-gdat &&
+	git commit-graph write --reachable --reachability-index &&
+	mv .git/objects/info/commit-graph commit-graph-reach &&
+	chmod u+w commit-graph-reach &&
+	git show-ref -s commit-5-5 |
+		git commit-graph write --stdin-commits --split --reachability-index &&
+	git commit-graph write --reachable --split=no-merge &&
+	test_line_count = 2 .git/objects/info/commit-graphs/commit-graph-chain &&
+	mv .git/objects/info/commit-graphs commit-graphs-reach-split &&
 	git config core.commitGraph true
 '
 
 run_all_modes () {
-	test_when_finished rm -rf .git/objects/info/commit-graph &&
+	test_when_finished rm -rf .git/objects/info/commit-graph \
+		.git/objects/info/commit-graphs &&
 	"$@" <input >actual &&
 	test_cmp expect actual &&
 	cp commit-graph-full .git/objects/info/commit-graph &&
@@ -73,7 +82,15 @@ run_all_modes () {
 	test_cmp expect actual &&
 	cp commit-graph-no-gdat .git/objects/info/commit-graph &&
 	"$@" <input >actual &&
-	test_cmp expect actual
+	test_cmp expect actual &&
+	cp commit-graph-reach .git/objects/info/commit-graph &&
+	"$@" <input >actual &&
+	test_cmp expect actual &&
+	rm .git/objects/info/commit-graph &&
+	cp -R commit-graphs-reach-split .git/objects/info/commit-graphs &&
+	"$@" <input >actual &&
+	test_cmp expect actual &&
+	rm -rf .git/objects/info/commit-graphs
 }
 
 test_all_modes () {
@@ -443,4 +460,155 @@ test_expect_success 'get_reachable_subset:none' '
 	test_all_modes get_reachable_subset
 '
 
+
+# In the grid, commit-x-y can reach exactly the x * y commits
+# commit-i-j with i <= x and j <= y.
+grid_ahead_behind () {
+	tip_x=$1 tip_y=$2 base_x=$3 base_y=$4 &&
+	min_x=$(( tip_x < base_x ? tip_x : base_x )) &&
+	min_y=$(( tip_y < base_y ? tip_y : base_y )) &&
+	echo "$(( tip_x * tip_y - min_x * min_y )) $(( base_x * base_y - min_x * min_y ))"
+}
+
+test_expect_success 'in_merge_bases_matrix' '
+	for x in $(test_seq 1 10)
+	do
+		for y in $(test_seq 1 10)
+		do
+			echo "X:commit-$x-$y" || return 1
+		done || return 1
+	done >input &&
+	for y in 1 4 7 10
+	do
+		for x in 1 4 7 10
+		do
+			echo "Y:commit-$x-$y" || return 1
+		done || return 1
+	done >>input &&
+	echo "in_merge_bases_matrix(X,Y):" >expect &&
+	for x in $(test_seq 1 10)
+	do
+		for y in $(test_seq 1 10)
+		do
+			for y2 in 1 4 7 10
+			do
+				for x2 in 1 4 7 10
+				do
+					if test $x2 -le $x && test $y2 -le $y
+					then
+						printf 1
+					else
+						printf 0
+					fi || return 1
+				done || return 1
+			done &&
+			echo || return 1
+		done || return 1
+	done >>expect &&
+	test_all_modes in_merge_bases_matrix
+'
+
+test_expect_success 'reachability index is written, kept and verified' '
+	test_when_finished rm -rf .git/objects/info/commit-graph &&
+	git commit-graph write --reachable --reachability-index &&
+	test-tool read-graph >out &&
+	grep reachability_index out &&
+	git commit-graph verify &&
+	git commit-graph write --reachable &&
+	test-tool read-graph >out &&
+	grep reachability_index out &&
+	git commit-graph write --reachable --no-reachability-index &&
+	test-tool read-graph >out &&
+	! grep reachability_index out
+'
+
+test_expect_success 'merge-base --is-ancestor with reachability index' '
+	test_when_finished rm -rf .git/objects/info/commit-graph &&
+	cp commit-graph-reach .git/objects/info/commit-graph &&
+	git merge-base --is-ancestor commit-2-3 commit-6-8 &&
+	git merge-base --is-ancestor commit-1-1 commit-1-10 &&
+	test_must_fail git merge-base --is-ancestor commit-2-9 commit-6-8 &&
+	test_must_fail git merge-base --is-ancestor commit-7-1 commit-6-8 &&
+	test_must_fail git -c commitGraph.readReachabilityIndex=false \
+		merge-base --is-ancestor commit-7-1 commit-6-8
+'
+
+test_expect_success 'ahead_behind' '
+	cat >input <<-\EOF &&
+	X:commit-1-1
+	X:commit-9-2
+	X:commit-5-7
+	X:tag-3-10
+	Y:commit-5-5
+	Y:commit-10-1
+	EOF
+	{
+		echo "ahead_behind(X,Y):" &&
+		for tip in "1 1" "9 2" "5 7" "3 10"
+		do
+			grid_ahead_behind $tip 5 5 &&
+			grid_ahead_behind $tip 10 1 || return 1
+		done
+	} >expect &&
+	test_all_modes ahead_behind
+'
+
+test_expect_success 'ahead_behind: matches rev-list --left-right' '
+	cat >input <<-\EOF &&
+	X:commit-7-3
+	X:commit-2-9
+	Y:commit-4-6
+	EOF
+	{
+		echo "ahead_behind(X,Y):" &&
+		git rev-list --count --left-right commit-7-3...commit-4-6 &&
+		git rev-list --count --left-right commit-2-9...commit-4-6
+	} | tr "\t" " " >expect &&
+	test_all_modes ahead_behind
+'
+
+test_expect_success 'for-each-ref ahead-behind: single base' '
+	git for-each-ref --format="%(refname:short) %(ahead-behind:commit-6-6)" \
+		refs/heads/commit-6-6 refs/heads/commit-2-2 refs/heads/commit-7-3 >actual &&
+	cat >expect <<-\EOF &&
+	commit-2-2 0 32
+	commit-6-6 0 0
+	commit-7-3 3 18
+	EOF
+	test_cmp expect actual
+'
+
+test_expect_success 'for-each-ref ahead-behind: multiple bases' '
+	for x in $(test_seq 1 10)
+	do
+		for y in $(test_seq 1 10)
+		do
+			echo "commit-$x-$y $(grid_ahead_behind $x $y 4 8) $(grid_ahead_behind $x $y 9 2)" ||
+			return 1
+		done || return 1
+	done | sort >expect &&
+	run_all_modes git for-each-ref --sort=refname \
+		--format="%(refname:short) %(ahead-behind:commit-4-8) %(ahead-behind:commit-9-2)" \
+		"refs/heads/commit-*"
+'
+
+test_expect_success 'for-each-ref ahead-behind: tags and non-commits' '
+	test_when_finished "git update-ref -d refs/misc/tree" &&
+	git update-ref refs/misc/tree "commit-3-3^{tree}" &&
+	git for-each-ref --format="%(refname) [%(ahead-behind:commit-3-3)]" \
+		refs/tags/tag-4-4 refs/misc/tree >actual &&
+	cat >expect <<-\EOF &&
+	refs/misc/tree []
+	refs/tags/tag-4-4 [7 0]
+	EOF
+	test_cmp expect actual
+'
+
+test_expect_success 'for-each-ref ahead-behind: invalid base' '
+	test_must_fail git for-each-ref --format="%(ahead-behind:no-such-ref)" 2>err &&
+	grep "failed to find .no-such-ref." err &&
+	test_must_fail git for-each-ref --format="%(ahead-behind)" 2>err &&
+	grep "expected format: %(ahead-behind:<committish>)" err
+'
+
 test_done
@@ -44,4 +44,25 @@ test_expect_success 'reset --hard did not corrupt index or cache-tree' '
 
 '
 
+test_expect_success 'reset --hard restores modified assume-unchanged paths' '
+	git reset --hard &&
+	git update-index --assume-unchanged before/1 &&
+	echo dirty >before/1 &&
+	GIT_TEST_PRELOAD_INDEX=1 git reset --hard &&
+	test_must_be_empty before/1
+'
+
+test_expect_success 'reset --keep notices modified paths' '
+	git reset --hard &&
+	git update-index --no-assume-unchanged before/1 &&
+	git commit --allow-empty -m empty &&
+	echo one >before/2 &&
+	git add before/2 &&
+	git commit -m one &&
+	echo dirty >before/2 &&
+	test_must_fail env GIT_TEST_PRELOAD_INDEX=1 git reset --keep HEAD~2 &&
+	echo dirty >expect &&
+	test_cmp expect before/2
+'
+
 test_done
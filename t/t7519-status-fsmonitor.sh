@@ -336,6 +336,61 @@ do
 	done
 done
 
+# Once the index has been written with every entry marked valid and the
+# integration script reports no changes, status should not need to look
+# at the index entries or the working tree at all.
+test_expect_success 'status trusts a quiet fsmonitor' '
+	test_hook --clobber fsmonitor-test <<-\EOF &&
+	printf "last_update_token\0"
+	EOF
+	clean_repo &&
+	git status &&
+	GIT_TRACE2_EVENT="$(pwd)/trace2.txt" \
+		git status --porcelain --untracked-files=no >actual &&
+	test_must_be_empty actual &&
+	grep "worktree/fsmonitor_all_valid" trace2.txt &&
+	grep "index/cache_tree_matches" trace2.txt &&
+	rm trace2.txt
+'
+
+test_expect_success 'status notices changes reported after a quiet run' '
+	test_hook --clobber fsmonitor-test <<-\EOF &&
+	printf "last_update_token\0"
+	printf "modified\0"
+	EOF
+	clean_repo &&
+	git status &&
+	echo changed >modified &&
+	GIT_TRACE2_EVENT="$(pwd)/trace2.txt" \
+		git status --porcelain --untracked-files=no >actual &&
+	echo " M modified" >expect &&
+	test_cmp expect actual &&
+	! grep "worktree/fsmonitor_all_valid" trace2.txt &&
+	rm trace2.txt
+'
+
+test_expect_success 'status reports staged changes with a quiet fsmonitor' '
+	test_hook --clobber fsmonitor-test <<-\EOF &&
+	printf "last_update_token\0"
+	printf "modified\0"
+	EOF
+	clean_repo &&
+	git status &&
+	echo changed >modified &&
+	git add modified &&
+	test_hook --clobber fsmonitor-test <<-\EOF &&
+	printf "last_update_token\0"
+	EOF
+	git status &&
+	GIT_TRACE2_EVENT="$(pwd)/trace2.txt" \
+		git status --porcelain --untracked-files=no >actual &&
+	echo "M  modified" >expect &&
+	test_cmp expect actual &&
+	grep "worktree/fsmonitor_all_valid" trace2.txt &&
+	! grep "index/cache_tree_matches" trace2.txt &&
+	rm trace2.txt
+'
+
 # test that splitting the index doesn't interfere
 test_expect_success 'splitting the index results in the same state' '
 	write_integration_script &&
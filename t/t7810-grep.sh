@@ -1581,6 +1581,185 @@ test_expect_success 'grep -F pattern with grep.patternType=basic' '
 	test_cmp expected actual
 '
 
+test_expect_success 'setup many fixed patterns' '
+	cat >fixed-many <<-\EOF &&
+	one token=abc123 here
+	nothing to see
+	a word and token=xyz789
+	password: hunter2, token=abc123
+	sword
+	EOF
+	git add fixed-many &&
+	test_write_lines token=abc123 token=xyz789 hunter2 word >patterns
+'
+
+test_expect_success 'grep -F with many patterns' '
+	cat >expected <<-\EOF &&
+	fixed-many:1:one token=abc123 here
+	fixed-many:3:a word and token=xyz789
+	fixed-many:4:password: hunter2, token=abc123
+	fixed-many:5:sword
+	EOF
+	git grep -n -F -f patterns fixed-many >actual &&
+	test_cmp expected actual &&
+	git grep -n -F -e token=abc123 -e token=xyz789 -e hunter2 -e word \
+		fixed-many >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep -F with many patterns and --column' '
+	cat >expected <<-\EOF &&
+	fixed-many:1:5:one token=abc123 here
+	fixed-many:3:3:a word and token=xyz789
+	fixed-many:4:5:password: hunter2, token=abc123
+	fixed-many:5:2:sword
+	EOF
+	git grep -n --column -F -f patterns fixed-many >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep -F -w with many patterns' '
+	cat >expected <<-\EOF &&
+	fixed-many:1:one token=abc123 here
+	fixed-many:3:a word and token=xyz789
+	fixed-many:4:password: hunter2, token=abc123
+	EOF
+	git grep -n -w -F -f patterns fixed-many >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep -F -o and -c with many patterns' '
+	cat >expected <<-\EOF &&
+	fixed-many:token=abc123
+	fixed-many:word
+	fixed-many:token=xyz789
+	fixed-many:word
+	fixed-many:hunter2
+	fixed-many:token=abc123
+	fixed-many:word
+	EOF
+	git grep -o -F -f patterns fixed-many >actual &&
+	test_cmp expected actual &&
+	echo fixed-many:4 >expected &&
+	git grep -c -F -f patterns fixed-many >actual &&
+	test_cmp expected actual &&
+	echo fixed-many:1 >expected &&
+	git grep -c -v -F -f patterns fixed-many >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep -F -o with overlapping patterns picks the longest' '
+	cat >expected <<-\EOF &&
+	fixed-many:token=abc123
+	fixed-many:token=xyz789
+	fixed-many:token=abc123
+	EOF
+	git grep -o -F -e token -e token=abc123 -e token=xyz789 fixed-many >actual &&
+	test_cmp expected actual &&
+	git grep -o --color=always -F -e token -e token=abc123 -e token=xyz789 \
+		fixed-many >colored &&
+	test_decode_color <colored >actual &&
+	cat >expected <<-\EOF &&
+	<MAGENTA>fixed-many<RESET><CYAN>:<RESET><BOLD;RED>token=abc123<RESET>
+	<MAGENTA>fixed-many<RESET><CYAN>:<RESET><BOLD;RED>token=xyz789<RESET>
+	<MAGENTA>fixed-many<RESET><CYAN>:<RESET><BOLD;RED>token=abc123<RESET>
+	EOF
+	test_cmp expected actual
+'
+
+test_expect_success 'grep -F with many patterns, one of them special' '
+	echo "fixed-many:sword" >expected &&
+	git grep -E -e "^s" -e hunter3 fixed-many >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep with several regexes skips to their next match' '
+	cat >expected <<-\EOF &&
+	fixed-many:1:one token=abc123 here
+	fixed-many:4:password: hunter2, token=abc123
+	fixed-many:5:sword
+	EOF
+	git grep -n -e "tok[a-z]*=abc" -e "^s" -e "not.there" fixed-many >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep --and and --all-match skip to lines with a match' '
+	cat >expected <<-\EOF &&
+	fixed-many:1:one token=abc123 here
+	fixed-many:4:password: hunter2, token=abc123
+	EOF
+	git grep -n -e token --and -e "h[a-z]*" fixed-many >actual &&
+	test_cmp expected actual &&
+	cat >expected <<-\EOF &&
+	fixed-many-2-nothing to see
+	fixed-many:3:a word and token=xyz789
+	fixed-many:4:password: hunter2, token=abc123
+	fixed-many:5:sword
+	EOF
+	git grep -n -C1 --all-match -e sword -e "xyz" fixed-many >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'setup revisions that share blobs' '
+	git init revs &&
+	mkdir revs/one revs/two revs/bin &&
+	test_write_lines needle hay >revs/one/file &&
+	cp revs/one/file revs/two/file &&
+	cp revs/one/file revs/bin/file &&
+	test_write_lines hay >revs/hay &&
+	echo "bin/* binary" >revs/.gitattributes &&
+	git -C revs add . &&
+	git -C revs commit -m one &&
+	test_write_lines hay more hay >revs/hay &&
+	git -C revs commit -a -m two
+'
+
+test_expect_success 'grep in several revisions searches each blob once' '
+	cat >expected <<-\EOF &&
+	Binary file HEAD:bin/file matches
+	HEAD:one/file:needle
+	HEAD:two/file:needle
+	Binary file HEAD~1:bin/file matches
+	HEAD~1:one/file:needle
+	HEAD~1:two/file:needle
+	EOF
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git -C revs grep needle HEAD HEAD~1 >actual &&
+	test_cmp expected actual &&
+	grep "\"key\":\"distinct-blobs\",\"value\":\"4\"" trace.event &&
+	grep "\"key\":\"matching-blobs\",\"value\":\"1\"" trace.event &&
+	git -C revs grep --threads=4 needle HEAD HEAD~1 >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep -L and -c in several revisions' '
+	cat >expected <<-\EOF &&
+	HEAD:.gitattributes
+	HEAD:hay
+	HEAD~1:.gitattributes
+	HEAD~1:hay
+	EOF
+	git -C revs grep -L needle HEAD HEAD~1 >actual &&
+	test_cmp expected actual &&
+	cat >expected <<-\EOF &&
+	HEAD:hay:2
+	HEAD~1:hay:1
+	EOF
+	git -C revs grep -c "^hay" HEAD HEAD~1 -- hay >actual &&
+	test_cmp expected actual
+'
+
+test_expect_success 'grep -I in several revisions looks at the paths' '
+	cat >expected <<-\EOF &&
+	HEAD:one/file:needle
+	HEAD:two/file:needle
+	HEAD~1:one/file:needle
+	HEAD~1:two/file:needle
+	EOF
+	git -C revs grep -I needle HEAD HEAD~1 >actual &&
+	test_cmp expected actual
+'
+
 test_expect_success 'grep -G pattern with grep.patternType=fixed' '
 	cat >expected <<-\EOF &&
 	ab:a+b*c
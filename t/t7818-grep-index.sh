@@ -0,0 +1,129 @@
+#!/bin/sh
+
+test_description='git grep with the grep index'
+
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	mkdir dir &&
+	test_write_lines "struct strbuf sb;" "strbuf_addf(&sb, x);" >strbuf.c &&
+	test_write_lines "int main(void)" "{" "	return 0;" "}" >main.c &&
+	test_write_lines "aaabcd" "xxyz" "fooBAR" >dir/letters &&
+	test_write_lines "the quick brown fox" "jumps over" >dir/fox.txt &&
+	printf "binary\0data with needle\n" >dir/blob.bin &&
+	git add . &&
+	git commit -m initial &&
+	git maintenance run --task=grep-index &&
+	test_path_is_file .git/objects/info/grep-index
+'
+
+# grep_with_and_without_index <expected blobs skipped> <grep arguments>
+grep_with_and_without_index () {
+	skipped=$1 &&
+	shift &&
+	test_might_fail git -c core.grepIndex=false grep "$@" >expect &&
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		test_might_fail git grep "$@" >actual &&
+	test_cmp expect actual &&
+	if test "$skipped" = -
+	then
+		! grep "grep-index/skipped" trace.event
+	else
+		grep "\"key\":\"grep-index/skipped\",\"value\":\"$skipped\"" trace.event
+	fi
+}
+
+test_expect_success 'fixed strings only read the blobs that contain them' '
+	grep_with_and_without_index 4 -F "strbuf_addf" HEAD &&
+	grep_with_and_without_index 3 -F -e "strbuf_addf" -e "return" HEAD &&
+	grep_with_and_without_index 5 "no such string" HEAD &&
+	grep_with_and_without_index 4 -c "needle" HEAD &&
+	grep_with_and_without_index 2 -l "quick brown" HEAD -- dir
+'
+
+test_expect_success 'short patterns read every blob' '
+	grep_with_and_without_index - "ox" HEAD &&
+	grep_with_and_without_index - -e "ox" -e "strbuf" HEAD
+'
+
+test_expect_success 'regular expressions are narrowed down by their literals' '
+	grep_with_and_without_index 4 "str.*addf" HEAD &&
+	grep_with_and_without_index 4 "a*bcd" HEAD &&
+	grep_with_and_without_index - "ab*cd" HEAD &&
+	grep_with_and_without_index 4 -E "x?xyz" HEAD &&
+	grep_with_and_without_index 4 -E "xxyz{1,2}" HEAD &&
+	grep_with_and_without_index 4 "xxyz\\{1,2\\}" HEAD &&
+	grep_with_and_without_index 4 -E "(foo|bar)BAR" HEAD &&
+	grep_with_and_without_index 4 "\\(foo\\|bar\\)BAR" HEAD &&
+	grep_with_and_without_index 4 "[abc]*quick" HEAD &&
+	grep_with_and_without_index 4 -w "[[:alpha:]]*quick" HEAD
+'
+
+test_expect_success 'alternatives read every blob' '
+	grep_with_and_without_index - -E "quick|return" HEAD &&
+	grep_with_and_without_index - "quick\\|return" HEAD &&
+	grep_with_and_without_index 3 -e quick --or -e return HEAD
+'
+
+test_expect_success PCRE 'escapes with arguments in -P patterns read every blob' '
+	grep_with_and_without_index - -P "\\x71uick" HEAD &&
+	grep_with_and_without_index - -P "\\161uick" HEAD &&
+	grep_with_and_without_index - -P "qu\\x{69}ck" HEAD &&
+	grep_with_and_without_index - -P "\\N{U+71}uick" HEAD &&
+	grep_with_and_without_index 4 -P "\\w+ brown" HEAD
+'
+
+test_expect_success '--and and --not' '
+	grep_with_and_without_index 4 -e quick --and -e brown HEAD &&
+	grep_with_and_without_index 4 -e quick --and --not -e brown HEAD &&
+	grep_with_and_without_index - --not -e quick HEAD
+'
+
+test_expect_success 'the index is not used when blobs without a match are shown' '
+	grep_with_and_without_index - -v quick HEAD &&
+	grep_with_and_without_index - -L quick HEAD &&
+	grep_with_and_without_index - -i QUICK HEAD
+'
+
+test_expect_success 'grep --cached uses the index' '
+	grep_with_and_without_index 4 --cached quick
+'
+
+test_expect_success 'threads use the index' '
+	grep_with_and_without_index 4 --threads=4 quick HEAD
+'
+
+test_expect_success 'blobs that are not in the index are searched' '
+	test_write_lines "a quick new file" >new &&
+	git add new &&
+	git commit -m new &&
+	grep_with_and_without_index 4 quick HEAD &&
+	git maintenance run --task=grep-index &&
+	grep_with_and_without_index 4 quick HEAD
+'
+
+test_expect_success 'blobs that are gone from the refs are dropped' '
+	git rm -q new &&
+	git commit -m "remove new" &&
+	git maintenance run --task=grep-index &&
+	grep_with_and_without_index 4 quick HEAD &&
+	grep_with_and_without_index 4 quick HEAD~1 &&
+	grep "HEAD~1:new:a quick new file" actual
+'
+
+test_expect_success 'blobs over core.bigFileThreshold are not indexed' '
+	rm .git/objects/info/grep-index &&
+	git -c core.bigFileThreshold=25 maintenance run --task=grep-index &&
+	grep_with_and_without_index 1 -e xxyz HEAD &&
+	grep_with_and_without_index 2 -e quick HEAD
+'
+
+test_expect_success 'core.grepIndex=false' '
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git -c core.grepIndex=false grep quick HEAD &&
+	grep "\"key\":\"grep-index/used\",\"value\":\"0\"" trace.event
+'
+
+test_done
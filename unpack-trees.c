@@ -1858,6 +1858,22 @@ int unpack_trees(unsigned len, struct tree_desc *t, struct unpack_trees_options
 		dfc = xcalloc(1, cache_entry_size(0));
 	o->df_conflict_entry = dfc;
 
+	/*
+	 * A oneway_merge() for reset checks every path that stays
+	 * the same against the working tree, one lstat() at a time
+	 * as the trees are traversed.  Refresh the stat information
+	 * with the threaded preload first, so that only the paths
+	 * that really changed need to be looked at again.  Do not
+	 * trust CE_VALID here, as reset relies on seeing the true
+	 * state of assume-unchanged paths.
+	 *
+	 * The other merge functions only verify the entries they
+	 * are about to overwrite, so a preload would stat far more
+	 * paths than they do.
+	 */
+	if (o->update && o->reset && o->fn == oneway_merge && !o->index_only)
+		preload_index(o->src_index, o->pathspec, REFRESH_REALLY);
+
 	if (len) {
 		const char *prefix = o->prefix ? o->prefix : "";
 		struct traverse_info info;
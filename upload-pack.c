@@ -27,6 +27,7 @@
 #include "commit-graph.h"
 #include "commit-reach.h"
 #include "shallow.h"
+#include "pack-bitmap.h"
 
 /* Remember to update object flag allocation in object.h */
 #define THEY_HAVE	(1u << 11)
@@ -74,6 +75,9 @@ struct upload_pack_data {
 	int shallow_nr;
 	timestamp_t oldest_have;
 
+	/* loaded on demand to answer ok_to_give_up() */
+	struct bitmap_index *bitmap_git;
+
 	unsigned int timeout;					/* v0 only */
 	enum {
 		NO_MULTI_ACK = 0,
@@ -106,6 +110,8 @@ struct upload_pack_data {
 	unsigned wait_for_done : 1;
 	unsigned allow_filter : 1;
 	unsigned allow_filter_fallback : 1;
+	unsigned use_bitmaps : 1;
+	unsigned bitmap_git_attempted : 1;
 	unsigned long tree_filter_max_depth;
 
 	unsigned done : 1;					/* v2 only */
@@ -138,6 +144,7 @@ static void upload_pack_data_init(struct upload_pack_data *data)
 	data->uri_protocols = uri_protocols;
 	data->extra_edge_obj = extra_edge_obj;
 	data->allowed_filters = allowed_filters;
+	data->use_bitmaps = 1;
 	data->allow_filter_fallback = 1;
 	data->tree_filter_max_depth = ULONG_MAX;
 	packet_writer_init(&data->writer, 1);
@@ -158,6 +165,7 @@ static void upload_pack_data_clear(struct upload_pack_data *data)
 	object_array_clear(&data->extra_edge_obj);
 	list_objects_filter_release(&data->filter_options);
 	string_list_clear(&data->allowed_filters, 0);
+	free_bitmap_index(data->bitmap_git);
 
 	free((char *)data->pack_objects_hook);
 }
@@ -499,16 +507,94 @@ static int got_oid(struct upload_pack_data *data,
 	return do_got_oid(data, oid);
 }
 
+/*
+ * Answer ok_to_give_up() for the wants that have a stored bitmap, by
+ * looking up the haves and their parents (which the client has, too) in
+ * it. Returns 0 if one of them reaches none of the haves, and 1 otherwise;
+ * the wants that cannot be answered this way are added to "rest".
+ */
+static int bitmap_ok_to_give_up(struct upload_pack_data *data,
+				struct object_array *rest)
+{
+	const struct object_id **haves = NULL;
+	size_t haves_nr = 0, haves_alloc = 0;
+	unsigned char *reachable;
+	int i, answered = 0, ret = 1;
+
+	for (i = 0; i < data->have_obj.nr; i++) {
+		struct object *o = data->have_obj.objects[i].item;
+		struct commit_list *p;
+
+		ALLOC_GROW(haves, haves_nr + 1, haves_alloc);
+		haves[haves_nr++] = &o->oid;
+		if (o->type != OBJ_COMMIT)
+			continue;
+		for (p = ((struct commit *)o)->parents; p; p = p->next) {
+			ALLOC_GROW(haves, haves_nr + 1, haves_alloc);
+			haves[haves_nr++] = &p->item->object.oid;
+		}
+	}
+	reachable = xmalloc(haves_nr);
+
+	for (i = 0; i < data->want_obj.nr; i++) {
+		struct object *want = data->want_obj.objects[i].item;
+		struct object *o = deref_tag(the_repository, want,
+					     "a from object", 0);
+
+		/* see can_all_from_reach_with_flag() */
+		if (!o || o->type != OBJ_COMMIT)
+			continue;
+
+		switch (bitmap_commit_contains_many(data->bitmap_git,
+						    (struct commit *)o,
+						    haves_nr, haves, reachable)) {
+		case -1:
+			add_object_array(want, NULL, rest);
+			break;
+		case 0:
+			ret = 0;
+			goto out;
+		default:
+			answered++;
+			break;
+		}
+	}
+
+out:
+	trace2_data_intmax("upload-pack", the_repository,
+			   "bitmap/wants-answered", answered);
+	free(reachable);
+	free(haves);
+	return ret;
+}
+
 static int ok_to_give_up(struct upload_pack_data *data)
 {
 	timestamp_t min_generation = GENERATION_NUMBER_ZERO;
+	struct object_array rest = OBJECT_ARRAY_INIT;
+	int ret;
 
 	if (!data->have_obj.nr)
 		return 0;
 
-	return can_all_from_reach_with_flag(&data->want_obj, THEY_HAVE,
-					    COMMON_KNOWN, data->oldest_have,
-					    min_generation);
+	if (data->use_bitmaps && !data->bitmap_git_attempted) {
+		data->bitmap_git_attempted = 1;
+		data->bitmap_git = prepare_bitmap_git(the_repository);
+	}
+	if (!data->bitmap_git)
+		return can_all_from_reach_with_flag(&data->want_obj, THEY_HAVE,
+						    COMMON_KNOWN,
+						    data->oldest_have,
+						    min_generation);
+
+	ret = bitmap_ok_to_give_up(data, &rest);
+	if (ret && rest.nr)
+		ret = can_all_from_reach_with_flag(&rest, THEY_HAVE,
+						   COMMON_KNOWN,
+						   data->oldest_have,
+						   min_generation);
+	object_array_clear(&rest);
+	return ret;
 }
 
 static int get_common_commits(struct upload_pack_data *data,
@@ -1315,6 +1401,8 @@ static int upload_pack_config(const char *var, const char *value, void *cb_data)
 		data->allow_ref_in_want = git_config_bool(var, value);
 	} else if (!strcmp("uploadpack.allowsidebandall", var)) {
 		data->allow_sideband_all = git_config_bool(var, value);
+	} else if (!strcmp("pack.usebitmaps", var)) {
+		data->use_bitmaps = git_config_bool(var, value);
 	} else if (!strcmp("core.precomposeunicode", var)) {
 		precomposed_unicode = git_config_bool(var, value);
 	} else if (!strcmp("transfer.advertisesid", var)) {
@@ -18,6 +18,8 @@
 #include "worktree.h"
 #include "lockfile.h"
 #include "sequencer.h"
+#include "fsmonitor.h"
+#include "cache-tree.h"
 
 #define AB_DELAY_WARNING_IN_MS (2 * 1000)
 
@@ -596,6 +598,15 @@ static void wt_status_collect_changes_worktree(struct wt_status *s)
 {
 	struct rev_info rev;
 
+	/*
+	 * Every entry is known to match the working tree, so there
+	 * are no changes to find.
+	 */
+	if (is_fsmonitor_all_valid(s->repo->index)) {
+		trace2_data_intmax("status", s->repo, "worktree/fsmonitor_all_valid", 1);
+		return;
+	}
+
 	repo_init_revisions(s->repo, &rev, NULL);
 	setup_revisions(0, NULL, &rev, NULL);
 	rev.diffopt.output_format |= DIFF_FORMAT_CALLBACK;
@@ -619,11 +630,34 @@ static void wt_status_collect_changes_worktree(struct wt_status *s)
 	release_revisions(&rev);
 }
 
+/*
+ * Is the tree recorded by a valid root of the cache-tree the same as the
+ * tree of the reference commit? If so, the index cannot differ from it.
+ */
+static int index_matches_reference(struct wt_status *s)
+{
+	struct cache_tree *it = s->repo->index->cache_tree;
+	struct object_id oid;
+	struct tree *tree;
+
+	if (!it || it->entry_count < 0)
+		return 0;
+	if (repo_get_oid(s->repo, s->reference, &oid))
+		return 0;
+	tree = parse_tree_indirect(&oid);
+	return tree && oideq(&tree->object.oid, &it->oid);
+}
+
 static void wt_status_collect_changes_index(struct wt_status *s)
 {
 	struct rev_info rev;
 	struct setup_revision_opt opt;
 
+	if (index_matches_reference(s)) {
+		trace2_data_intmax("status", s->repo, "index/cache_tree_matches", 1);
+		return;
+	}
+
 	repo_init_revisions(s->repo, &rev, NULL);
 	memset(&opt, 0, sizeof(opt));
 	opt.def = s->is_initial ? empty_tree_oid_hex() : s->reference;
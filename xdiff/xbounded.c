@@ -0,0 +1,271 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, see
+ *  <http://www.gnu.org/licenses/>.
+ */
+#include "xinclude.h"
+
+/*
+ * The bounded diff is meant for inputs on which the other algorithms
+ * can take time or memory out of proportion to their size, such as
+ * minified sources or lock files with many repeated lines.
+ *
+ * Like patience diff, it first matches the lines that are unique in
+ * both files, keeps the longest sequence of such pairs that is in the
+ * same order in both files, and recurses into the ranges between them,
+ * where more lines may be unique. Unlike patience diff, it stops
+ * recursing after XDL_BOUNDED_MAX_DEPTH levels, and hands a range
+ * without unique lines to the Myers algorithm only while the area of
+ * the ranges it has handed over so far, a bound on the work Myers has
+ * to do, stays within a budget proportional to the size of the input.
+ * Once the budget is spent, a range is reported as one change of all
+ * its lines, less the common lines at its start and end.
+ *
+ * So the time spent is O(N log N), plus at most O(N) for Myers, and
+ * memory use is O(N), where N is the number of lines in both files.
+ */
+
+#define XDL_BOUNDED_MAX_DEPTH 8
+#define XDL_BOUNDED_COST_PER_LINE 256
+#define XDL_BOUNDED_MIN_COST (1L << 16)
+
+struct bounded_env {
+	xdfenv_t *env;
+	xpparam_t const *xpp;
+	/* indexed by line class: occurrences (up to 2) in each file */
+	unsigned char *count1, *count2;
+	/* indexed by line class: where the line was last seen in file2 */
+	long *pos2;
+	/* how much more area we are willing to hand to Myers */
+	uint64_t budget;
+	/* did we give up on finding common lines in some range? */
+	int degraded;
+};
+
+struct anchor {
+	long line1, line2;
+};
+
+static unsigned long class1(struct bounded_env *b, long i)
+{
+	return b->env->xdf1.recs[i]->ha;
+}
+
+static unsigned long class2(struct bounded_env *b, long i)
+{
+	return b->env->xdf2.recs[i]->ha;
+}
+
+static void mark_changed(struct bounded_env *b,
+			 long line1, long count1, long line2, long count2)
+{
+	memset(b->env->xdf1.rchg + line1, 1, count1);
+	memset(b->env->xdf2.rchg + line2, 1, count2);
+}
+
+/*
+ * Collect the pairs of lines that occur exactly once in each of the
+ * two ranges, in the order of the first file, into "res". Returns the
+ * number of pairs. "has_common" is set if any line occurs in both.
+ */
+static long find_unique_pairs(struct bounded_env *b,
+			      long line1, long count1, long line2, long count2,
+			      struct anchor *res, int *has_common)
+{
+	long i, nr = 0;
+	unsigned long c;
+
+	for (i = line1; i < line1 + count1; i++) {
+		c = class1(b, i);
+		if (b->count1[c] < 2)
+			b->count1[c]++;
+	}
+	for (i = line2; i < line2 + count2; i++) {
+		c = class2(b, i);
+		if (b->count2[c] < 2)
+			b->count2[c]++;
+		b->pos2[c] = i;
+	}
+
+	*has_common = 0;
+	for (i = line1; i < line1 + count1; i++) {
+		c = class1(b, i);
+		if (!b->count2[c])
+			continue;
+		*has_common = 1;
+		if (b->count1[c] == 1 && b->count2[c] == 1) {
+			res[nr].line1 = i;
+			res[nr].line2 = b->pos2[c];
+			nr++;
+		}
+	}
+
+	for (i = line1; i < line1 + count1; i++)
+		b->count1[class1(b, i)] = 0;
+	for (i = line2; i < line2 + count2; i++)
+		b->count2[class2(b, i)] = 0;
+
+	return nr;
+}
+
+/*
+ * Reduce the "nr" pairs in "pairs", which are ordered by line1, to the
+ * longest subsequence that is also ordered by line2, in place, and
+ * return its length.
+ */
+static long longest_increasing(struct anchor *pairs, long nr)
+{
+	long *tail, *prev, longest = 0, i, k;
+
+	if (!nr)
+		return 0;
+	tail = xdl_malloc(nr * sizeof(*tail));
+	prev = xdl_malloc(nr * sizeof(*prev));
+
+	for (i = 0; i < nr; i++) {
+		long lo = 0, hi = longest;
+
+		/* find the first sequence whose last line2 is larger */
+		while (lo < hi) {
+			long mid = lo + (hi - lo) / 2;
+			if (pairs[tail[mid]].line2 < pairs[i].line2)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		prev[i] = lo ? tail[lo - 1] : -1;
+		tail[lo] = i;
+		if (lo == longest)
+			longest++;
+	}
+
+	for (i = tail[longest - 1], k = longest; k-- > 0; i = prev[i])
+		tail[k] = i;
+	/* tail[k] >= k, so this never reads a pair it has overwritten */
+	for (k = 0; k < longest; k++)
+		pairs[k] = pairs[tail[k]];
+
+	xdl_free(tail);
+	xdl_free(prev);
+	return longest;
+}
+
+static int fall_back(struct bounded_env *b,
+		     long line1, long count1, long line2, long count2)
+{
+	xpparam_t xpp;
+	uint64_t area = (uint64_t)count1 * count2;
+
+	if (area > b->budget) {
+		mark_changed(b, line1, count1, line2, count2);
+		b->degraded = 1;
+		return 0;
+	}
+	b->budget -= area;
+
+	memset(&xpp, 0, sizeof(xpp));
+	xpp.flags = b->xpp->flags & ~XDF_DIFF_ALGORITHM_MASK;
+
+	return xdl_fall_back_diff(b->env, &xpp,
+				  line1 + 1, count1, line2 + 1, count2);
+}
+
+static int bounded_diff(struct bounded_env *b,
+			long line1, long count1, long line2, long count2,
+			int depth)
+{
+	struct anchor *anchors;
+	long nr, i, end1, end2;
+	int has_common, ret = 0;
+
+	/* skip the common lines at the start and at the end */
+	while (count1 && count2 && class1(b, line1) == class2(b, line2)) {
+		line1++;
+		line2++;
+		count1--;
+		count2--;
+	}
+	while (count1 && count2 &&
+	       class1(b, line1 + count1 - 1) == class2(b, line2 + count2 - 1)) {
+		count1--;
+		count2--;
+	}
+
+	if (!count1 || !count2) {
+		mark_changed(b, line1, count1, line2, count2);
+		return 0;
+	}
+
+	if (depth >= XDL_BOUNDED_MAX_DEPTH)
+		return fall_back(b, line1, count1, line2, count2);
+
+	anchors = xdl_malloc(count1 * sizeof(*anchors));
+	nr = find_unique_pairs(b, line1, count1, line2, count2,
+			       anchors, &has_common);
+	if (!has_common) {
+		mark_changed(b, line1, count1, line2, count2);
+		goto out;
+	}
+	if (!nr) {
+		ret = fall_back(b, line1, count1, line2, count2);
+		goto out;
+	}
+
+	nr = longest_increasing(anchors, nr);
+	end1 = line1 + count1;
+	end2 = line2 + count2;
+	for (i = 0; i <= nr && !ret; i++) {
+		long next1 = i < nr ? anchors[i].line1 : end1;
+		long next2 = i < nr ? anchors[i].line2 : end2;
+
+		ret = bounded_diff(b, line1, next1 - line1,
+				   line2, next2 - line2, depth + 1);
+		line1 = next1 + 1;
+		line2 = next2 + 1;
+	}
+
+out:
+	xdl_free(anchors);
+	return ret;
+}
+
+int xdl_do_bounded_diff(mmfile_t *file1, mmfile_t *file2,
+			xpparam_t const *xpp, xdfenv_t *env)
+{
+	struct bounded_env b;
+	long nrec1 = env->xdf1.nrec, nrec2 = env->xdf2.nrec;
+	/* line classes are numbered from 0 across both files */
+	long nclass = nrec1 + nrec2 + 1;
+	int ret;
+
+	memset(&b, 0, sizeof(b));
+	b.env = env;
+	b.xpp = xpp;
+	b.count1 = xdl_malloc(nclass);
+	b.count2 = xdl_malloc(nclass);
+	b.pos2 = xdl_malloc(nclass * sizeof(*b.pos2));
+	memset(b.count1, 0, nclass);
+	memset(b.count2, 0, nclass);
+	b.budget = (uint64_t)XDL_BOUNDED_COST_PER_LINE * (nrec1 + nrec2) +
+		XDL_BOUNDED_MIN_COST;
+
+	ret = bounded_diff(&b, 0, nrec1, 0, nrec2, 0);
+
+	if (!ret && b.degraded && xpp->degraded)
+		*xpp->degraded = 1;
+
+	xdl_free(b.count1);
+	xdl_free(b.count2);
+	xdl_free(b.pos2);
+	return ret;
+}
@@ -330,6 +330,11 @@ int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 		goto out;
 	}
 
+	if (XDF_DIFF_ALG(xpp->flags) == XDF_BOUNDED_DIFF) {
+		res = xdl_do_bounded_diff(mf1, mf2, xpp, xe);
+		goto out;
+	}
+
 	/*
 	 * Allocate and setup K vectors to be used by the differential
 	 * algorithm.
@@ -374,10 +379,11 @@ int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 }
 
 
-static xdchange_t *xdl_add_change(xdchange_t *xscr, long i1, long i2, long chg1, long chg2) {
+static xdchange_t *xdl_add_change(chastore_t *scha, xdchange_t *xscr,
+				   long i1, long i2, long chg1, long chg2) {
 	xdchange_t *xch;
 
-	if (!(xch = (xdchange_t *) xdl_malloc(sizeof(xdchange_t))))
+	if (!(xch = (xdchange_t *) xdl_cha_alloc(scha)))
 		return NULL;
 
 	xch->next = xscr;
@@ -951,10 +957,9 @@ int xdl_build_script(xdfenv_t *xe, xdchange_t **xscr) {
 			for (l1 = i1; rchg1[i1 - 1]; i1--);
 			for (l2 = i2; rchg2[i2 - 1]; i2--);
 
-			if (!(xch = xdl_add_change(cscr, i1, i2, l1 - i1, l2 - i2))) {
-				xdl_free_script(cscr);
+			if (!(xch = xdl_add_change(&xe->scha, cscr, i1, i2,
+						   l1 - i1, l2 - i2)))
 				return -1;
-			}
 			cscr = xch;
 		}
 
@@ -964,15 +969,6 @@ int xdl_build_script(xdfenv_t *xe, xdchange_t **xscr) {
 }
 
 
-void xdl_free_script(xdchange_t *xscr) {
-	xdchange_t *xch;
-
-	while ((xch = xscr) != NULL) {
-		xscr = xscr->next;
-		xdl_free(xch);
-	}
-}
-
 static int xdl_call_hunk_func(xdfenv_t *xe, xdchange_t *xscr, xdemitcb_t *ecb,
 			      xdemitconf_t const *xecfg)
 {
@@ -1077,11 +1073,9 @@ int xdl_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 
 		if (ef(&xe, xscr, ecb, xecfg) < 0) {
 
-			xdl_free_script(xscr);
 			xdl_free_env(&xe);
 			return -1;
 		}
-		xdl_free_script(xscr);
 	}
 	xdl_free_env(&xe);
 
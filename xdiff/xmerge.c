@@ -366,7 +366,7 @@ static int xdl_refine_conflicts(xdfenv_t *xe1, xdfenv_t *xe2, xdmerge_t *m,
 	for (; m; m = m->next) {
 		mmfile_t t1, t2;
 		xdfenv_t xe;
-		xdchange_t *xscr, *x;
+		xdchange_t *xscr;
 		int i1 = m->i1, i2 = m->i2;
 
 		/* let's handle just the conflicts */
@@ -401,7 +401,6 @@ static int xdl_refine_conflicts(xdfenv_t *xe1, xdfenv_t *xe2, xdmerge_t *m,
 			m->mode = 4;
 			continue;
 		}
-		x = xscr;
 		m->i1 = xscr->i1 + i1;
 		m->chg1 = xscr->chg1;
 		m->i2 = xscr->i2 + i2;
@@ -410,7 +409,6 @@ static int xdl_refine_conflicts(xdfenv_t *xe1, xdfenv_t *xe2, xdmerge_t *m,
 			xdmerge_t *m2 = xdl_malloc(sizeof(xdmerge_t));
 			if (!m2) {
 				xdl_free_env(&xe);
-				xdl_free_script(x);
 				return -1;
 			}
 			xscr = xscr->next;
@@ -424,7 +422,6 @@ static int xdl_refine_conflicts(xdfenv_t *xe1, xdfenv_t *xe2, xdmerge_t *m,
 			m->chg2 = xscr->chg2;
 		}
 		xdl_free_env(&xe);
-		xdl_free_script(x);
 	}
 	return 0;
 }
@@ -728,9 +725,6 @@ int xdl_merge(mmfile_t *orig, mmfile_t *mf1, mmfile_t *mf2,
 				      xmp, result);
 	}
  out:
-	xdl_free_script(xscr1);
-	xdl_free_script(xscr2);
-
 	xdl_free_env(&xe2);
  free_xe1:
 	xdl_free_env(&xe1);
@@ -28,6 +28,7 @@
 #define XDL_SIMSCAN_WINDOW 100
 #define XDL_GUESS_NLINES1 256
 #define XDL_GUESS_NLINES2 20
+#define XDL_SCRIPT_CHANGES 64
 
 
 typedef struct s_xdlclass {
@@ -214,7 +215,8 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 	memset(rchg, 0, (nrec + 2) * sizeof(char));
 
 	if ((XDF_DIFF_ALG(xpp->flags) != XDF_PATIENCE_DIFF) &&
-	    (XDF_DIFF_ALG(xpp->flags) != XDF_HISTOGRAM_DIFF)) {
+	    (XDF_DIFF_ALG(xpp->flags) != XDF_HISTOGRAM_DIFF) &&
+	    (XDF_DIFF_ALG(xpp->flags) != XDF_BOUNDED_DIFF)) {
 		if (!(rindex = xdl_malloc((nrec + 1) * sizeof(*rindex))))
 			goto abort;
 		if (!(ha = xdl_malloc((nrec + 1) * sizeof(*ha))))
@@ -293,6 +295,7 @@ int xdl_prepare_env(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 
 	if ((XDF_DIFF_ALG(xpp->flags) != XDF_PATIENCE_DIFF) &&
 	    (XDF_DIFF_ALG(xpp->flags) != XDF_HISTOGRAM_DIFF) &&
+	    (XDF_DIFF_ALG(xpp->flags) != XDF_BOUNDED_DIFF) &&
 	    xdl_optimize_ctxs(&cf, &xe->xdf1, &xe->xdf2) < 0) {
 
 		xdl_free_ctx(&xe->xdf2);
@@ -303,12 +306,15 @@ int xdl_prepare_env(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 
 	xdl_free_classifier(&cf);
 
+	xdl_cha_init(&xe->scha, sizeof(xdchange_t), XDL_SCRIPT_CHANGES);
+
 	return 0;
 }
 
 
 void xdl_free_env(xdfenv_t *xe) {
 
+	xdl_cha_free(&xe->scha);
 	xdl_free_ctx(&xe->xdf2);
 	xdl_free_ctx(&xe->xdf1);
 }
@@ -60,6 +60,7 @@ typedef struct s_xdfile {
 
 typedef struct s_xdfenv {
 	xdfile_t xdf1, xdf2;
+	chastore_t scha; /* the changes of the edit scripts built from it */
 } xdfenv_t;
 
 
@@ -249,26 +249,59 @@ int xdl_recmatch(const char *l1, long s1, const char *l2, long s2, long flags)
 	return 1;
 }
 
+/*
+ * Hash "len" bytes a machine word at a time. The values are only ever
+ * compared with each other within one process, so it does not matter
+ * that they differ between machines of different byte order.
+ */
+static unsigned long xdl_hash_bytes(char const *ptr, size_t len)
+{
+	const uint64_t mul = 0x9ddfea08eb382d69ULL;
+	uint64_t ha = 0xcbf29ce484222325ULL ^ len;
+	uint64_t word;
+
+	for (; len >= sizeof(word); ptr += sizeof(word), len -= sizeof(word)) {
+		memcpy(&word, ptr, sizeof(word));
+		ha = (ha ^ word) * mul;
+		ha ^= ha >> 32;
+	}
+	if (len) {
+		word = 0;
+		while (len--)
+			word = (word << 8) | (unsigned char)ptr[len];
+		ha = (ha ^ word) * mul;
+	}
+	ha ^= ha >> 29;
+	ha *= mul;
+	ha ^= ha >> 32;
+
+	return (unsigned long) ha;
+}
+
 static unsigned long xdl_hash_record_with_whitespace(char const **data,
 		char const *top, long flags) {
 	unsigned long ha = 5381;
 	char const *ptr = *data;
-	int cr_at_eol_only = (flags & XDF_WHITESPACE_FLAGS) == XDF_IGNORE_CR_AT_EOL;
+	char const *eol = memchr(ptr, '\n', top - ptr);
 
-	for (; ptr < top && *ptr != '\n'; ptr++) {
-		if (cr_at_eol_only) {
-			/* do not ignore CR at the end of an incomplete line */
-			if (*ptr == '\r' &&
-			    (ptr + 1 < top && ptr[1] == '\n'))
-				continue;
-		}
-		else if (XDL_ISSPACE(*ptr)) {
+	*data = eol ? eol + 1 : top;
+	if (!eol)
+		eol = top;
+
+	if ((flags & XDF_WHITESPACE_FLAGS) == XDF_IGNORE_CR_AT_EOL) {
+		/* do not ignore CR at the end of an incomplete line */
+		if (eol < top && eol > ptr && eol[-1] == '\r')
+			eol--;
+		return xdl_hash_bytes(ptr, eol - ptr);
+	}
+
+	for (; ptr < eol; ptr++) {
+		if (XDL_ISSPACE(*ptr)) {
 			const char *ptr2 = ptr;
 			int at_eol;
-			while (ptr + 1 < top && XDL_ISSPACE(ptr[1])
-					&& ptr[1] != '\n')
+			while (ptr + 1 < eol && XDL_ISSPACE(ptr[1]))
 				ptr++;
-			at_eol = (top <= ptr + 1 || ptr[1] == '\n');
+			at_eol = (eol <= ptr + 1);
 			if (flags & XDF_IGNORE_WHITESPACE)
 				; /* already handled */
 			else if (flags & XDF_IGNORE_WHITESPACE_CHANGE
@@ -289,25 +322,29 @@ static unsigned long xdl_hash_record_with_whitespace(char const **data,
 		ha += (ha << 5);
 		ha ^= (unsigned long) *ptr;
 	}
-	*data = ptr < top ? ptr + 1: ptr;
 
 	return ha;
 }
 
+/*
+ * Find the end of the line with memchr(), which the C library usually
+ * implements with vector instructions, instead of looking at one byte
+ * at a time.
+ */
 unsigned long xdl_hash_record(char const **data, char const *top, long flags) {
-	unsigned long ha = 5381;
 	char const *ptr = *data;
+	char const *eol;
 
 	if (flags & XDF_WHITESPACE_FLAGS)
 		return xdl_hash_record_with_whitespace(data, top, flags);
 
-	for (; ptr < top && *ptr != '\n'; ptr++) {
-		ha += (ha << 5);
-		ha ^= (unsigned long) *ptr;
+	eol = memchr(ptr, '\n', top - ptr);
+	if (!eol) {
+		*data = top;
+		return xdl_hash_bytes(ptr, top - ptr);
 	}
-	*data = ptr < top ? ptr + 1: ptr;
-
-	return ha;
+	*data = eol + 1;
+	return xdl_hash_bytes(ptr, eol - ptr);
 }
 
 unsigned int xdl_hashbits(unsigned int size) {